@@ -0,0 +1,73 @@
+#include <pick_ik/forward_kinematics.hpp>
+#include <pick_ik/goal.hpp>
+#include <pick_ik/robot.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <fmt/core.h>
+#include <memory>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <vector>
+
+// Compares the throughput of the batched cost function against evaluating the scalar cost
+// function once per configuration, for the Panda arm and batch sizes typical of memetic
+// populations.
+int main() {
+    auto const robot_model = moveit::core::loadTestingRobotModel("panda");
+    auto const jmg = robot_model->getJointModelGroup("panda_arm");
+    auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {"panda_hand"}).value();
+    auto const robot = pick_ik::Robot::from(robot_model, jmg, tip_link_indices);
+    auto const chain = std::make_shared<pick_ik::KinematicChain const>(
+        pick_ik::KinematicChain::from(robot_model, jmg, tip_link_indices));
+    auto const fk_fn = pick_ik::make_incremental_fk_fn(chain);
+
+    auto const num_variables = robot.variables.size();
+    auto const goal_frames =
+        fk_fn(std::vector<double>{0.0, -M_PI_4, 0.0, -3.0 * M_PI_4, 0.0, M_PI_2, M_PI_4});
+    auto const cost_fn = pick_ik::make_cost_fn(
+        pick_ik::make_pose_cost_functions(goal_frames, 1.0, 0.5), {}, fk_fn);
+    auto const batch_cost_fn = pick_ik::make_batch_cost_fn(chain, goal_frames, 1.0, 0.5, {});
+
+    fmt::print(
+        "{:>10} {:>20} {:>20} {:>10}\n", "batch", "scalar evals/s", "batch evals/s", "speedup");
+    for (size_t const count : {16u, 32u, 64u, 128u, 256u}) {
+        std::vector<double> configurations(count * num_variables);
+        std::vector<double> joint_vals(num_variables, 0.0);
+        for (size_t k = 0; k < count; ++k) {
+            robot.set_random_valid_configuration(joint_vals);
+            std::copy(joint_vals.cbegin(),
+                      joint_vals.cend(),
+                      configurations.data() + k * num_variables);
+        }
+        std::vector<double> costs(count);
+
+        // Run for roughly the same number of evaluations for every batch size.
+        size_t const repetitions = 200'000 / count;
+        auto const evaluations = static_cast<double>(repetitions * count);
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < repetitions; ++r) {
+            for (size_t k = 0; k < count; ++k) {
+                auto const* const row = configurations.data() + k * num_variables;
+                joint_vals.assign(row, row + num_variables);
+                costs[k] = cost_fn(joint_vals);
+            }
+        }
+        std::chrono::duration<double> const scalar_time = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < repetitions; ++r) {
+            batch_cost_fn(configurations.data(), count, costs.data());
+        }
+        std::chrono::duration<double> const batch_time = std::chrono::steady_clock::now() - start;
+
+        auto const scalar_rate = evaluations / scalar_time.count();
+        auto const batch_rate = evaluations / batch_time.count();
+        fmt::print("{:>10} {:>20.0f} {:>20.0f} {:>10.2f}\n",
+                   count,
+                   scalar_rate,
+                   batch_rate,
+                   batch_rate / scalar_rate);
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <pick_ik/batch_ik.hpp>
+
+#include <pluginlib/class_loader.hpp>
+#include <rclcpp/rclcpp.hpp>
+#include <tf2_eigen/tf2_eigen.hpp>
+
+#include <chrono>
+#include <fmt/core.h>
+#include <memory>
+#include <moveit/kinematics_base/kinematics_base.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <random_numbers/random_numbers.h>
+#include <vector>
+
+// Compares the number of Panda poses solved per second by sequential searchPositionIK calls
+// against one searchPositionIKBatch call. The plugin is loaded through pluginlib, so the workspace
+// containing pick_ik must be sourced.
+int main(int argc, char** argv) {
+    rclcpp::init(argc, argv);
+    auto const node = std::make_shared<rclcpp::Node>("batch_ik_benchmark");
+
+    auto const robot_model = moveit::core::loadTestingRobotModel("panda");
+    auto const jmg = robot_model->getJointModelGroup("panda_arm");
+
+    pluginlib::ClassLoader<kinematics::KinematicsBase> loader("moveit_core",
+                                                              "kinematics::KinematicsBase");
+    auto const solver = loader.createSharedInstance("pick_ik/PickIkPlugin");
+    if (!solver->initialize(node, *robot_model, "panda_arm", "panda_link0", {"panda_hand"}, 0.0)) {
+        fmt::print("Failed to initialize pick_ik\n");
+        return 1;
+    }
+    auto const* const batch_solver = dynamic_cast<pick_ik::BatchIkSolver const*>(solver.get());
+
+    // Reachable goal poses, from FK of random valid configurations, all solved from the default
+    // configuration.
+    size_t const count = 500;
+    double const timeout = 0.1;
+    auto robot_state = moveit::core::RobotState(robot_model);
+    robot_state.setToDefaultValues();
+    std::vector<double> seed_state;
+    robot_state.copyJointGroupPositions(jmg, seed_state);
+
+    random_numbers::RandomNumberGenerator generator(42);
+    auto requests = std::vector<pick_ik::IkRequest>(count);
+    for (auto& request : requests) {
+        robot_state.setToRandomPositions(jmg, generator);
+        robot_state.update();
+        request.poses = {tf2::toMsg(robot_state.getGlobalLinkTransform("panda_hand"))};
+        request.seed_state = seed_state;
+    }
+
+    auto sequential_solved = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto const& request : requests) {
+        std::vector<double> solution;
+        moveit_msgs::msg::MoveItErrorCodes error_code;
+        if (solver->searchPositionIK(
+                request.poses.front(), request.seed_state, timeout, solution, error_code)) {
+            ++sequential_solved;
+        }
+    }
+    std::chrono::duration<double> const sequential_time = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    auto const results = batch_solver->searchPositionIKBatch(requests, timeout);
+    std::chrono::duration<double> const batch_time = std::chrono::steady_clock::now() - start;
+    auto batch_solved = 0;
+    for (auto const& result : results) {
+        if (result.error_code.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS) {
+            ++batch_solved;
+        }
+    }
+
+    fmt::print("{:>12} {:>10} {:>10} {:>14}\n", "", "requests", "solved", "solved/s");
+    fmt::print("{:>12} {:>10} {:>10} {:>14.1f}\n",
+               "sequential",
+               count,
+               sequential_solved,
+               sequential_solved / sequential_time.count());
+    fmt::print("{:>12} {:>10} {:>10} {:>14.1f}\n",
+               "batch",
+               count,
+               batch_solved,
+               batch_solved / batch_time.count());
+
+    rclcpp::shutdown();
+    return 0;
+}
@@ -0,0 +1,381 @@
+#include <pick_ik/cost_evaluator.hpp>
+#include <pick_ik/forward_kinematics.hpp>
+#include <pick_ik/goal.hpp>
+#include <pick_ik/halton.hpp>
+#include <pick_ik/ik_gradient.hpp>
+#include <pick_ik/ik_memetic.hpp>
+#include <pick_ik/random.hpp>
+#include <pick_ik/robot.hpp>
+#include <pick_ik/solve_stats.hpp>
+#include <pick_ik/thread_pool.hpp>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <rsl/random.hpp>
+
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr unsigned kSeed = 42;
+constexpr double kPositionScale = 1.0;
+constexpr double kRotationScale = 0.5;
+
+struct BenchmarkRobot {
+    std::string name;
+    std::string group_name;
+    std::string tip_link_name;
+};
+
+// Solves one pose with the given cost and solution functions, from the initial guess.
+using PresetSolveFn = std::function<std::optional<std::vector<double>>(
+    std::vector<double> const& initial_guess,
+    pick_ik::Robot const& robot,
+    pick_ik::CostFn const& cost_fn,
+    pick_ik::SolutionTestFn const& solution_fn,
+    pick_ik::CostGradientFn const& gradient_fn,
+    pick_ik::BatchCostFn const& batch_cost_fn)>;
+
+struct Preset {
+    std::string name;
+    PresetSolveFn solve_fn;
+};
+
+struct Row {
+    std::string robot;
+    std::string preset;
+    size_t poses;
+    double success_rate;
+    double p50_ms, p90_ms, p99_ms, max_ms;
+    double mean_fk_evals;
+    double mean_position_error, max_position_error;
+    double mean_orientation_error, max_orientation_error;
+};
+
+auto percentile(std::vector<double> const& sorted, double fraction) -> double {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    auto const rank = static_cast<size_t>(std::ceil(fraction * static_cast<double>(sorted.size())));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+// Counts the configurations evaluated by the analytic gradient or the batched cost function, if
+// the chain supports them.
+auto count_evaluations(pick_ik::CostGradientFn gradient_fn,
+                       std::shared_ptr<pick_ik::EvaluationCounters> counters)
+    -> pick_ik::CostGradientFn {
+    if (!gradient_fn) {
+        return gradient_fn;
+    }
+    return [gradient_fn = std::move(gradient_fn), counters = std::move(counters)](
+               std::vector<double> const& active_positions, std::vector<double>& gradient) {
+        counters->cost_evaluations.fetch_add(1, std::memory_order_relaxed);
+        counters->fk_evaluations.fetch_add(1, std::memory_order_relaxed);
+        return gradient_fn(active_positions, gradient);
+    };
+}
+
+auto count_evaluations(pick_ik::BatchCostFn batch_cost_fn,
+                       std::shared_ptr<pick_ik::EvaluationCounters> counters)
+    -> pick_ik::BatchCostFn {
+    if (!batch_cost_fn) {
+        return batch_cost_fn;
+    }
+    return [batch_cost_fn = std::move(batch_cost_fn), counters = std::move(counters)](
+               double const* configurations, size_t count, double* costs) {
+        counters->cost_evaluations.fetch_add(count, std::memory_order_relaxed);
+        counters->fk_evaluations.fetch_add(count, std::memory_order_relaxed);
+        batch_cost_fn(configurations, count, costs);
+    };
+}
+
+auto make_presets(pick_ik::ThreadPool* thread_pool) -> std::vector<Preset> {
+    auto gd_params = pick_ik::GradientIkParams{};
+    gd_params.max_time = 0.1;
+    gd_params.max_iterations = 1000;
+
+    auto const gradient = [gd_params](bool analytic) {
+        return [gd_params, analytic](std::vector<double> const& initial_guess,
+                                     pick_ik::Robot const& robot,
+                                     pick_ik::CostFn const& cost_fn,
+                                     pick_ik::SolutionTestFn const& solution_fn,
+                                     pick_ik::CostGradientFn const& gradient_fn,
+                                     pick_ik::BatchCostFn const&) {
+            return pick_ik::ik_gradient(initial_guess,
+                                        robot,
+                                        cost_fn,
+                                        solution_fn,
+                                        gd_params,
+                                        true,
+                                        analytic ? gradient_fn : pick_ik::CostGradientFn());
+        };
+    };
+
+    // Like the plugin, the memetic presets use the analytic gradient, and the batched cost function
+    // only if batch is set.
+    auto const memetic = [thread_pool](size_t num_threads,
+                                       size_t migration_interval,
+                                       bool halton = false,
+                                       bool batch = false) {
+        auto params = pick_ik::MemeticIkParams{};
+        params.max_time = 0.25;
+        params.num_threads = num_threads;
+        params.migration_interval = migration_interval;
+        return [params, thread_pool, halton, batch](
+                   std::vector<double> const& initial_guess,
+                   pick_ik::Robot const& robot,
+                   pick_ik::CostFn const& cost_fn,
+                   pick_ik::SolutionTestFn const& solution_fn,
+                   pick_ik::CostGradientFn const& gradient_fn,
+                   pick_ik::BatchCostFn const& batch_cost_fn) {
+            // Each solve continues a sequence of its own, like the requests of the plugin.
+            auto solve_params = params;
+            if (halton) {
+                auto rng = pick_ik::Rng(solve_params.seed);
+                solve_params.halton =
+                    std::make_shared<pick_ik::HaltonSequence>(robot.variables.size(), rng);
+            }
+            return pick_ik::ik_memetic(initial_guess,
+                                       robot,
+                                       cost_fn,
+                                       solution_fn,
+                                       solve_params,
+                                       true,
+                                       false,
+                                       gradient_fn,
+                                       batch ? batch_cost_fn : pick_ik::BatchCostFn(),
+                                       thread_pool);
+        };
+    };
+
+    return {{"gradient_numeric", gradient(false)},
+            {"gradient_analytic", gradient(true)},
+            {"memetic_1_thread", memetic(1, 0)},
+            {"memetic_4_threads", memetic(4, 0)},
+            {"memetic_4_threads_migration", memetic(4, 5)},
+            {"memetic_1_thread_batch", memetic(1, 0, false, true)},
+            {"memetic_4_threads_batch", memetic(4, 0, false, true)},
+            {"memetic_1_thread_halton", memetic(1, 0, true)},
+            {"memetic_4_threads_halton", memetic(4, 0, true)}};
+}
+
+void run_robot(BenchmarkRobot const& benchmark_robot,
+               size_t num_poses,
+               std::vector<Preset> const& presets,
+               std::vector<Row>& rows) {
+    auto const robot_model = moveit::core::loadTestingRobotModel(benchmark_robot.name);
+    auto const jmg = robot_model->getJointModelGroup(benchmark_robot.group_name);
+    auto const tip_link_indices =
+        pick_ik::get_link_indices(robot_model, {benchmark_robot.tip_link_name}).value();
+    auto const robot = pick_ik::Robot::from(robot_model, jmg, tip_link_indices);
+    auto const chain = std::make_shared<pick_ik::KinematicChain const>(
+        pick_ik::KinematicChain::from(robot_model, jmg, tip_link_indices));
+    auto const dof = robot.variables.size();
+
+    // Samples the goals and measures the errors of the solutions, outside of the solvers.
+    auto const fk_fn = pick_ik::make_incremental_fk_fn(chain);
+
+    // Sample every goal before solving, so the goals do not depend on the random numbers drawn by
+    // the solvers.
+    std::vector<std::vector<Eigen::Isometry3d>> goals(num_poses);
+    std::vector<double> configuration(dof);
+    for (auto& goal_frames : goals) {
+        robot.set_random_valid_configuration(configuration);
+        goal_frames = fk_fn(configuration);
+    }
+
+    std::vector<double> initial_guess(dof);
+    std::transform(robot.variables.cbegin(),
+                   robot.variables.cend(),
+                   initial_guess.begin(),
+                   [](auto const& variable) { return variable.mid; });
+
+    for (auto const& preset : presets) {
+        std::vector<double> latencies_ms;
+        std::vector<double> position_errors;
+        std::vector<double> orientation_errors;
+        size_t solved = 0;
+        size_t total_fk_evals = 0;
+
+        for (auto const& goal_frames : goals) {
+            // The same functions as PickIKPlugin::solve builds, counting the configurations whose
+            // frames are computed like its telemetry does.
+            auto const counters = std::make_shared<pick_ik::EvaluationCounters>();
+            auto const evaluation_fns = pick_ik::make_evaluation_fns(
+                pick_ik::CostEvaluator::from(
+                    chain, goal_frames, kPositionScale, kRotationScale, {}),
+                pick_ik::make_frame_tests(goal_frames, 0.001, 0.01),
+                0.0,
+                counters);
+            auto const gradient_fn =
+                count_evaluations(pick_ik::make_cost_gradient_fn(
+                                      chain, goal_frames, kPositionScale, kRotationScale, {}),
+                                  counters);
+            auto const batch_cost_fn = count_evaluations(
+                pick_ik::make_batch_cost_fn(chain, goal_frames, kPositionScale, kRotationScale, {}),
+                counters);
+            auto const& cost_fn = evaluation_fns.cost_fn;
+            auto const& solution_fn = evaluation_fns.solution_fn;
+
+            auto const start = std::chrono::steady_clock::now();
+            auto const solution = preset.solve_fn(
+                initial_guess, robot, cost_fn, solution_fn, gradient_fn, batch_cost_fn);
+            std::chrono::duration<double, std::milli> const latency =
+                std::chrono::steady_clock::now() - start;
+            total_fk_evals += counters->fk_evaluations.load();
+            latencies_ms.push_back(latency.count());
+
+            if (!solution.has_value()) {
+                continue;
+            }
+            if (solution_fn(solution.value())) {
+                ++solved;
+            }
+            auto const frame = fk_fn(solution.value()).front();
+            auto const& goal = goal_frames.front();
+            position_errors.push_back((frame.translation() - goal.translation()).norm());
+            orientation_errors.push_back(
+                Eigen::AngleAxisd(goal.rotation().transpose() * frame.rotation()).angle());
+        }
+
+        auto const mean = [](std::vector<double> const& values) {
+            return values.empty() ? 0.0
+                                  : std::accumulate(values.cbegin(), values.cend(), 0.0) /
+                                        static_cast<double>(values.size());
+        };
+        auto const max = [](std::vector<double> const& values) {
+            return values.empty() ? 0.0 : *std::max_element(values.cbegin(), values.cend());
+        };
+        std::sort(latencies_ms.begin(), latencies_ms.end());
+        auto const count = static_cast<double>(num_poses);
+        rows.push_back({benchmark_robot.name,
+                        preset.name,
+                        num_poses,
+                        static_cast<double>(solved) / count,
+                        percentile(latencies_ms, 0.5),
+                        percentile(latencies_ms, 0.9),
+                        percentile(latencies_ms, 0.99),
+                        max(latencies_ms),
+                        static_cast<double>(total_fk_evals) / count,
+                        mean(position_errors),
+                        max(position_errors),
+                        mean(orientation_errors),
+                        max(orientation_errors)});
+        fmt::print(stderr,
+                   "{} {}: {:.1f}% solved, p99 {:.2f} ms\n",
+                   benchmark_robot.name,
+                   preset.name,
+                   100.0 * rows.back().success_rate,
+                   rows.back().p99_ms);
+    }
+}
+
+auto to_csv(std::vector<Row> const& rows) -> std::string {
+    std::string csv =
+        "robot,preset,poses,success_rate,p50_ms,p90_ms,p99_ms,max_ms,mean_fk_evals,"
+        "mean_position_error,max_position_error,mean_orientation_error,max_orientation_error\n";
+    for (auto const& row : rows) {
+        csv += fmt::format(
+            "{},{},{},{:.4f},{:.4f},{:.4f},{:.4f},{:.4f},{:.1f},{:.3e},{:.3e},{:.3e},{:.3e}\n",
+            row.robot,
+            row.preset,
+            row.poses,
+            row.success_rate,
+            row.p50_ms,
+            row.p90_ms,
+            row.p99_ms,
+            row.max_ms,
+            row.mean_fk_evals,
+            row.mean_position_error,
+            row.max_position_error,
+            row.mean_orientation_error,
+            row.max_orientation_error);
+    }
+    return csv;
+}
+
+auto to_json(std::vector<Row> const& rows) -> std::string {
+    std::string json = fmt::format("{{\n  \"seed\": {},\n  \"results\": [\n", kSeed);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        auto const& row = rows[i];
+        json += fmt::format(
+            "    {{\"robot\": \"{}\", \"preset\": \"{}\", \"poses\": {}, \"success_rate\": {:.4f}, "
+            "\"p50_ms\": {:.4f}, \"p90_ms\": {:.4f}, \"p99_ms\": {:.4f}, \"max_ms\": {:.4f}, "
+            "\"mean_fk_evals\": {:.1f}, \"mean_position_error\": {:.3e}, "
+            "\"max_position_error\": {:.3e}, \"mean_orientation_error\": {:.3e}, "
+            "\"max_orientation_error\": {:.3e}}}{}\n",
+            row.robot,
+            row.preset,
+            row.poses,
+            row.success_rate,
+            row.p50_ms,
+            row.p90_ms,
+            row.p99_ms,
+            row.max_ms,
+            row.mean_fk_evals,
+            row.mean_position_error,
+            row.max_position_error,
+            row.mean_orientation_error,
+            row.max_orientation_error,
+            i + 1 < rows.size() ? "," : "");
+    }
+    json += "  ]\n}\n";
+    return json;
+}
+
+}  // namespace
+
+// Solves reachable poses, from FK of random valid configurations, with the gradient and memetic
+// solvers under several parameter presets, and reports the success rate, latency percentiles, FK
+// evaluations and final pose error of each. The goals are drawn from a fixed seed, so every run
+// solves the same poses and runs of different versions can be compared. Writes JSON, or CSV if the
+// output file name ends in .csv.
+// Usage: ik_quality_benchmark [num_poses] [output.json|output.csv]
+int main(int argc, char** argv) {
+    auto const num_poses = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200ul;
+    auto const output_path = argc > 2 ? std::string(argv[2]) : std::string();
+
+    // Seeds the generator of this thread, which samples the goals. The solvers draw from the
+    // streams of their own seed.
+    rsl::rng({kSeed});
+
+    auto thread_pool = pick_ik::ThreadPool(4);
+    auto const presets = make_presets(&thread_pool);
+    std::vector<Row> rows;
+    for (auto const& benchmark_robot :
+         {BenchmarkRobot{"panda", "panda_arm", "panda_hand"},
+          BenchmarkRobot{"fanuc", "manipulator", "tool0"}}) {
+        run_robot(benchmark_robot, static_cast<size_t>(num_poses), presets, rows);
+    }
+
+    auto const is_csv = output_path.size() >= 4 &&
+                        output_path.compare(output_path.size() - 4, 4, ".csv") == 0;
+    auto const output = is_csv ? to_csv(rows) : to_json(rows);
+    if (output_path.empty()) {
+        fmt::print("{}", output);
+        return 0;
+    }
+    auto* const file = std::fopen(output_path.c_str(), "w");
+    if (file == nullptr) {
+        fmt::print(stderr, "Failed to open {}\n", output_path);
+        return 1;
+    }
+    fmt::print(file, "{}", output);
+    std::fclose(file);
+    return 0;
+}
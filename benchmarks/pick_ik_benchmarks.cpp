@@ -0,0 +1,180 @@
+#include <pick_ik/fk_moveit.hpp>
+#include <pick_ik/forward_kinematics.hpp>
+#include <pick_ik/goal.hpp>
+#include <pick_ik/ik_gradient.hpp>
+#include <pick_ik/ik_memetic.hpp>
+#include <pick_ik/random.hpp>
+#include <pick_ik/robot.hpp>
+#include <pick_ik/thread_pool.hpp>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// A planar RR arm with 2 m and 1 m links, as used by the tests.
+auto make_rr_model() {
+    auto builder = moveit::core::RobotModelBuilder("rr", "base");
+
+    geometry_msgs::msg::Pose origin;
+    origin.orientation.w = 1.0;
+
+    geometry_msgs::msg::Pose tform_x1;
+    tform_x1.position.x = 1.0;
+    tform_x1.orientation.w = 1.0;
+
+    geometry_msgs::msg::Pose tform_x2;
+    tform_x2.position.x = 2.0;
+    tform_x2.orientation.w = 1.0;
+
+    auto const z_axis = urdf::Vector3(0, 0, 1);
+
+    builder.addChain("base->a", "revolute", {origin}, z_axis);
+    builder.addChain("a->b", "revolute", {tform_x2}, z_axis);
+    builder.addChain("b->ee", "fixed", {tform_x1});
+    builder.addGroupChain("base", "ee", "group");
+    return builder.build();
+}
+
+struct Result {
+    std::string name;
+    std::string robot;
+    size_t dof;
+    size_t threads;
+    size_t iterations;
+    double ns_per_op;
+};
+
+// Calls fn until at least min_time has passed and returns the iterations and mean nanoseconds.
+template <typename Fn>
+auto time_it(Fn&& fn, double min_time, size_t min_iterations) -> std::pair<size_t, double> {
+    auto const start = std::chrono::steady_clock::now();
+    size_t iterations = 0;
+    std::chrono::duration<double> elapsed{0.0};
+    do {
+        fn();
+        ++iterations;
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (iterations < min_iterations || elapsed.count() < min_time);
+    return {iterations, elapsed.count() * 1.0e9 / static_cast<double>(iterations)};
+}
+
+void run_robot(std::string const& robot_name,
+               std::shared_ptr<moveit::core::RobotModel const> const& robot_model,
+               std::string const& group_name,
+               std::string const& tip_link_name,
+               std::vector<Result>& results) {
+    auto const jmg = robot_model->getJointModelGroup(group_name);
+    auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {tip_link_name}).value();
+    auto const robot = pick_ik::Robot::from(robot_model, jmg, tip_link_indices);
+    auto const fk_fn = pick_ik::make_fk_fn(robot_model, jmg, tip_link_indices);
+    auto const dof = robot.variables.size();
+
+    auto const add = [&](std::string name, size_t threads, std::pair<size_t, double> timing) {
+        results.push_back(
+            {std::move(name), robot_name, dof, threads, timing.first, timing.second});
+    };
+
+    // Goal from a random configuration, solved from the zero configuration.
+    std::vector<double> goal_state(dof, 0.0);
+    robot.set_random_valid_configuration(goal_state);
+    auto const goal_frames = fk_fn(goal_state);
+    std::vector<double> const initial_guess(dof, 0.0);
+    auto const cost_fn =
+        pick_ik::make_cost_fn(pick_ik::make_pose_cost_functions(goal_frames, 1.0, 0.5), {}, fk_fn);
+    auto const solution_fn = pick_ik::make_is_solution_test_fn(
+        pick_ik::make_frame_tests(goal_frames, 0.001, 0.001), {}, 0.0, fk_fn);
+
+    std::vector<double> joint_vals(dof, 0.0);
+    robot.set_random_valid_configuration(joint_vals);
+    add("fk", 1, time_it([&] { fk_fn(joint_vals); }, 0.2, 100));
+    add("cost_fn", 1, time_it([&] { cost_fn(joint_vals); }, 0.2, 100));
+
+    auto gd = pick_ik::GradientIk::from(initial_guess, cost_fn);
+    add("gradient_step", 1, time_it([&] { pick_ik::step(gd, robot, cost_fn, 0.0001); }, 0.2, 100));
+
+    auto params = pick_ik::MemeticIkParams{};
+    auto ik = pick_ik::MemeticIk::from(initial_guess, cost_fn, params);
+    auto rng = pick_ik::Rng(0);
+    ik.initPopulation(robot, cost_fn, initial_guess, rng);
+    auto const generation = [&] {
+        for (size_t i = 0; i < ik.eliteCount(); ++i) {
+            ik.gradientDescent(i, robot, cost_fn, params.gd_params);
+        }
+        ik.reproduce(robot, cost_fn, rng);
+        ik.sortPopulation();
+    };
+    add("memetic_generation", 1, time_it(generation, 0.2, 10));
+
+    for (size_t const threads : {1u, 2u, 4u}) {
+        params.num_threads = threads;
+        auto thread_pool = pick_ik::ThreadPool(threads);
+        auto const solve = [&] {
+            pick_ik::ik_memetic(initial_guess,
+                                robot,
+                                cost_fn,
+                                solution_fn,
+                                params,
+                                false,
+                                false,
+                                pick_ik::CostGradientFn(),
+                                pick_ik::BatchCostFn(),
+                                &thread_pool);
+        };
+        add("memetic_solve", threads, time_it(solve, 1.0, 10));
+    }
+}
+
+}  // namespace
+
+// Times the building blocks of the solvers and a full memetic solve for robots of different
+// degrees of freedom, and prints the results as JSON so they can be compared across commits.
+// Usage: pick_ik_benchmarks [output.json]
+int main(int argc, char** argv) {
+    std::vector<Result> results;
+    run_robot("rr", make_rr_model(), "group", "ee", results);
+    run_robot("panda",
+              moveit::core::loadTestingRobotModel("panda"),
+              "panda_arm",
+              "panda_hand",
+              results);
+
+    std::string json = "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto const& result = results[i];
+        json += fmt::format(
+            "    {{\"name\": \"{}\", \"robot\": \"{}\", \"dof\": {}, \"threads\": {}, "
+            "\"iterations\": {}, \"ns_per_op\": {:.1f}}}{}\n",
+            result.name,
+            result.robot,
+            result.dof,
+            result.threads,
+            result.iterations,
+            result.ns_per_op,
+            i + 1 < results.size() ? "," : "");
+    }
+    json += "  ]\n}\n";
+
+    if (argc > 1) {
+        auto* const file = std::fopen(argv[1], "w");
+        if (file == nullptr) {
+            fmt::print(stderr, "Failed to open {}\n", argv[1]);
+            return 1;
+        }
+        fmt::print(file, "{}", json);
+        std::fclose(file);
+    } else {
+        fmt::print("{}", json);
+    }
+    return 0;
+}
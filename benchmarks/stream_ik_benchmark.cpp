@@ -0,0 +1,141 @@
+#include <pick_ik/ik_stream.hpp>
+
+#include <pluginlib/class_loader.hpp>
+#include <rclcpp/rclcpp.hpp>
+#include <tf2_eigen/tf2_eigen.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fmt/core.h>
+#include <memory>
+#include <moveit/kinematics_base/kinematics_base.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <string>
+#include <vector>
+
+namespace {
+// Latency and continuity of the solutions of one pass over the path.
+struct PathStats {
+    size_t solved = 0;
+    std::vector<double> latencies;  // Seconds per waypoint.
+    double max_joint_jump = 0.0;    // Largest change of a variable between consecutive waypoints.
+
+    auto add(double latency,
+             bool found,
+             std::vector<double> const& previous,
+             std::vector<double> const& solution) -> void {
+        latencies.push_back(latency);
+        if (!found) {
+            return;
+        }
+        ++solved;
+        for (size_t i = 0; i < solution.size(); ++i) {
+            max_joint_jump = std::max(max_joint_jump, std::abs(solution[i] - previous[i]));
+        }
+    }
+
+    auto print(std::string const& name) -> void {
+        std::sort(latencies.begin(), latencies.end());
+        auto mean = 0.0;
+        for (auto const latency : latencies) {
+            mean += latency / static_cast<double>(latencies.size());
+        }
+        auto const p99 = latencies[latencies.size() * 99 / 100];
+        fmt::print("{:>18} {:>8} {:>12.1f} {:>12.1f} {:>12.1f} {:>10.4f}\n",
+                   name,
+                   solved,
+                   mean * 1e6,
+                   p99 * 1e6,
+                   latencies.back() * 1e6,
+                   max_joint_jump);
+    }
+};
+}  // namespace
+
+// Follows a dense 1000-waypoint Panda path, comparing searchPositionIK seeded with the previous
+// solution against a streaming session. The plugin is loaded through pluginlib, so the workspace
+// containing pick_ik must be sourced.
+int main(int argc, char** argv) {
+    rclcpp::init(argc, argv);
+    auto const node = std::make_shared<rclcpp::Node>("stream_ik_benchmark");
+
+    auto const robot_model = moveit::core::loadTestingRobotModel("panda");
+    auto const jmg = robot_model->getJointModelGroup("panda_arm");
+
+    pluginlib::ClassLoader<kinematics::KinematicsBase> loader("moveit_core",
+                                                              "kinematics::KinematicsBase");
+    auto const solver = loader.createSharedInstance("pick_ik/PickIkPlugin");
+    if (!solver->initialize(node, *robot_model, "panda_arm", "panda_link0", {"panda_hand"}, 0.0)) {
+        fmt::print("Failed to initialize pick_ik\n");
+        return 1;
+    }
+    auto const* const streaming_solver =
+        dynamic_cast<pick_ik::StreamingIkSolver const*>(solver.get());
+
+    // A smooth, reachable path: FK of a joint space loop around a typical working configuration.
+    size_t const count = 1000;
+    double const timeout = 0.05;
+    auto const center = std::vector<double>{0.0, -M_PI_4, 0.0, -3.0 * M_PI_4, 0.0, M_PI_2, M_PI_4};
+    auto const amplitudes = std::vector<double>{0.6, 0.3, 0.4, 0.4, 0.5, 0.4, 0.6};
+    auto robot_state = moveit::core::RobotState(robot_model);
+    robot_state.setToDefaultValues();
+    auto path = std::vector<geometry_msgs::msg::Pose>(count);
+    auto joint_vals = center;
+    for (size_t k = 0; k < count; ++k) {
+        auto const phase = 2.0 * M_PI * static_cast<double>(k) / static_cast<double>(count);
+        for (size_t i = 0; i < center.size(); ++i) {
+            joint_vals[i] = center[i] + amplitudes[i] * std::sin(phase + static_cast<double>(i));
+        }
+        robot_state.setJointGroupPositions(jmg, joint_vals);
+        robot_state.update();
+        path[k] = tf2::toMsg(robot_state.getGlobalLinkTransform("panda_hand"));
+    }
+    auto seed_state = center;
+    for (size_t i = 0; i < center.size(); ++i) {
+        seed_state[i] += amplitudes[i] * std::sin(static_cast<double>(i));
+    }
+
+    fmt::print("{:>18} {:>8} {:>12} {:>12} {:>12} {:>10}\n",
+               "",
+               "solved",
+               "mean [us]",
+               "p99 [us]",
+               "max [us]",
+               "max jump");
+
+    auto sequential = PathStats{};
+    auto previous = seed_state;
+    for (auto const& pose : path) {
+        std::vector<double> solution;
+        moveit_msgs::msg::MoveItErrorCodes error_code;
+        auto const start = std::chrono::steady_clock::now();
+        auto const found = solver->searchPositionIK(pose, previous, timeout, solution, error_code);
+        std::chrono::duration<double> const latency = std::chrono::steady_clock::now() - start;
+        sequential.add(latency.count(), found, previous, solution);
+        if (found) {
+            previous = solution;
+        }
+    }
+    sequential.print("searchPositionIK");
+
+    auto stream = PathStats{};
+    auto const session = streaming_solver->startIkStream(seed_state);
+    previous = seed_state;
+    for (auto const& pose : path) {
+        std::vector<double> solution;
+        moveit_msgs::msg::MoveItErrorCodes error_code;
+        auto const start = std::chrono::steady_clock::now();
+        auto const found = session->solve({pose}, timeout, solution, error_code);
+        std::chrono::duration<double> const latency = std::chrono::steady_clock::now() - start;
+        stream.add(latency.count(), found, previous, solution);
+        if (found) {
+            previous = solution;
+        }
+    }
+    stream.print("stream session");
+
+    rclcpp::shutdown();
+    return 0;
+}
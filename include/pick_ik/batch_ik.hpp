@@ -0,0 +1,66 @@
+#pragma once
+
+#include <functional>
+#include <geometry_msgs/msg/pose.hpp>
+#include <moveit/kinematics_base/kinematics_base.h>
+#include <moveit_msgs/msg/move_it_error_codes.hpp>
+#include <string>
+#include <vector>
+
+namespace pick_ik {
+
+// One request of a batch: goal poses of the tip frames and the seed state to start from.
+struct IkRequest {
+    std::vector<geometry_msgs::msg::Pose> poses;
+    std::vector<double> seed_state;
+};
+
+struct IkResult {
+    std::vector<double> solution;  // The seed state if no solution was found.
+    moveit_msgs::msg::MoveItErrorCodes error_code;
+};
+
+// Called once per request as soon as it is solved, possibly from several threads at once.
+using IkResultCallback = std::function<void(size_t index, IkResult const& result)>;
+
+/**
+ * @brief Interface of kinematics plugins that solve many independent IK and FK queries in parallel.
+ * @details The pick_ik plugin implements it, so callers can get it from a loaded
+ * kinematics::KinematicsBase with dynamic_cast.
+ */
+class BatchIkSolver {
+   public:
+    virtual ~BatchIkSolver() = default;
+
+    /**
+     * @brief Solves every request as searchPositionIK would, spread over the solver threads.
+     * @details All requests share the solver settings that are current when the batch starts.
+     * @param requests The requests to solve.
+     * @param timeout Timeout of each request, in seconds.
+     * @param result_callback Called with each result as soon as its request is solved.
+     * @param options Query options applied to every request.
+     * @return The results, in request order.
+     */
+    virtual auto searchPositionIKBatch(
+        std::vector<IkRequest> const& requests,
+        double timeout,
+        IkResultCallback const& result_callback = IkResultCallback(),
+        kinematics::KinematicsQueryOptions const& options =
+            kinematics::KinematicsQueryOptions()) const -> std::vector<IkResult> = 0;
+
+    /**
+     * @brief Computes link poses as getPositionFK would, for many joint vectors at once.
+     * @param link_names Links of the group, or its tip frames, whose poses to compute.
+     * @param joint_angles Group variable values, one row of the row-major count x variables matrix
+     * per joint vector.
+     * @param poses Set to the poses of the links relative to the base frame, the link_names.size()
+     * poses of each joint vector in turn.
+     * @return False if a link is unknown or the joint angles do not fit the group.
+     */
+    virtual auto getPositionFKBatch(std::vector<std::string> const& link_names,
+                                    std::vector<double> const& joint_angles,
+                                    std::vector<geometry_msgs::msg::Pose>& poses) const
+        -> bool = 0;
+};
+
+}  // namespace pick_ik
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <pick_ik/forward_kinematics.hpp>
+#include <pick_ik/goal.hpp>
+#include <pick_ik/robot.hpp>
+#include <pick_ik/solve_stats.hpp>
+
+#include <Eigen/Geometry>
+#include <memory>
+#include <variant>
+#include <vector>
+
+namespace pick_ik {
+
+// Pose cost of one tip, the same as the function made by make_pose_cost_fn.
+struct PoseCost {
+    size_t tip;
+    Eigen::Isometry3d goal;
+    double position_scale;  // Zero or negative to ignore the position.
+    double rotation_scale;  // Zero or negative to ignore the orientation.
+
+    auto operator()(Eigen::Isometry3d const& tip_frame) const -> double;
+};
+
+// The goal costs below hold only the variable data they need, and compute the same values as the
+// matching make_*_cost_fn functions without allocating.
+
+struct CenterJointsCost {
+    std::vector<size_t> variables;  // Bounded variables.
+    std::vector<double> mids;
+    std::vector<double> factors;  // Minimal displacement factors.
+
+    static auto from(Robot const& robot) -> CenterJointsCost;
+    auto operator()(std::vector<double> const& active_positions) const -> double;
+};
+
+struct AvoidJointLimitsCost {
+    std::vector<size_t> variables;  // Bounded variables.
+    std::vector<double> mids;
+    std::vector<double> half_spans;
+    std::vector<double> factors;  // Minimal displacement factors.
+
+    static auto from(Robot const& robot) -> AvoidJointLimitsCost;
+    auto operator()(std::vector<double> const& active_positions) const -> double;
+};
+
+struct MinimalDisplacementCost {
+    std::vector<double> initial_guess;
+    std::vector<double> factors;  // Minimal displacement factors.
+
+    static auto from(Robot const& robot, std::vector<double> initial_guess)
+        -> MinimalDisplacementCost;
+    auto operator()(std::vector<double> const& active_positions) const -> double;
+};
+
+/**
+ * @brief Weighted goal of a compiled cost function.
+ * @details Custom cost functions, such as those from make_ik_cost_fn, are called through CostFn and
+ * only avoid allocating if the function itself does.
+ */
+struct GoalTerm {
+    std::variant<CenterJointsCost, AvoidJointLimitsCost, MinimalDisplacementCost, CostFn> cost;
+    double weight;
+
+    // Returns the weighted cost.
+    auto operator()(std::vector<double> const& active_positions) const -> double;
+};
+
+// Wraps a goal term into a Goal for the functions that take goals.
+auto to_goal(GoalTerm term) -> Goal;
+
+auto to_goals(std::vector<GoalTerm> const& terms) -> std::vector<Goal>;
+
+/**
+ * @brief Cost function compiled into plain data, with the buffers of its last evaluation.
+ * @details Evaluating updates the chain frames incrementally in place and writes the cost terms
+ * into preallocated buffers, so that after the first evaluation no call allocates. An evaluator
+ * must only be used by one thread at a time.
+ */
+struct CostEvaluator {
+    std::shared_ptr<KinematicChain const> chain;
+    std::vector<PoseCost> pose_terms;
+    std::vector<GoalTerm> goal_terms;
+
+    // Results of the last evaluation.
+    ChainFrames frames;
+    std::vector<double> pose_costs;  // Cost of each tip pose.
+    std::vector<double> goal_costs;  // Weighted cost of each goal.
+    double cost = 0.0;
+
+    static auto from(std::shared_ptr<KinematicChain const> chain,
+                     std::vector<Eigen::Isometry3d> const& goal_frames,
+                     double position_scale,
+                     double rotation_scale,
+                     std::vector<GoalTerm> goal_terms) -> CostEvaluator;
+};
+
+/// Evaluates the cost of a configuration, updating the frames and cost terms of the evaluator.
+/// @return The cost, the same as the function made by make_cost_fn.
+auto evaluate(CostEvaluator& self, std::vector<double> const& active_positions) -> double;
+
+/// Frame of a tip in the last evaluation.
+auto tip_frame(CostEvaluator const& self, size_t tip) -> Eigen::Isometry3d const&;
+
+/// Creates a cost function that evaluates a copy of the evaluator private to the calling thread.
+auto make_cost_fn(CostEvaluator evaluator) -> CostFn;
+
+/**
+ * @brief Creates a cost function and a solution test that share one evaluation per configuration.
+ * @details The same as the FK based version, except that each thread evaluates its own copy of the
+ * compiled evaluator, so neither function allocates once a thread has made its copy. If counters
+ * are given, the cost function calls and the configurations evaluated are counted in them.
+ */
+auto make_evaluation_fns(CostEvaluator evaluator,
+                         std::vector<FrameTestFn> frame_tests,
+                         double cost_threshold,
+                         std::shared_ptr<EvaluationCounters> counters = nullptr) -> EvaluationFns;
+
+}  // namespace pick_ik
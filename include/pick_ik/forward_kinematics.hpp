@@ -1,13 +1,19 @@
 #pragma once
 
+#include <Eigen/Geometry>
+#include <functional>
 #include <memory>
 #include <moveit/robot_model/joint_model.h>
+#include <moveit/robot_model/joint_model_group.h>
 #include <moveit/robot_model/robot_model.h>
+#include <optional>
 #include <tf2/LinearMath/Vector3.h>
 #include <vector>
 
 namespace pick_ik {
 
+using FkFn = std::function<std::vector<Eigen::Isometry3d>(std::vector<double> const&)>;
+
 auto make_joint_axes(std::shared_ptr<moveit::core::RobotModel const> const& model)
     -> std::vector<tf2::Vector3>;
 
@@ -35,4 +41,145 @@ auto get_frame(CachedJointFrames& cache,
                std::vector<double> const& variables,
                std::vector<tf2::Vector3> const& joint_axes) -> Eigen::Isometry3d;
 
+/**
+ * @brief The links between the root of a joint model group and its tip links.
+ * @details Only links whose frame depends on the group variables are part of the chain. Links
+ * above them never move, so their frames are computed once from the default variable values.
+ */
+struct KinematicChain {
+    struct Link {
+        moveit::core::LinkModel const* link_model;
+        moveit::core::JointModel const* joint_model;
+        std::optional<size_t> parent;          // Index of the parent link, if it moves.
+        Eigen::Isometry3d fixed_parent_frame;  // Global frame of the parent, if it does not move.
+        std::optional<size_t> variable;        // Group variable driving a 1-DOF joint.
+        double variable_factor;                // Mimic factor of the joint, or 1.0.
+    };
+
+    struct Tip {
+        std::optional<size_t> link;    // Index of the tip link, if it moves.
+        Eigen::Isometry3d fixed_frame;  // Global frame of the tip, if it does not move.
+        std::vector<size_t> path;      // Indices of the moving links from the root to the tip.
+    };
+
+    std::shared_ptr<moveit::core::RobotModel const> robot_model;
+    std::vector<tf2::Vector3> joint_axes;
+    std::vector<Eigen::Isometry3d> link_frames;
+    std::vector<double> default_variables;
+
+    /// @brief Robot model variable index for each group variable, in group order.
+    std::vector<size_t> group_variable_indices;
+
+    /// @brief Chain links, ordered so that each link comes after its parent.
+    std::vector<Link> links;
+    std::vector<moveit::core::JointModel const*> mimic_joints;
+    std::vector<Tip> tips;
+
+    /// @brief False if a moving joint has more than one variable (e.g. floating or planar).
+    bool has_analytic_jacobian = true;
+
+    static auto from(std::shared_ptr<moveit::core::RobotModel const> const& model,
+                     moveit::core::JointModelGroup const* jmg,
+                     std::vector<size_t> const& tip_link_indices) -> KinematicChain;
+};
+
+/** @brief Global link frames of a KinematicChain, cached for incremental updates. */
+struct ChainFrames {
+    std::vector<double> variables;          // Robot variables the frames were computed for.
+    std::vector<double> working;            // Scratch space for the next set of variables.
+    std::vector<Eigen::Isometry3d> frames;  // Global frame of each chain link.
+    std::vector<bool> updated;              // Whether each frame changed in the last update.
+    bool valid = false;
+
+    static auto from(KinematicChain const& chain) -> ChainFrames;
+};
+
+/**
+ * @brief Updates the chain frames for new group variable values.
+ * @details Only links at or below a joint that moved since the last update are recomputed.
+ * @param chain The kinematic chain.
+ * @param cache The cached frames to update.
+ * @param active_positions Variable values in joint model group order.
+ */
+auto update_frames(KinematicChain const& chain,
+                   ChainFrames& cache,
+                   std::vector<double> const& active_positions) -> void;
+
+/** @brief Copies the tip frames out of up-to-date chain frames. */
+auto get_tip_frames(KinematicChain const& chain,
+                    ChainFrames const& cache,
+                    std::vector<Eigen::Isometry3d>& tip_frames) -> void;
+
+/** @brief Frame of one tip in up-to-date chain frames. */
+auto get_tip_frame(KinematicChain const& chain, ChainFrames const& cache, size_t tip)
+    -> Eigen::Isometry3d const&;
+
+/** @brief Geometric Jacobian: linear velocity rows on top, angular velocity rows below. */
+using Jacobian = Eigen::Matrix<double, 6, Eigen::Dynamic>;
+
+/**
+ * @brief Computes the geometric Jacobian of every tip frame with respect to the group variables.
+ * @details Both the linear and angular velocities are expressed in the world frame. The chain
+ * frames must be up to date, and the chain must have an analytic Jacobian.
+ */
+auto compute_jacobians(KinematicChain const& chain,
+                       ChainFrames const& cache,
+                       std::vector<Jacobian>& jacobians) -> void;
+
+/**
+ * @brief Global link frames of a KinematicChain for a batch of configurations.
+ * @details The frames are stored as structure of arrays: every entry of a link frame is an array
+ * over the configurations, so that the batched FK loops vectorize across configurations.
+ */
+struct BatchChainFrames {
+    /// @brief Entries per frame: the rotation in column-major order, then the translation.
+    static constexpr size_t kFrameEntries = 12;
+
+    size_t count = 0;                  // Number of configurations.
+    std::vector<double> frames;        // Frame entries, indexed by (link, entry, configuration).
+    std::vector<double> joint_values;  // Scratch space for one joint over all configurations.
+    std::vector<double> sines;
+    std::vector<double> cosines;
+
+    auto entry(size_t link, size_t index) -> double* {
+        return frames.data() + (link * kFrameEntries + index) * count;
+    }
+    auto entry(size_t link, size_t index) const -> double const* {
+        return frames.data() + (link * kFrameEntries + index) * count;
+    }
+};
+
+/**
+ * @brief Computes the chain frames for a batch of configurations.
+ * @details The chain must have an analytic Jacobian, i.e. only revolute, prismatic and fixed
+ * moving joints.
+ * @param chain The kinematic chain.
+ * @param cache The frames to compute, resized as needed.
+ * @param configurations Variable values in joint model group order, one row of the row-major
+ * count x variables matrix per configuration.
+ * @param count Number of configurations.
+ */
+auto update_batch_frames(KinematicChain const& chain,
+                         BatchChainFrames& cache,
+                         double const* configurations,
+                         size_t count) -> void;
+
+/** @brief Frame of one tip for one configuration of up-to-date batched chain frames. */
+auto get_batch_tip_frame(KinematicChain const& chain,
+                         BatchChainFrames const& cache,
+                         size_t tip,
+                         size_t configuration) -> Eigen::Isometry3d;
+
+/**
+ * @brief Creates a forward kinematics function that walks only the group's kinematic chain.
+ * @details Each calling thread keeps its own ChainFrames, so successive calls from one thread that
+ * change few joints (such as numerical gradient steps) only recompute the affected links.
+ */
+auto make_incremental_fk_fn(std::shared_ptr<moveit::core::RobotModel const> const& robot_model,
+                            moveit::core::JointModelGroup const* jmg,
+                            std::vector<size_t> const& tip_link_indices) -> FkFn;
+
+/** @brief Creates an incremental forward kinematics function for an existing chain. */
+auto make_incremental_fk_fn(std::shared_ptr<KinematicChain const> chain) -> FkFn;
+
 }  // namespace pick_ik
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <pick_ik/fk_moveit.hpp>
+#include <pick_ik/forward_kinematics.hpp>
 #include <pick_ik/robot.hpp>
 
 #include <Eigen/Geometry>
@@ -13,6 +14,11 @@
 
 namespace pick_ik {
 
+// Distance between the positions and angle between the orientations of two frames.
+auto linear_distance(Eigen::Isometry3d const& frame_1, Eigen::Isometry3d const& frame_2) -> double;
+auto angular_distance(Eigen::Isometry3d const& frame_1, Eigen::Isometry3d const& frame_2)
+    -> double;
+
 // Frame equality tests
 using FrameTestFn = std::function<bool(Eigen::Isometry3d const& tip_frame)>;
 auto make_frame_tests(std::vector<Eigen::Isometry3d> goal_frames,
@@ -64,4 +70,87 @@ using CostFn = std::function<double(std::vector<double> const& active_positions)
 auto make_cost_fn(std::vector<PoseCostFn> pose_cost_functions, std::vector<Goal> goals, FkFn fk)
     -> CostFn;
 
+// Cost, cost terms and solution verdict of one configuration, all computed from one FK pass.
+struct Evaluation {
+    double cost = 0.0;               // Same value as the cost function.
+    std::vector<double> pose_costs;  // Cost of each tip pose.
+    std::vector<double> goal_costs;  // Weighted cost of each goal.
+    bool is_solution = false;        // Same verdict as the solution test.
+};
+
+using EvaluationFn = std::function<Evaluation(std::vector<double> const& active_positions)>;
+
+auto make_evaluation_fn(std::vector<PoseCostFn> pose_cost_functions,
+                        std::vector<FrameTestFn> frame_tests,
+                        std::vector<Goal> goals,
+                        double cost_threshold,
+                        FkFn fk) -> EvaluationFn;
+
+// Cost function and solution test sharing their evaluations.
+struct EvaluationFns {
+    CostFn cost_fn;
+    SolutionTestFn solution_fn;
+};
+
+/**
+ * @brief Creates a cost function and a solution test that share one evaluation per configuration.
+ * @details Each thread keeps the tip frames and goal costs of the last configuration it evaluated,
+ * so testing a configuration whose cost was just computed, or computing the cost of one that was
+ * just tested, does not repeat FK or goal evaluation. The functions return the same values as
+ * make_cost_fn and make_is_solution_test_fn.
+ */
+auto make_evaluation_fns(std::vector<PoseCostFn> pose_cost_functions,
+                         std::vector<FrameTestFn> frame_tests,
+                         std::vector<Goal> goals,
+                         double cost_threshold,
+                         FkFn fk) -> EvaluationFns;
+
+// Cost of a batch of configurations, stored as the rows of a row-major count x variables matrix.
+using BatchCostFn =
+    std::function<void(double const* configurations, size_t count, double* costs)>;
+
+/**
+ * @brief Creates a batched version of the cost function built from pose cost functions and goals.
+ * @details The tip frames of all configurations come from one batched FK pass whose loops
+ * vectorize across configurations, and the goals are evaluated per configuration. Returns an
+ * empty function if the chain has no analytic Jacobian.
+ */
+auto make_batch_cost_fn(std::shared_ptr<KinematicChain const> chain,
+                        std::vector<Eigen::Isometry3d> goal_frames,
+                        double position_scale,
+                        double rotation_scale,
+                        std::vector<Goal> goals) -> BatchCostFn;
+
+// Cost function that also computes its gradient with respect to the active positions.
+using CostGradientFn = std::function<double(std::vector<double> const& active_positions,
+                                            std::vector<double>& gradient)>;
+
+/**
+ * @brief Creates the gradient of the cost function built from pose cost functions and goals.
+ * @details The pose cost gradients are computed analytically from the chain Jacobians, and the
+ * goal gradients by central differences, which do not need FK. Returns an empty function if the
+ * chain has no analytic Jacobian.
+ */
+auto make_cost_gradient_fn(std::shared_ptr<KinematicChain const> chain,
+                           std::vector<Eigen::Isometry3d> goal_frames,
+                           double position_scale,
+                           double rotation_scale,
+                           std::vector<Goal> goals) -> CostGradientFn;
+
+// Stacked 6D pose residual of every tip and its Jacobian with respect to the active positions.
+using PoseResidualFn = std::function<void(std::vector<double> const& active_positions,
+                                          Eigen::VectorXd& residual,
+                                          Eigen::MatrixXd& jacobian)>;
+
+/**
+ * @brief Creates a function computing the scaled pose residuals of all tips.
+ * @details For each tip the residual is (position_scale * position error, rotation_scale * rotation
+ * vector error), both in the world frame, so its squared norm equals the pose cost. Returns an
+ * empty function if the chain has no analytic Jacobian.
+ */
+auto make_pose_residual_fn(std::shared_ptr<KinematicChain const> chain,
+                           std::vector<Eigen::Isometry3d> goal_frames,
+                           double position_scale,
+                           double rotation_scale) -> PoseResidualFn;
+
 }  // namespace pick_ik
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <pick_ik/random.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pick_ik {
+
+/**
+ * @brief Scrambled Halton sequence, whose points cover the unit cube far more evenly than
+ * independent uniform samples.
+ * @details Dimension j takes the radical inverse of the point index in the j-th prime base. The
+ * digits of each dimension go through a random permutation, which breaks up the correlation
+ * between the dimensions of large bases and makes differently seeded sequences independent.
+ * Any run of consecutive points covers the unit cube evenly, so each user, such as a species of
+ * the memetic solver, takes consecutive points from its own start. The sequence is not modified by
+ * taking points, so that threads can share it and still get reproducible points.
+ */
+class HaltonSequence {
+    std::vector<uint32_t> bases_;
+    std::vector<std::vector<uint32_t>> permutations_;  // Digit permutation of each dimension.
+
+   public:
+    HaltonSequence(size_t dimensions, Rng& rng);
+
+    auto dimensions() const -> size_t { return bases_.size(); }
+
+    /// Random index from which to take consecutive points, so that users with different random
+    /// streams mostly take different points.
+    auto random_start(Rng& rng) const -> uint64_t;
+
+    /// Writes the point of the given index, in [0, 1) in every dimension, to point. Point 0 is the
+    /// origin, so indices start at 1.
+    auto at(uint64_t index, std::vector<double>& point) const -> void;
+};
+
+}  // namespace pick_ik
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+namespace pick_ik {
+
+/// Outcomes of the solver races of hybrid mode.
+struct HybridIkStats {
+    size_t local_wins = 0;   // Races won by the local solver.
+    size_t global_wins = 0;  // Races won by the global solver.
+    size_t failures = 0;     // Races without a valid solution.
+};
+
+/**
+ * @brief Interface of kinematics plugins that race a local and a global solver.
+ * @details The pick_ik plugin implements it, so callers can get it from a loaded
+ * kinematics::KinematicsBase with dynamic_cast.
+ */
+class HybridIkSolver {
+   public:
+    virtual ~HybridIkSolver() = default;
+
+    /// Outcomes of the races since the solver was initialized.
+    virtual auto getHybridIkStats() const -> HybridIkStats = 0;
+};
+
+}  // namespace pick_ik
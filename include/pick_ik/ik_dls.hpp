@@ -0,0 +1,68 @@
+#pragma once
+
+#include <pick_ik/goal.hpp>
+#include <pick_ik/robot.hpp>
+
+#include <Eigen/Core>
+#include <atomic>
+#include <optional>
+#include <vector>
+
+namespace pick_ik {
+
+struct DlsIkParams {
+    double initial_damping = 0.001;   // Initial damping factor.
+    double damping_increase = 10.0;   // Damping multiplier after a rejected step.
+    double damping_decrease = 0.1;    // Damping multiplier after an accepted step.
+    double max_damping = 1.0e6;       // Damping above which the solver gives up.
+    double min_damping = 1.0e-9;      // Lower bound on the damping factor.
+    double min_cost_delta = 1.0e-12;  // Minimum cost difference for termination.
+    double max_time = 0.05;           // Maximum time elapsed for termination.
+    int max_iterations = 100;         // Maximum iterations for termination.
+    // If false, keeps running after finding a solution to further optimize the solution until a
+    // time or iteration limit is reached. If true, stop on finding a valid solution.
+    bool stop_optimization_on_valid_solution = true;
+};
+
+struct DlsIk {
+    std::vector<double> local;
+    std::vector<double> working;
+    double local_cost;
+    double damping;
+
+    // Scratch space for the linear solve.
+    Eigen::VectorXd residual;
+    Eigen::MatrixXd jacobian;
+    Eigen::MatrixXd hessian;
+    Eigen::VectorXd delta;
+
+    static DlsIk from(std::vector<double> const& initial_guess,
+                      CostFn const& cost_fn,
+                      DlsIkParams const& params);
+};
+
+/// Performs one damped least-squares (Levenberg-Marquardt) step.
+/// @param self Instance of DlsIk object.
+/// @param robot Robot model, used to clamp the step to joint limits.
+/// @param cost_fn Cost function deciding whether the step is accepted.
+/// @param residual_fn Pose residuals and their Jacobian.
+/// @param params Damping parameters.
+/// @return true if the step was accepted (the cost decreased), else false.
+auto step(DlsIk& self,
+          Robot const& robot,
+          CostFn const& cost_fn,
+          PoseResidualFn const& residual_fn,
+          DlsIkParams const& params) -> bool;
+
+/// Runs damped least-squares IK.
+/// Setting cancel stops the solve early, as if it had timed out.
+auto ik_dls(std::vector<double> const& initial_guess,
+            Robot const& robot,
+            CostFn const& cost_fn,
+            PoseResidualFn const& residual_fn,
+            SolutionTestFn const& solution_fn,
+            DlsIkParams const& params,
+            bool approx_solution,
+            std::atomic<bool> const* cancel = nullptr) -> std::optional<std::vector<double>>;
+
+}  // namespace pick_ik
@@ -2,7 +2,9 @@
 
 #include <pick_ik/goal.hpp>
 #include <pick_ik/robot.hpp>
+#include <pick_ik/solve_stats.hpp>
 
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <moveit/robot_model/joint_model_group.h>
@@ -41,11 +43,31 @@ struct GradientIk {
 /// @return true if the cost function improved (decreased), else false.
 auto step(GradientIk& self, Robot const& robot, CostFn const& cost_fn, double step_size) -> bool;
 
+/// Performs one step of gradient descent using an analytic cost gradient.
+/// @param self Instance of GradientIk object.
+/// @param robot Robot model,
+/// @param cost_fn Cost function for gradient descent.
+/// @param gradient_fn Gradient of the cost function.
+/// @param step_size Step size used to scale the gradient, as for the numerical version.
+/// @return true if the cost function improved (decreased), else false.
+auto step(GradientIk& self,
+          Robot const& robot,
+          CostFn const& cost_fn,
+          CostGradientFn const& gradient_fn,
+          double step_size) -> bool;
+
+/// Runs gradient descent IK.
+/// If gradient_fn is empty, the gradient is computed numerically from cost_fn.
+/// Setting cancel stops the descent early, as if it had timed out.
+/// If stats is given, the descent steps are added to it.
 auto ik_gradient(std::vector<double> const& initial_guess,
                  Robot const& robot,
                  CostFn const& cost_fn,
                  SolutionTestFn const& solution_fn,
                  GradientIkParams const& params,
-                 bool approx_solution) -> std::optional<std::vector<double>>;
+                 bool approx_solution,
+                 CostGradientFn const& gradient_fn = CostGradientFn(),
+                 std::atomic<bool> const* cancel = nullptr,
+                 SolveStats* stats = nullptr) -> std::optional<std::vector<double>>;
 
 }  // namespace pick_ik
@@ -1,13 +1,16 @@
 #pragma once
 
 #include <pick_ik/goal.hpp>
+#include <pick_ik/halton.hpp>
 #include <pick_ik/ik_gradient.hpp>
+#include <pick_ik/random.hpp>
 #include <pick_ik/robot.hpp>
-
-#include <rsl/random.hpp>
+#include <pick_ik/solve_stats.hpp>
+#include <pick_ik/thread_pool.hpp>
 
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <moveit/robot_model/joint_model_group.h>
 #include <moveit/robot_model/robot_model.h>
@@ -39,18 +42,64 @@ struct MemeticIkParams {
     // If true, returns first solution and terminates other threads.
     // If false, waits for all threads to join and returns best solution.
     bool stop_on_first_soln = true;
+    // With multiple species, every this many generations each species sends its best individuals
+    // to the next species in a ring, where they replace the worst ones if they are fitter.
+    // 0 disables migration, so species evolve independently.
+    size_t migration_interval = 0;
+    size_t num_migrants = 2;  // Number of individuals sent per migration.
+    // Seed of the random streams. With multiple species, each one draws from its own stream.
+    uint64_t seed = 0;
+    // If set, random initial elites are points of this sequence rather than independent uniform
+    // samples. Each species takes consecutive points, across its wipeouts, from a start drawn
+    // from its own stream, so that solves stay reproducible.
+    std::shared_ptr<HaltonSequence> halton;
 
     // Gradient descent parameters for memetic exploitation.
     GradientIkParams gd_params;
 };
 
+// Flags that stop a species early, checked on every gradient descent and reproduction step.
+struct StopFlags {
+    std::atomic<bool> const* terminate = nullptr;  // Another species found a solution.
+    std::atomic<bool> const* cancel = nullptr;     // The caller no longer needs the solve.
+
+    bool isSet() const {
+        return (terminate != nullptr && *terminate) || (cancel != nullptr && *cancel);
+    }
+};
+
+/**
+ * @brief Lock-free ring buffer of individuals migrating from one species to another.
+ * @details Safe for a single producer and a single consumer thread. Pushing to a full ring drops
+ * the individual, so a slow species never blocks a fast one.
+ */
+class MigrationRing {
+    std::vector<Individual> slots_;
+    std::atomic<size_t> head_{0};  // Next slot to read, only written by the consumer.
+    std::atomic<size_t> tail_{0};  // Next slot to write, only written by the producer.
+
+   public:
+    explicit MigrationRing(size_t capacity) : slots_(capacity) {}
+
+    bool push(Individual const& individual);
+    bool pop(Individual& individual);
+};
+
 class MemeticIk {
    private:
-    // Evolutionary algorithm values
-    std::vector<Individual> population_;
-    std::vector<Individual*> mating_pool_;
-    Individual best_;       // Best solution overall.
-    Individual best_curr_;  // Best solution so far.
+    // Evolutionary algorithm values, stored as structure of arrays.
+    // Slot s of the population owns row s of the row-major population_size x dof genes_ and
+    // gradients_ arenas and entry s of fitness_ and extinction_. Sorting only permutes order_,
+    // which lists the slots from best to worst fitness.
+    size_t dof_;
+    std::vector<double> genes_;
+    std::vector<double> gradients_;
+    std::vector<double> fitness_;
+    std::vector<double> extinction_;
+    std::vector<size_t> order_;
+    std::vector<size_t> mating_pool_;  // Slots of the elites that can still be parents.
+    Individual best_;                  // Best solution overall.
+    Individual best_curr_;             // Best solution so far.
     std::optional<double> previous_fitness_;
 
     // Solver parameters
@@ -60,25 +109,68 @@ class MemeticIk {
     std::vector<double> extinction_grading_;
     double inverse_gene_size_;
 
+    // Variable limits, with infinite bounds for unbounded variables, cached by initPopulation.
+    std::vector<double> lower_limits_;
+    std::vector<double> upper_limits_;
+    std::vector<double> half_spans_;
+
+    // Scratch space reused across generations, so that evolving does not allocate.
+    std::vector<GradientIk> gd_workspaces_;  // One per elite.
+    std::vector<double> scratch_genes_;
+    std::vector<double> batch_genes_;  // Children gathered for batched evaluation.
+    std::vector<double> batch_costs_;
+    std::vector<double> random_a_;
+    std::vector<double> random_b_;
+    std::vector<double> mutations_;
+    std::vector<double> unit_point_;  // Point of the Halton sequence, if any.
+    uint64_t halton_index_ = 0;       // Next point of the Halton sequence, 0 until one is taken.
+    Individual migrant_;
+
+    double* genesOf(size_t slot) { return genes_.data() + slot * dof_; }
+    double* gradientOf(size_t slot) { return gradients_.data() + slot * dof_; }
+    void copyToIndividual(size_t slot, Individual& individual) const;
+    // Evaluates the genes of a slot through scratch_genes_.
+    double evaluate(size_t slot, CostFn const& cost_fn);
+    // Overwrites the genes and gradient of a child slot with a mutated mix of two parent slots.
+    void crossover(size_t child, size_t parentA, size_t parentB, Rng& rng);
+
    public:
     MemeticIk(std::vector<double> const& initial_guess, double cost, MemeticIkParams const& params);
     static MemeticIk from(std::vector<double> const& initial_guess,
                           CostFn const& cost_fn,
                           MemeticIkParams const& params);
 
-    Individual best() const { return best_; };
-    Individual bestCurrent() const { return best_curr_; };
+    Individual const& best() const { return best_; };
+    Individual const& bestCurrent() const { return best_curr_; };
     size_t eliteCount() const { return params_.elite_size; };
     bool checkWipeout();
     void computeExtinctions();
-    void gradientDescent(size_t const i,
-                         Robot const& robot,
-                         CostFn const& cost_fn,
-                         GradientIkParams const& gd_params);
+    // Returns the number of descent steps taken.
+    size_t gradientDescent(size_t const i,
+                           Robot const& robot,
+                           CostFn const& cost_fn,
+                           GradientIkParams const& gd_params,
+                           CostGradientFn const& gradient_fn = CostGradientFn(),
+                           StopFlags const& stop = {});
+    // If batch_cost_fn is given, the population is evaluated with it instead of cost_fn.
+    // Elites after the first start at the elite guesses, if any, and otherwise at random, or at
+    // the next points of params.halton if it is set, starting from a point drawn from rng.
     void initPopulation(Robot const& robot,
                         CostFn const& cost_fn,
-                        std::vector<double> const& initial_guess);
-    void reproduce(Robot const& robot, CostFn const& cost_fn);
+                        std::vector<double> const& initial_guess,
+                        Rng& rng,
+                        BatchCostFn const& batch_cost_fn = BatchCostFn(),
+                        std::vector<std::vector<double>> const& elite_guesses = {});
+    // Sends the best count individuals of the sorted population to another species.
+    void emigrate(MigrationRing& outbox, size_t count);
+    // Replaces the worst individuals by fitter immigrants and sorts the population again.
+    void immigrate(MigrationRing& inbox);
+    // If batch_cost_fn is given, all children are created first and then evaluated together.
+    void reproduce(Robot const& robot,
+                   CostFn const& cost_fn,
+                   Rng& rng,
+                   StopFlags const& stop = {},
+                   BatchCostFn const& batch_cost_fn = BatchCostFn());
     size_t populationCount() const { return params_.population_size; };
     void printPopulation() const;
     void sortPopulation();
@@ -92,15 +184,44 @@ auto ik_memetic_impl(std::vector<double> const& initial_guess,
                      MemeticIkParams const& params,
                      std::atomic<bool>& terminate,
                      bool approx_solution = false,
-                     bool print_debug = false) -> std::optional<Individual>;
+                     bool print_debug = false,
+                     CostGradientFn const& gradient_fn = CostGradientFn(),
+                     BatchCostFn const& batch_cost_fn = BatchCostFn(),
+                     ThreadPool* thread_pool = nullptr,
+                     MigrationRing* inbox = nullptr,
+                     MigrationRing* outbox = nullptr,
+                     std::vector<std::vector<double>> const& elite_guesses = {},
+                     std::atomic<bool> const* cancel = nullptr,
+                     SolveStats* stats = nullptr) -> std::optional<Individual>;
 
 // Top-level IK solution implementation that handles single vs. multithreading.
+// Species draw their random numbers from the streams of params.seed, so that a solve that runs
+// to max_generations on a single thread is reproducible.
+// If gradient_fn is empty, elite gradient descent computes gradients numerically from cost_fn.
+// If batch_cost_fn is given, it evaluates each generation's population in one call.
+// Species and elite gradient descent run on thread_pool; if it is null, a pool is created for
+// the duration of the call.
+// elite_guesses, such as the solutions of previous requests along a path, seed the initial elites
+// of every species next to the initial guess.
+// With stop_on_first_soln, the first valid solution is returned once its species finishes and the
+// other species, which are cancelled, have stopped within their current gradient descent or
+// reproduction step.
+// Setting cancel stops every species within its current gradient descent or reproduction step, as
+// if it had timed out.
+// If stats is given, the counters of every species are added to it, along with the species whose
+// solution is returned.
 auto ik_memetic(std::vector<double> const& initial_guess,
                 Robot const& robot,
                 CostFn const& cost_fn,
                 SolutionTestFn const& solution_fn,
                 MemeticIkParams const& params,
                 bool approx_solution = false,
-                bool print_debug = false) -> std::optional<std::vector<double>>;
+                bool print_debug = false,
+                CostGradientFn const& gradient_fn = CostGradientFn(),
+                BatchCostFn const& batch_cost_fn = BatchCostFn(),
+                ThreadPool* thread_pool = nullptr,
+                std::vector<std::vector<double>> const& elite_guesses = {},
+                std::shared_ptr<std::atomic<bool> const> cancel = nullptr,
+                SolveStats* stats = nullptr) -> std::optional<std::vector<double>>;
 
 }  // namespace pick_ik
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <pick_ik/robot.hpp>
+
+#include <geometry_msgs/msg/pose.hpp>
+#include <memory>
+#include <moveit/kinematics_base/kinematics_base.h>
+#include <moveit_msgs/msg/move_it_error_codes.hpp>
+#include <vector>
+
+namespace pick_ik {
+
+/**
+ * @brief Warm-start state of a stream of IK requests along a path.
+ * @details Keeps the latest solutions, so that each request can start from a seed extrapolated
+ * along the path and seed the memetic elites with the solutions of the previous requests.
+ */
+struct IkStream {
+    size_t history_size = 3;                     // Number of solutions kept.
+    std::vector<std::vector<double>> solutions;  // Latest solutions, the newest last.
+};
+
+/// Restarts a stream from a seed state, forgetting its previous solutions.
+auto reset(IkStream& self, std::vector<double> const& seed_state) -> void;
+
+/// Adds the solution of the latest request, dropping the oldest one if the history is full.
+auto record_solution(IkStream& self, std::vector<double> const& solution) -> void;
+
+/// Predicts the solution of the next request by linear extrapolation of the last two solutions,
+/// clamped to the variable limits.
+/// @return The predicted seed, or an empty vector if the stream has no solution yet.
+auto predict_seed(IkStream const& self, Robot const& robot) -> std::vector<double>;
+
+/**
+ * @brief Solves consecutive IK requests along a path, warm-started from the previous ones.
+ * @details Each request first runs a short local solve from the predicted seed, which is usually
+ * enough on dense paths and keeps the solutions close together, and only falls back to the
+ * configured solver if that fails. A session is not thread safe and must not outlive its solver.
+ */
+class IkStreamSession {
+   public:
+    virtual ~IkStreamSession() = default;
+
+    /**
+     * @brief Solves the next request of the stream.
+     * @param poses Goal poses of the tip frames.
+     * @param timeout Timeout of the request, in seconds.
+     * @param solution Set to the solution, or to the predicted seed if no solution was found.
+     * @param error_code Set to the result of the request.
+     * @param options Query options of the request.
+     * @return True if a solution was found.
+     */
+    virtual auto solve(std::vector<geometry_msgs::msg::Pose> const& poses,
+                       double timeout,
+                       std::vector<double>& solution,
+                       moveit_msgs::msg::MoveItErrorCodes& error_code,
+                       kinematics::KinematicsQueryOptions const& options =
+                           kinematics::KinematicsQueryOptions()) -> bool = 0;
+
+    /// Restarts the stream from a seed state, e.g. after a jump along the path.
+    virtual auto reset(std::vector<double> const& seed_state) -> void = 0;
+};
+
+/**
+ * @brief Interface of kinematics plugins that solve streams of IK requests along paths.
+ * @details The pick_ik plugin implements it, so callers can get it from a loaded
+ * kinematics::KinematicsBase with dynamic_cast.
+ */
+class StreamingIkSolver {
+   public:
+    virtual ~StreamingIkSolver() = default;
+
+    /// Starts a stream from a seed state, usually the current state of the robot.
+    virtual auto startIkStream(std::vector<double> const& seed_state) const
+        -> std::unique_ptr<IkStreamSession> = 0;
+};
+
+}  // namespace pick_ik
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace pick_ik {
+
+/// Seed of the stream-th of the independent random streams derived from seed.
+auto stream_seed(uint64_t seed, uint64_t stream) -> uint64_t;
+
+/**
+ * @brief xoshiro256++ random number generator, owned by a single solver thread.
+ * @details Drawing a number takes a few instructions, unlike the shared distributions of rsl, and
+ * the same seed gives the same numbers on every platform, so solves with a fixed seed are
+ * reproducible. Satisfies UniformRandomBitGenerator.
+ */
+class Rng {
+    uint64_t state_[4];
+
+    static auto rotl(uint64_t x, int k) -> uint64_t { return (x << k) | (x >> (64 - k)); }
+
+   public:
+    using result_type = uint64_t;
+
+    explicit Rng(uint64_t seed);
+
+    static constexpr auto min() -> result_type { return 0; }
+    static constexpr auto max() -> result_type { return std::numeric_limits<result_type>::max(); }
+
+    auto operator()() -> result_type {
+        auto const result = rotl(state_[0] + state_[3], 23) + state_[0];
+        auto const t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotl(state_[3], 45);
+        return result;
+    }
+
+    /// Uniform value in [min, max).
+    auto uniform_real(double min, double max) -> double {
+        // The top 53 bits fill the mantissa of a double in [0, 1).
+        auto const unit = static_cast<double>((*this)() >> 11) * 0x1.0p-53;
+        return min + (max - min) * unit;
+    }
+
+    /// Uniform value in [min, max].
+    auto uniform_int(size_t min, size_t max) -> size_t {
+        auto const range = uint64_t{max - min} + 1;
+        if (range == 0) {
+            return static_cast<size_t>((*this)());
+        }
+        // Rejecting the lowest 2^64 mod range values leaves a multiple of range, so the modulo
+        // below is unbiased.
+        auto const threshold = (0 - range) % range;
+        auto value = (*this)();
+        while (value < threshold) {
+            value = (*this)();
+        }
+        return min + static_cast<size_t>(value % range);
+    }
+};
+
+}  // namespace pick_ik
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <pick_ik/goal.hpp>
+#include <pick_ik/thread_pool.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace pick_ik {
+
+/// Solves from an initial guess, stopping early once cancel is set.
+using RestartSolverFn = std::function<std::optional<std::vector<double>>(
+    std::vector<double> const& initial_guess,
+    std::shared_ptr<std::atomic<bool> const> const& cancel)>;
+
+/// One solve of a restart portfolio: a solver, such as local or global IK, and where it starts.
+struct Restart {
+    RestartSolverFn solver_fn;
+    std::vector<double> initial_guess;
+};
+
+/// The solution of a restart portfolio and the index of the restart that found it.
+struct PortfolioSolution {
+    std::vector<double> solution;
+    size_t restart;
+};
+
+/**
+ * @brief Runs differently seeded solves at once on a thread pool.
+ * @details With stop_on_first_solution, the first solve to return a valid solution cancels the
+ * others. Otherwise the valid solution of lowest cost wins. If no solve returns a valid solution,
+ * the approximate solution of lowest cost is returned, if any solver returned one. Returns once
+ * every solve has finished, so solvers may reference the caller's state. If no pool is given, the
+ * solves run one after another on the calling thread.
+ */
+auto solve_portfolio(std::vector<Restart> const& restarts,
+                     CostFn const& cost_fn,
+                     SolutionTestFn const& solution_fn,
+                     bool stop_on_first_solution,
+                     ThreadPool* thread_pool) -> std::optional<PortfolioSolution>;
+
+}  // namespace pick_ik
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <pick_ik/random.hpp>
+
 #include <tl_expected/expected.hpp>
 
 #include <Eigen/Geometry>
@@ -27,7 +29,10 @@ struct Robot {
 
         /// @brief Generates a valid variable value given an optional initial value (for unbounded
         /// joints).
-        auto generate_valid_value(double init_val = 0.0) const -> double;
+        auto generate_valid_value(Rng& rng, double init_val = 0.0) const -> double;
+
+        /// @brief Maps a value in [0, 1) to the range that generate_valid_value samples from.
+        auto from_unit(double unit, double init_val = 0.0) const -> double;
 
         /// @brief Returns true if a value is valid given the variable bounds.
         auto is_valid(double val) const -> bool;
@@ -46,6 +51,9 @@ struct Robot {
      * @brief Sets a variable vector to a random configuration.
      * @details Here, "valid" denotes that the joint values are with their specified limits.
      */
+    auto set_random_valid_configuration(std::vector<double>& config, Rng& rng) const -> void;
+
+    /** @brief Same as above, drawing from a stream seeded by the global rsl generator. */
     auto set_random_valid_configuration(std::vector<double>& config) const -> void;
 
     /** @brief Check is a configuration is valid. */
@@ -71,4 +79,8 @@ auto transform_poses_to_frames(moveit::core::RobotState const& robot_state,
                                std::string const& base_frame_name)
     -> std::vector<Eigen::Isometry3d>;
 
+auto transform_poses_to_frames(Eigen::Isometry3d const& base_frame,
+                               std::vector<geometry_msgs::msg::Pose> const& poses)
+    -> std::vector<Eigen::Isometry3d>;
+
 }  // namespace pick_ik
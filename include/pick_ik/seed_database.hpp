@@ -0,0 +1,123 @@
+#pragma once
+
+#include <pick_ik/forward_kinematics.hpp>
+#include <pick_ik/robot.hpp>
+
+#include <tl_expected/expected.hpp>
+
+#include <Eigen/Geometry>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <moveit/robot_model/joint_model_group.h>
+#include <moveit/robot_model/robot_model.h>
+#include <string>
+#include <vector>
+
+namespace pick_ik {
+
+/**
+ * @brief Sampled configurations of a group and the poses of its first tip, indexed by position
+ * and by orientation.
+ * @details Tip poses are in the frame of the robot model, like the goal frames of the solvers, with
+ * the variables outside of the group at their default values. Each index is an implicit k-d tree:
+ * the samples of each subtree are a contiguous range of the array with the sample of its root in
+ * the middle. kd_tree splits on x, y and z in turn, and orientation_kd_tree on the w, x, y and z
+ * entries of the orientation. The arrays are read-only views of the storage, which is either built
+ * in memory or a file mapped by load_seed_database, so copies share them.
+ */
+struct SeedDatabase {
+    /// @brief Entries per tip pose: the position, then the orientation as w, x, y, z.
+    static constexpr size_t kPoseEntries = 7;
+    /// @brief Samples a database can hold, as the k-d tree stores 32-bit sample indices.
+    static constexpr size_t kMaxSamples = std::numeric_limits<uint32_t>::max();
+
+    std::string group_name;
+    std::string tip_link_name;
+    uint64_t model_hash = 0;  // get_model_hash of the group and tip.
+    size_t num_variables = 0;
+    size_t num_samples = 0;
+    double const* configurations = nullptr;  // Row-major samples x num_variables.
+    double const* tip_poses = nullptr;       // Row-major samples x kPoseEntries.
+    uint32_t const* kd_tree = nullptr;       // Sample indices in k-d tree order of positions.
+    uint32_t const* orientation_kd_tree = nullptr;  // Sample indices in orientation order.
+    std::shared_ptr<void const> storage;     // Keeps the arrays alive.
+
+    auto size() const -> size_t { return num_samples; }
+};
+
+/**
+ * @brief Hash of everything the samples of a seed database depend on.
+ * @details Covers the names, joint types, axes and fixed transforms of the links between the root
+ * and the tip, and the limits of the group variables, so a database is rejected once the robot
+ * description changes in a way that moves its samples.
+ */
+auto get_model_hash(std::shared_ptr<moveit::core::RobotModel const> const& model,
+                    moveit::core::JointModelGroup const* jmg,
+                    size_t tip_link_index) -> uint64_t;
+
+/** @brief Appends a frame to row-major tip poses, as kPoseEntries entries. */
+auto append_tip_pose(std::vector<double>& tip_poses, Eigen::Isometry3d const& frame) -> void;
+
+/**
+ * @brief Indexes configurations and the matching tip poses.
+ * @param configurations Row-major samples x num_variables.
+ * @param tip_poses Row-major samples x kPoseEntries.
+ * @return An error if the arrays do not hold the same samples, or more than kMaxSamples.
+ */
+auto make_seed_database(std::string group_name,
+                        std::string tip_link_name,
+                        uint64_t model_hash,
+                        size_t num_variables,
+                        std::vector<double> configurations,
+                        std::vector<double> tip_poses)
+    -> tl::expected<SeedDatabase, std::string>;
+
+/**
+ * @brief Samples random valid configurations of a group and indexes the poses of a tip.
+ * @param group_name Name of the group, stored to validate the database when it is loaded.
+ * @param tip_link_name Name of the tip link, stored to validate the database when it is loaded.
+ * @param model_hash get_model_hash of the group and tip, stored to validate the database.
+ * @param robot The group's variables.
+ * @param fk_fn Forward kinematics of the group.
+ * @param tip Index of the tip in the frames returned by fk_fn.
+ * @param count Number of samples.
+ * @return An error if count is more than kMaxSamples, before sampling.
+ */
+auto build_seed_database(std::string group_name,
+                         std::string tip_link_name,
+                         uint64_t model_hash,
+                         Robot const& robot,
+                         FkFn const& fk_fn,
+                         size_t tip,
+                         size_t count) -> tl::expected<SeedDatabase, std::string>;
+
+/**
+ * @brief Finds the samples whose tip poses are closest to a goal.
+ * @details Poses are compared like the pose cost of the solvers, by the scaled position and
+ * orientation distances. Candidates are found by position in kd_tree, or by orientation in
+ * orientation_kd_tree if the position is ignored.
+ * @return Up to count configurations, the closest first.
+ */
+auto find_seeds(SeedDatabase const& self,
+                Eigen::Isometry3d const& goal,
+                size_t count,
+                double position_scale,
+                double rotation_scale) -> std::vector<std::vector<double>>;
+
+/**
+ * @brief Writes a database and its index to a binary file.
+ * @details The arrays are aligned within the file, so load_seed_database can use them in place.
+ */
+auto save_seed_database(SeedDatabase const& self, std::string const& path)
+    -> tl::expected<void, std::string>;
+
+/**
+ * @brief Maps a file written by save_seed_database read-only into memory.
+ * @details Only the header is read up front, so loading takes the same time for any number of
+ * samples, and processes mapping the same file share its pages. The file must not be modified
+ * while it is mapped.
+ */
+auto load_seed_database(std::string const& path) -> tl::expected<SeedDatabase, std::string>;
+
+}  // namespace pick_ik
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Eigen/Geometry>
+#include <array>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace pick_ik {
+
+struct SolutionCacheParams {
+    size_t max_bytes = 0;  // Approximate memory budget of the entries.
+    // Goals match cached goals if every tip is within these distances. Unset tolerances ignore the
+    // position or the orientation, as for goals that do not constrain them.
+    std::optional<double> position_tolerance;
+    std::optional<double> orientation_tolerance;
+};
+
+struct SolutionCacheStats {
+    size_t hits = 0;       // Lookups that found a cached solution.
+    size_t misses = 0;     // Lookups that did not.
+    size_t evictions = 0;  // Entries dropped to stay within the memory budget.
+    size_t entries = 0;
+    size_t bytes = 0;
+};
+
+/**
+ * @brief Thread safe cache of IK solutions, looked up by nearest goal frames.
+ * @details Entries are indexed in a grid over the position of the first tip, with cells as large
+ * as the position tolerance, so a lookup only compares the goals of neighboring cells. Without a
+ * position tolerance, the grid is over the direction of the x axis of the first tip, with cells as
+ * large as the orientation tolerance. The least recently used entries are evicted once the entries
+ * exceed the memory budget.
+ */
+class SolutionCache {
+    using Cell = std::array<int64_t, 3>;
+    struct CellHash {
+        auto operator()(Cell const& cell) const -> size_t;
+    };
+
+    struct Entry {
+        std::vector<Eigen::Isometry3d> goal_frames;
+        std::vector<double> solution;
+        Cell cell;
+    };
+    using EntryIterator = std::list<Entry>::iterator;
+
+    SolutionCacheParams params_;
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_;  // The most recently used first.
+    std::unordered_map<Cell, std::vector<EntryIterator>, CellHash> grid_;
+    SolutionCacheStats stats_;
+
+    auto get_cell(std::vector<Eigen::Isometry3d> const& goal_frames) const -> Cell;
+    // Closest entry whose goals match, or entries_.end().
+    auto find_nearest(std::vector<Eigen::Isometry3d> const& goal_frames) -> EntryIterator;
+    auto entry_bytes(Entry const& entry) const -> size_t;
+    auto evict(EntryIterator entry) -> void;
+
+   public:
+    explicit SolutionCache(SolutionCacheParams params);
+
+    /// Returns the solution of the closest matching cached goal, marking it as recently used.
+    auto find(std::vector<Eigen::Isometry3d> const& goal_frames)
+        -> std::optional<std::vector<double>>;
+
+    /// Adds the solution of a goal, replacing the closest matching cached goal and its solution.
+    auto insert(std::vector<Eigen::Isometry3d> const& goal_frames,
+                std::vector<double> const& solution) -> void;
+
+    auto stats() const -> SolutionCacheStats;
+
+    /// Copies the cached goals and their solutions, the most recently used first.
+    auto entries() const
+        -> std::vector<std::pair<std::vector<Eigen::Isometry3d>, std::vector<double>>>;
+};
+
+/**
+ * @brief Interface of kinematics plugins with a cache of solutions.
+ * @details The pick_ik plugin implements it, so callers can get it from a loaded
+ * kinematics::KinematicsBase with dynamic_cast.
+ */
+class CachingIkSolver {
+   public:
+    virtual ~CachingIkSolver() = default;
+
+    /// Counters of the solution cache since the solver settings last changed.
+    virtual auto getSolutionCacheStats() const -> SolutionCacheStats = 0;
+
+    /// Writes the cached solutions as a seed database over the goals of the first tip, so later
+    /// runs can seed the global solver with them. Returns false if the file cannot be written.
+    virtual auto saveSolutionCache(std::string const& path) const -> bool = 0;
+};
+
+}  // namespace pick_ik
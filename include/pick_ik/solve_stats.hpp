@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace pick_ik {
+
+/**
+ * @brief Counters of one or more solves, filled in by the solvers that are given a pointer to them.
+ * @details The solvers only add to the counters, so one instance can sum up several solves. Times
+ * are in seconds and only cover the memetic solver.
+ */
+struct SolveStats {
+    size_t solves = 0;                 // Requests solved by the plugin.
+    size_t successes = 0;              // Requests that found a valid solution.
+    size_t restarts = 0;               // Solves from another seed after the first one failed.
+    size_t generations = 0;            // Memetic generations, summed over the species.
+    size_t wipeouts = 0;               // Memetic populations reinitialized for lack of progress.
+    size_t gradient_iterations = 0;    // Gradient descent steps, including those on memetic elites.
+    size_t cost_evaluations = 0;       // Calls of the cost function and its gradient.
+    size_t fk_evaluations = 0;         // Configurations whose frames were computed.
+    double descent_time = 0.0;         // Gradient descent on memetic elites.
+    double reproduction_time = 0.0;    // Memetic mutation and recombination.
+    double sort_time = 0.0;            // Memetic population sorting.
+    std::vector<size_t> species_wins;  // Solutions returned by each memetic species.
+};
+
+/// Adds the counters of other to self.
+auto merge(SolveStats& self, SolveStats const& other) -> void;
+
+/// Evaluation counters shared by the functions of a solve, which may run on several threads.
+struct EvaluationCounters {
+    std::atomic<size_t> cost_evaluations{0};
+    std::atomic<size_t> fk_evaluations{0};
+};
+
+}  // namespace pick_ik
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace pick_ik {
+
+/**
+ * @brief Returns an object of type T that is private to the calling thread and tied to an owner.
+ * @details The object is created with make() the first time a thread asks for it and is reused on
+ * every later call from that thread, so it can be used as scratch space without any locking.
+ * Objects belonging to owners that have since been destroyed are released the next time the
+ * calling thread creates a new object.
+ */
+template <typename T, typename Owner, typename MakeFn>
+auto get_thread_local(std::shared_ptr<Owner const> const& owner, MakeFn&& make) -> T& {
+    struct Entry {
+        std::weak_ptr<void const> owner;
+        std::unique_ptr<T> value;
+    };
+    thread_local std::vector<Entry> entries;
+
+    // Entries hold on to the control block of their owner, so comparing control blocks is safe
+    // even after the owner itself has been destroyed.
+    for (auto& entry : entries) {
+        if (!entry.owner.owner_before(owner) && !owner.owner_before(entry.owner)) {
+            return *entry.value;
+        }
+    }
+
+    entries.erase(std::remove_if(entries.begin(),
+                                 entries.end(),
+                                 [](Entry const& entry) { return entry.owner.expired(); }),
+                  entries.end());
+    entries.push_back(Entry{owner, std::make_unique<T>(make())});
+    return *entries.back().value;
+}
+
+}  // namespace pick_ik
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pick_ik {
+
+/** @brief A fixed set of long-lived worker threads that execute submitted tasks in FIFO order. */
+class ThreadPool {
+   public:
+    explicit ThreadPool(size_t num_threads);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    /** @brief Queues a task for execution on one of the worker threads. */
+    void submit(std::function<void()> task);
+
+    size_t size() const { return threads_.size(); };
+
+   private:
+    void work();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    bool stop_ = false;
+    std::vector<std::thread> threads_;
+};
+
+/**
+ * @brief A set of tasks run on a ThreadPool that can be waited on together.
+ * @details While waiting, the calling thread runs tasks of this group that no worker has picked up
+ * yet. A task can therefore wait on a nested group even when every worker of the pool is busy,
+ * e.g. a memetic species waiting on its elite gradient descent tasks. If no pool is given, tasks
+ * run when wait() is called. The destructor waits for all tasks.
+ */
+class TaskGroup {
+   public:
+    explicit TaskGroup(ThreadPool* pool);
+    ~TaskGroup();
+
+    TaskGroup(TaskGroup const&) = delete;
+    TaskGroup& operator=(TaskGroup const&) = delete;
+
+    void run(std::function<void()> task);
+
+    /** @brief Blocks until every task of the group has finished. */
+    void wait();
+
+    /**
+     * @brief Blocks until every task of the group has finished or done() returns true.
+     * @details done() is checked before running each pending task and whenever a task finishes.
+     * @return True if every task has finished.
+     */
+    bool wait_until(std::function<bool()> const& done);
+
+   private:
+    struct State {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::function<void()>> pending;
+        size_t unfinished = 0;
+    };
+
+    // Runs one pending task of the group, if any is left. Returns false if none was.
+    static bool run_pending(State& state);
+
+    ThreadPool* pool_;
+    std::shared_ptr<State> state_;
+};
+
+/**
+ * @brief Calls fn(i) for every i in [0, count), spread over the pool and the calling thread.
+ * @details Every runner claims the next index from a shared counter as soon as it finishes one, so
+ * runners that get quick items take over the remaining work of runners stuck on slow ones. Returns
+ * once every call has finished. If no pool is given, all calls run on the calling thread.
+ */
+void parallel_for(ThreadPool* pool, size_t count, std::function<void(size_t)> const& fn);
+
+}  // namespace pick_ik
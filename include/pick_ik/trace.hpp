@@ -0,0 +1,114 @@
+#pragma once
+
+#include <tl_expected/expected.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace pick_ik {
+
+/// Whether tracepoints record anything, set by the PICK_IK_TRACING CMake option.
+#ifdef PICK_IK_TRACING
+constexpr bool kTracingEnabled = true;
+#else
+constexpr bool kTracingEnabled = false;
+#endif
+
+namespace trace {
+
+/// A completed scope, named by a string literal.
+struct Event {
+    // Odd while the event with index (sequence - 1) / 2 is written, 2 * index + 2 once it is.
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<char const*> name{nullptr};
+    std::atomic<int64_t> start_ns{0};
+    std::atomic<int64_t> duration_ns{0};
+};
+
+/**
+ * @brief Ring buffer of the most recent events of one thread.
+ * @details Only the owning thread writes events, so recording takes no lock. Each event is a
+ * seqlock: the fields are relaxed atomics, which compile to plain stores, between two stores of
+ * its sequence number, and flushing from another thread drops the events whose sequence number
+ * changed while they were read.
+ */
+struct ThreadBuffer {
+    static constexpr size_t kCapacity = size_t{1} << 14;
+
+    Event events[kCapacity];
+    std::atomic<uint64_t> head{0};   // Number of events ever written.
+    std::atomic<uint64_t> first{0};  // Events before this one were cleared.
+    uint32_t thread_id = 0;
+};
+
+/// Creates a buffer for the calling thread and registers it for flushing.
+auto register_thread_buffer() -> ThreadBuffer*;
+
+/// Buffer of the calling thread. Buffers stay registered after their thread exits, so that its
+/// events can still be flushed.
+inline auto get_thread_buffer() -> ThreadBuffer& {
+    thread_local ThreadBuffer* const buffer = register_thread_buffer();
+    return *buffer;
+}
+
+inline auto now_ns() -> int64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/// Records the time between its construction and destruction as an event of the calling thread.
+class Scope {
+    char const* name_;
+    int64_t start_ns_;
+
+   public:
+    explicit Scope(char const* name) : name_(name), start_ns_(now_ns()) {}
+    ~Scope() {
+        auto const end_ns = now_ns();
+        auto& buffer = get_thread_buffer();
+        auto const index = buffer.head.load(std::memory_order_relaxed);
+        auto& event = buffer.events[index % ThreadBuffer::kCapacity];
+        event.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        // Orders the odd sequence number before the fields, for a reader that sees new fields.
+        std::atomic_thread_fence(std::memory_order_release);
+        event.name.store(name_, std::memory_order_relaxed);
+        event.start_ns.store(start_ns_, std::memory_order_relaxed);
+        event.duration_ns.store(end_ns - start_ns_, std::memory_order_relaxed);
+        event.sequence.store(2 * index + 2, std::memory_order_release);
+        buffer.head.store(index + 1, std::memory_order_release);
+    }
+
+    Scope(Scope const&) = delete;
+    Scope& operator=(Scope const&) = delete;
+};
+
+}  // namespace trace
+
+/**
+ * @brief Writes the recorded events of every thread as a Chrome trace, which chrome://tracing and
+ * Perfetto open.
+ * @details Each thread keeps its most recent events only. Without PICK_IK_TRACING the trace is
+ * empty.
+ */
+auto write_chrome_trace(std::string const& path) -> tl::expected<void, std::string>;
+
+/// Drops the events recorded so far, for example to trace a single solve.
+auto clear_trace() -> void;
+
+}  // namespace pick_ik
+
+#define PICK_IK_TRACE_CONCAT_IMPL(a, b) a##b
+#define PICK_IK_TRACE_CONCAT(a, b) PICK_IK_TRACE_CONCAT_IMPL(a, b)
+
+/// Traces the rest of the enclosing scope under name, which must be a string literal. Compiles to
+/// nothing unless PICK_IK_TRACING is defined.
+#ifdef PICK_IK_TRACING
+#define PICK_IK_TRACE_SCOPE(name) \
+    ::pick_ik::trace::Scope PICK_IK_TRACE_CONCAT(pick_ik_trace_scope_, __COUNTER__)(name)
+#else
+#define PICK_IK_TRACE_SCOPE(name) static_cast<void>(0)
+#endif
@@ -0,0 +1,227 @@
+#include <pick_ik/cost_evaluator.hpp>
+#include <pick_ik/forward_kinematics.hpp>
+#include <pick_ik/goal.hpp>
+#include <pick_ik/robot.hpp>
+#include <pick_ik/solve_stats.hpp>
+#include <pick_ik/thread_local_cache.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace pick_ik {
+
+auto PoseCost::operator()(Eigen::Isometry3d const& tip_frame) const -> double {
+    auto cost = 0.0;
+    if (position_scale > 0.0) {
+        cost += std::pow(linear_distance(goal, tip_frame) * position_scale, 2);
+    }
+    if (rotation_scale > 0.0) {
+        cost += std::pow(angular_distance(goal, tip_frame) * rotation_scale, 2);
+    }
+    return cost;
+}
+
+auto CenterJointsCost::from(Robot const& robot) -> CenterJointsCost {
+    auto cost = CenterJointsCost{};
+    for (size_t i = 0; i < robot.variables.size(); ++i) {
+        auto const& variable = robot.variables[i];
+        if (!variable.bounded) {
+            continue;
+        }
+        cost.variables.push_back(i);
+        cost.mids.push_back((variable.min + variable.max) * 0.5);
+        cost.factors.push_back(variable.minimal_displacement_factor);
+    }
+    return cost;
+}
+
+auto CenterJointsCost::operator()(std::vector<double> const& active_positions) const -> double {
+    double sum = 0;
+    for (size_t i = 0; i < variables.size(); ++i) {
+        auto const position = active_positions[variables[i]];
+        sum += std::pow((position - mids[i]) * factors[i], 2);
+    }
+    return sum;
+}
+
+auto AvoidJointLimitsCost::from(Robot const& robot) -> AvoidJointLimitsCost {
+    auto cost = AvoidJointLimitsCost{};
+    for (size_t i = 0; i < robot.variables.size(); ++i) {
+        auto const& variable = robot.variables[i];
+        if (!variable.bounded) {
+            continue;
+        }
+        cost.variables.push_back(i);
+        cost.mids.push_back(variable.mid);
+        cost.half_spans.push_back(variable.half_span);
+        cost.factors.push_back(variable.minimal_displacement_factor);
+    }
+    return cost;
+}
+
+auto AvoidJointLimitsCost::operator()(std::vector<double> const& active_positions) const
+    -> double {
+    double sum = 0;
+    for (size_t i = 0; i < variables.size(); ++i) {
+        auto const position = active_positions[variables[i]];
+        sum += std::pow(
+            std::fmax(0.0, std::fabs(position - mids[i]) * 2.0 - half_spans[i]) * factors[i], 2);
+    }
+    return sum;
+}
+
+auto MinimalDisplacementCost::from(Robot const& robot, std::vector<double> initial_guess)
+    -> MinimalDisplacementCost {
+    assert(initial_guess.size() == robot.variables.size());
+    auto cost = MinimalDisplacementCost{std::move(initial_guess), {}};
+    for (auto const& variable : robot.variables) {
+        cost.factors.push_back(variable.minimal_displacement_factor);
+    }
+    return cost;
+}
+
+auto MinimalDisplacementCost::operator()(std::vector<double> const& active_positions) const
+    -> double {
+    double sum = 0;
+    assert(active_positions.size() == initial_guess.size());
+    for (size_t i = 0; i < active_positions.size(); ++i) {
+        sum += std::pow((active_positions[i] - initial_guess[i]) * factors[i], 2);
+    }
+    return sum;
+}
+
+auto GoalTerm::operator()(std::vector<double> const& active_positions) const -> double {
+    return std::visit([&](auto const& fn) { return fn(active_positions); }, cost) *
+           std::pow(weight, 2);
+}
+
+auto to_goal(GoalTerm term) -> Goal {
+    auto const weight = term.weight;
+    return Goal{std::visit([](auto&& fn) -> CostFn { return std::move(fn); }, std::move(term.cost)),
+                weight};
+}
+
+auto to_goals(std::vector<GoalTerm> const& terms) -> std::vector<Goal> {
+    auto goals = std::vector<Goal>{};
+    goals.reserve(terms.size());
+    for (auto const& term : terms) {
+        goals.push_back(to_goal(term));
+    }
+    return goals;
+}
+
+auto CostEvaluator::from(std::shared_ptr<KinematicChain const> chain,
+                         std::vector<Eigen::Isometry3d> const& goal_frames,
+                         double position_scale,
+                         double rotation_scale,
+                         std::vector<GoalTerm> goal_terms) -> CostEvaluator {
+    assert(goal_frames.size() == chain->tips.size());
+    auto evaluator = CostEvaluator{};
+    for (size_t i = 0; i < goal_frames.size(); ++i) {
+        evaluator.pose_terms.push_back(PoseCost{i, goal_frames[i], position_scale, rotation_scale});
+    }
+    evaluator.frames = ChainFrames::from(*chain);
+    evaluator.pose_costs.resize(evaluator.pose_terms.size());
+    evaluator.goal_costs.resize(goal_terms.size());
+    evaluator.goal_terms = std::move(goal_terms);
+    evaluator.chain = std::move(chain);
+    return evaluator;
+}
+
+auto evaluate(CostEvaluator& self, std::vector<double> const& active_positions) -> double {
+    update_frames(*self.chain, self.frames, active_positions);
+
+    auto pose_cost = 0.0;
+    for (size_t i = 0; i < self.pose_terms.size(); ++i) {
+        auto const& term = self.pose_terms[i];
+        self.pose_costs[i] = term(tip_frame(self, term.tip));
+        pose_cost += self.pose_costs[i];
+    }
+
+    auto goal_cost = 0.0;
+    for (size_t i = 0; i < self.goal_terms.size(); ++i) {
+        self.goal_costs[i] = self.goal_terms[i](active_positions);
+        goal_cost += self.goal_costs[i];
+    }
+
+    self.cost = pose_cost + goal_cost;
+    return self.cost;
+}
+
+auto tip_frame(CostEvaluator const& self, size_t tip) -> Eigen::Isometry3d const& {
+    return get_tip_frame(*self.chain, self.frames, tip);
+}
+
+auto make_cost_fn(CostEvaluator evaluator) -> CostFn {
+    auto const prototype = std::make_shared<CostEvaluator const>(std::move(evaluator));
+    return [prototype](std::vector<double> const& active_positions) {
+        auto& self = get_thread_local<CostEvaluator>(prototype, [&] { return *prototype; });
+        return evaluate(self, active_positions);
+    };
+}
+
+namespace {
+// The compiled evaluator of a thread and the last configuration it evaluated.
+struct LastCompiledEvaluation {
+    CostEvaluator evaluator;
+    std::vector<double> active_positions;
+    bool valid = false;
+    bool tested = false;  // Whether is_solution has been computed.
+    bool is_solution = false;
+};
+}  // namespace
+
+auto make_evaluation_fns(CostEvaluator evaluator,
+                         std::vector<FrameTestFn> frame_tests,
+                         double cost_threshold,
+                         std::shared_ptr<EvaluationCounters> counters) -> EvaluationFns {
+    assert(frame_tests.size() == evaluator.pose_terms.size());
+    auto const prototype = std::make_shared<CostEvaluator const>(std::move(evaluator));
+    auto const last_evaluation = [prototype, counters](std::vector<double> const& active_positions)
+        -> LastCompiledEvaluation& {
+        auto& last = get_thread_local<LastCompiledEvaluation>(
+            prototype, [&] { return LastCompiledEvaluation{*prototype, {}, false, false, false}; });
+        if (!last.valid || last.active_positions != active_positions) {
+            if (counters) {
+                counters->fk_evaluations.fetch_add(1, std::memory_order_relaxed);
+            }
+            evaluate(last.evaluator, active_positions);
+            last.active_positions = active_positions;
+            last.valid = true;
+            last.tested = false;
+        }
+        return last;
+    };
+
+    auto const cost_threshold_sq = std::pow(cost_threshold, 2);
+    return EvaluationFns{
+        [last_evaluation, counters](std::vector<double> const& active_positions) {
+            if (counters) {
+                counters->cost_evaluations.fetch_add(1, std::memory_order_relaxed);
+            }
+            return last_evaluation(active_positions).evaluator.cost;
+        },
+        [last_evaluation, frame_tests = std::move(frame_tests), cost_threshold_sq](
+            std::vector<double> const& active_positions) {
+            auto& last = last_evaluation(active_positions);
+            if (!last.tested) {
+                auto const& self = last.evaluator;
+                last.is_solution = true;
+                for (size_t i = 0; i < frame_tests.size() && last.is_solution; ++i) {
+                    last.is_solution = frame_tests[i](tip_frame(self, i));
+                }
+                for (size_t i = 0; i < self.goal_costs.size() && last.is_solution; ++i) {
+                    last.is_solution = self.goal_costs[i] < cost_threshold_sq;
+                }
+                last.tested = true;
+            }
+            return last.is_solution;
+        }};
+}
+
+}  // namespace pick_ik
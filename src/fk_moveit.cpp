@@ -1,4 +1,5 @@
 #include <pick_ik/fk_moveit.hpp>
+#include <pick_ik/thread_local_cache.hpp>
 
 #include <algorithm>
 #include <memory>
@@ -8,26 +9,38 @@
 
 namespace pick_ik {
 
+namespace {
+struct FkContext {
+    std::shared_ptr<moveit::core::RobotModel const> robot_model;
+    moveit::core::JointModelGroup const* jmg;
+    std::vector<size_t> tip_link_indices;
+};
+}  // namespace
+
 auto make_fk_fn(std::shared_ptr<moveit::core::RobotModel const> robot_model,
                 moveit::core::JointModelGroup const* jmg,
-                std::mutex& mx,
                 std::vector<size_t> tip_link_indices) -> FkFn {
-    auto robot_state = moveit::core::RobotState(robot_model);
-    robot_state.setToDefaultValues();
+    auto const context = std::make_shared<FkContext const>(
+        FkContext{std::move(robot_model), jmg, std::move(tip_link_indices)});
 
-    // IK function is mutable so it re-uses the robot_state instead of creating
-    // new copies. This function accepts a mutex so that it can be made thread-safe.
-    return [=, &mx](std::vector<double> const& active_positions) mutable {
-        std::scoped_lock lock(mx);
-        robot_state.setJointGroupPositions(jmg, active_positions);
+    // Each thread re-uses its own robot_state instead of creating new copies, so solver threads
+    // can evaluate FK concurrently without sharing a lock.
+    return [context](std::vector<double> const& active_positions) {
+        auto& robot_state = get_thread_local<moveit::core::RobotState>(context, [&] {
+            auto state = moveit::core::RobotState(context->robot_model);
+            state.setToDefaultValues();
+            return state;
+        });
+        robot_state.setJointGroupPositions(context->jmg, active_positions);
         robot_state.updateLinkTransforms();
 
         std::vector<Eigen::Isometry3d> tip_frames;
-        std::transform(tip_link_indices.cbegin(),
-                       tip_link_indices.cend(),
+        tip_frames.reserve(context->tip_link_indices.size());
+        std::transform(context->tip_link_indices.cbegin(),
+                       context->tip_link_indices.cend(),
                        std::back_inserter(tip_frames),
                        [&](auto index) {
-                           auto const* link_model = robot_model->getLinkModel(index);
+                           auto const* link_model = context->robot_model->getLinkModel(index);
                            return robot_state.getGlobalLinkTransform(link_model);
                        });
         return tip_frames;
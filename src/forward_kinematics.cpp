@@ -1,10 +1,13 @@
 #include <pick_ik/forward_kinematics.hpp>
+#include <pick_ik/thread_local_cache.hpp>
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <iterator>
 #include <memory>
 #include <moveit/robot_model/robot_model.h>
+#include <optional>
 #include <tf2/LinearMath/Vector3.h>
 #include <vector>
 
@@ -29,9 +32,10 @@ auto make_joint_axes(std::shared_ptr<moveit::core::RobotModel const> const& mode
 auto make_link_frames(std::shared_ptr<moveit::core::RobotModel const> const& model)
     -> std::vector<Eigen::Isometry3d> {
     std::vector<Eigen::Isometry3d> link_frames;
+    link_frames.reserve(model->getLinkModels().size());
     std::transform(model->getLinkModels().cbegin(),
                    model->getLinkModels().cend(),
-                   link_frames.begin(),
+                   std::back_inserter(link_frames),
                    [](auto* link_model) { return link_model->getJointOriginTransform(); });
     return link_frames;
 }
@@ -62,11 +66,11 @@ auto get_frame(moveit::core::JointModel const& joint_model,
                 Eigen::Translation3d(axis.x() * v, axis.y() * v, axis.z() * v));
         }
         case moveit::core::JointModel::FLOATING: {
-            assert(joint_model.getFirstVariableIndex() + 6 >= variables.size());
+            assert(joint_model.getFirstVariableIndex() + 7 <= variables.size());
             auto const* vv = variables.data() + joint_model.getFirstVariableIndex();
             // Note that Eigen uses (w, x, y, z) for quaternion notation.
             return Eigen::Translation3d(vv[0], vv[1], vv[2]) *
-                   Eigen::Quaterniond(vv[6], vv[3], vv[4], vv[5]);
+                   Eigen::Quaterniond(vv[6], vv[3], vv[4], vv[5]).normalized();
         }
         case moveit::core::JointModel::PLANAR:
         case moveit::core::JointModel::UNKNOWN:
@@ -124,4 +128,413 @@ auto get_frame(CachedJointFrames& cache,
     return cache.frames.at(index);
 }
 
+auto KinematicChain::from(std::shared_ptr<moveit::core::RobotModel const> const& model,
+                          moveit::core::JointModelGroup const* jmg,
+                          std::vector<size_t> const& tip_link_indices) -> KinematicChain {
+    auto chain = KinematicChain{};
+    chain.robot_model = model;
+    chain.joint_axes = make_joint_axes(model);
+    chain.link_frames = make_link_frames(model);
+    model->getVariableDefaultPositions(chain.default_variables);
+    for (auto const index : jmg->getVariableIndexList()) {
+        chain.group_variable_indices.push_back(static_cast<size_t>(index));
+    }
+
+    // A joint moves if its variables (or those of the joint it mimics) belong to the group.
+    auto group_variable = std::vector<std::optional<size_t>>(model->getVariableCount());
+    for (size_t i = 0; i < chain.group_variable_indices.size(); ++i) {
+        group_variable[chain.group_variable_indices[i]] = i;
+    }
+    auto const joint_moves = [&](moveit::core::JointModel const& joint_model) {
+        auto const* source = joint_model.getMimic() ? joint_model.getMimic() : &joint_model;
+        size_t const i0 = source->getFirstVariableIndex();
+        for (size_t i = i0; i < i0 + source->getVariableCount(); ++i) {
+            if (group_variable[i].has_value()) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Walk from the root towards each tip. Links that do not move get their global frame
+    // computed once here, and links that do move are appended to the chain.
+    auto chain_index = std::vector<std::optional<size_t>>(model->getLinkModelCount());
+    auto fixed_frames = std::vector<std::optional<Eigen::Isometry3d>>(model->getLinkModelCount());
+    for (auto tip_index : tip_link_indices) {
+        auto path = std::vector<moveit::core::LinkModel const*>{};
+        for (auto const* link_model = model->getLinkModel(tip_index); link_model != nullptr;
+             link_model = link_model->getParentLinkModel()) {
+            path.push_back(link_model);
+        }
+
+        std::optional<size_t> parent = std::nullopt;
+        Eigen::Isometry3d parent_frame = Eigen::Isometry3d::Identity();
+        auto tip_path = std::vector<size_t>{};
+        for (auto it = path.crbegin(); it != path.crend(); ++it) {
+            auto const* link_model = *it;
+            size_t const link_index = link_model->getLinkIndex();
+            if (chain_index[link_index].has_value()) {
+                parent = chain_index[link_index];
+                tip_path.push_back(parent.value());
+                continue;
+            }
+            if (fixed_frames[link_index].has_value()) {
+                parent_frame = fixed_frames[link_index].value();
+                continue;
+            }
+
+            auto const* joint_model = link_model->getParentJointModel();
+            if (!parent.has_value() && !joint_moves(*joint_model)) {
+                parent_frame = parent_frame * get_frame(*link_model, chain.link_frames) *
+                               get_frame(*joint_model, chain.default_variables, chain.joint_axes);
+                fixed_frames[link_index] = parent_frame;
+                continue;
+            }
+
+            // Only 1-DOF joints get a Jacobian column.
+            auto const* source = joint_model->getMimic() ? joint_model->getMimic() : joint_model;
+            std::optional<size_t> variable = std::nullopt;
+            if (source->getVariableCount() == 1) {
+                variable = group_variable[source->getFirstVariableIndex()];
+            }
+            double const variable_factor =
+                joint_model->getMimic() ? joint_model->getMimicFactor() : 1.0;
+            auto const type = joint_model->getType();
+            if (type != moveit::core::JointModel::FIXED &&
+                type != moveit::core::JointModel::REVOLUTE &&
+                type != moveit::core::JointModel::PRISMATIC) {
+                chain.has_analytic_jacobian = false;
+            }
+
+            chain.links.push_back(
+                Link{link_model, joint_model, parent, parent_frame, variable, variable_factor});
+            if (joint_model->getMimic() != nullptr) {
+                chain.mimic_joints.push_back(joint_model);
+            }
+            parent = chain.links.size() - 1;
+            chain_index[link_index] = parent;
+            tip_path.push_back(parent.value());
+        }
+
+        chain.tips.push_back(Tip{parent, parent_frame, tip_path});
+    }
+
+    return chain;
+}
+
+auto ChainFrames::from(KinematicChain const& chain) -> ChainFrames {
+    auto cache = ChainFrames{};
+    cache.variables = chain.default_variables;
+    cache.working = chain.default_variables;
+    cache.frames.resize(chain.links.size(), Eigen::Isometry3d::Identity());
+    cache.updated.resize(chain.links.size(), true);
+    cache.valid = false;
+    return cache;
+}
+
+auto update_frames(KinematicChain const& chain,
+                   ChainFrames& cache,
+                   std::vector<double> const& active_positions) -> void {
+    assert(active_positions.size() == chain.group_variable_indices.size());
+    for (size_t i = 0; i < active_positions.size(); ++i) {
+        cache.working[chain.group_variable_indices[i]] = active_positions[i];
+    }
+    for (auto const* joint_model : chain.mimic_joints) {
+        auto const* source = joint_model->getMimic();
+        cache.working[joint_model->getFirstVariableIndex()] =
+            joint_model->getMimicFactor() * cache.working[source->getFirstVariableIndex()] +
+            joint_model->getMimicOffset();
+    }
+
+    // Links are ordered parent first, so a moved joint invalidates everything after it on its
+    // branch by way of the updated flags.
+    for (size_t i = 0; i < chain.links.size(); ++i) {
+        auto const& link = chain.links[i];
+        bool const parent_updated = link.parent.has_value() && cache.updated[link.parent.value()];
+        bool const joint_moved =
+            link.joint_model->getVariableCount() > 0 &&
+            has_joint_moved(*link.joint_model, cache.variables, cache.working);
+        cache.updated[i] = !cache.valid || parent_updated || joint_moved;
+        if (!cache.updated[i]) {
+            continue;
+        }
+
+        auto const& parent_frame =
+            link.parent.has_value() ? cache.frames[link.parent.value()] : link.fixed_parent_frame;
+        cache.frames[i] = parent_frame * get_frame(*link.link_model, chain.link_frames) *
+                          get_frame(*link.joint_model, cache.working, chain.joint_axes);
+    }
+
+    // Variables outside the group never change, so the old values can be reused as scratch space.
+    std::swap(cache.variables, cache.working);
+    cache.valid = true;
+}
+
+auto get_tip_frames(KinematicChain const& chain,
+                    ChainFrames const& cache,
+                    std::vector<Eigen::Isometry3d>& tip_frames) -> void {
+    tip_frames.resize(chain.tips.size());
+    for (size_t i = 0; i < chain.tips.size(); ++i) {
+        tip_frames[i] = get_tip_frame(chain, cache, i);
+    }
+}
+
+auto get_tip_frame(KinematicChain const& chain, ChainFrames const& cache, size_t tip)
+    -> Eigen::Isometry3d const& {
+    auto const& chain_tip = chain.tips[tip];
+    return chain_tip.link.has_value() ? cache.frames[chain_tip.link.value()]
+                                      : chain_tip.fixed_frame;
+}
+
+auto compute_jacobians(KinematicChain const& chain,
+                       ChainFrames const& cache,
+                       std::vector<Jacobian>& jacobians) -> void {
+    assert(chain.has_analytic_jacobian);
+    auto const cols = static_cast<Eigen::Index>(chain.group_variable_indices.size());
+    jacobians.resize(chain.tips.size());
+    for (size_t t = 0; t < chain.tips.size(); ++t) {
+        auto& jacobian = jacobians[t];
+        jacobian.setZero(6, cols);
+
+        auto const& tip = chain.tips[t];
+        if (!tip.link.has_value()) {
+            continue;
+        }
+        Eigen::Vector3d const tip_position = cache.frames[tip.link.value()].translation();
+
+        for (auto const i : tip.path) {
+            auto const& link = chain.links[i];
+            if (!link.variable.has_value()) {
+                continue;
+            }
+
+            // Joint motion does not change the joint axis, so the link frame can be used for it.
+            auto const& frame = cache.frames[i];
+            auto const& axis = chain.joint_axes[link.joint_model->getJointIndex()];
+            Eigen::Vector3d const world_axis =
+                frame.linear() * Eigen::Vector3d(axis.x(), axis.y(), axis.z());
+            auto column = jacobian.col(static_cast<Eigen::Index>(link.variable.value()));
+            switch (link.joint_model->getType()) {
+                case moveit::core::JointModel::REVOLUTE:
+                    column.head<3>() +=
+                        link.variable_factor * world_axis.cross(tip_position - frame.translation());
+                    column.tail<3>() += link.variable_factor * world_axis;
+                    break;
+                case moveit::core::JointModel::PRISMATIC:
+                    column.head<3>() += link.variable_factor * world_axis;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+namespace {
+
+// Sets frame = constant for all configurations.
+auto fill_frame(BatchChainFrames& cache, size_t link, Eigen::Isometry3d const& constant) -> void {
+    auto const& rotation = constant.linear();
+    auto const& translation = constant.translation();
+    for (size_t col = 0; col < 3; ++col) {
+        for (size_t row = 0; row < 3; ++row) {
+            auto* const out = cache.entry(link, col * 3 + row);
+            std::fill(out,
+                      out + cache.count,
+                      rotation(static_cast<Eigen::Index>(row), static_cast<Eigen::Index>(col)));
+        }
+    }
+    for (size_t row = 0; row < 3; ++row) {
+        auto* const out = cache.entry(link, 9 + row);
+        std::fill(out, out + cache.count, translation(static_cast<Eigen::Index>(row)));
+    }
+}
+
+// Sets frame = parent * local for all configurations.
+auto compose_frame(BatchChainFrames& cache,
+                   size_t link,
+                   size_t parent,
+                   Eigen::Isometry3d const& local) -> void {
+    double l[BatchChainFrames::kFrameEntries];
+    for (size_t col = 0; col < 3; ++col) {
+        for (size_t row = 0; row < 3; ++row) {
+            l[col * 3 + row] =
+                local.linear()(static_cast<Eigen::Index>(row), static_cast<Eigen::Index>(col));
+        }
+        l[9 + col] = local.translation()(static_cast<Eigen::Index>(col));
+    }
+
+    double const* p[BatchChainFrames::kFrameEntries];
+    double* out[BatchChainFrames::kFrameEntries];
+    for (size_t e = 0; e < BatchChainFrames::kFrameEntries; ++e) {
+        p[e] = cache.entry(parent, e);
+        out[e] = cache.entry(link, e);
+    }
+
+    for (size_t k = 0; k < cache.count; ++k) {
+        for (size_t col = 0; col < 3; ++col) {
+            for (size_t row = 0; row < 3; ++row) {
+                out[col * 3 + row][k] = p[row][k] * l[col * 3] + p[3 + row][k] * l[col * 3 + 1] +
+                                        p[6 + row][k] * l[col * 3 + 2];
+            }
+        }
+        for (size_t row = 0; row < 3; ++row) {
+            out[9 + row][k] = p[row][k] * l[9] + p[3 + row][k] * l[10] + p[6 + row][k] * l[11] +
+                              p[9 + row][k];
+        }
+    }
+}
+
+// Sets rotation = rotation * R(axis, angle) for all configurations, from the angles' sines and
+// cosines.
+auto rotate_frame(BatchChainFrames& cache, size_t link, Eigen::Vector3d const& axis) -> void {
+    double* r[9];
+    for (size_t e = 0; e < 9; ++e) {
+        r[e] = cache.entry(link, e);
+    }
+    double const* const sines = cache.sines.data();
+    double const* const cosines = cache.cosines.data();
+    double const x = axis.x();
+    double const y = axis.y();
+    double const z = axis.z();
+
+    for (size_t k = 0; k < cache.count; ++k) {
+        double const s = sines[k];
+        double const c = cosines[k];
+        double const t = 1.0 - c;
+
+        // Rodrigues' formula, column-major.
+        double const j[9] = {t * x * x + c,
+                             t * x * y + s * z,
+                             t * x * z - s * y,
+                             t * x * y - s * z,
+                             t * y * y + c,
+                             t * y * z + s * x,
+                             t * x * z + s * y,
+                             t * y * z - s * x,
+                             t * z * z + c};
+
+        double m[9];
+        for (size_t e = 0; e < 9; ++e) {
+            m[e] = r[e][k];
+        }
+        for (size_t col = 0; col < 3; ++col) {
+            for (size_t row = 0; row < 3; ++row) {
+                r[col * 3 + row][k] = m[row] * j[col * 3] + m[3 + row] * j[col * 3 + 1] +
+                                      m[6 + row] * j[col * 3 + 2];
+            }
+        }
+    }
+}
+
+// Sets translation = translation + rotation * axis * value for all configurations.
+auto translate_frame(BatchChainFrames& cache, size_t link, Eigen::Vector3d const& axis) -> void {
+    double const* const values = cache.joint_values.data();
+    for (size_t row = 0; row < 3; ++row) {
+        double const* const r0 = cache.entry(link, row);
+        double const* const r1 = cache.entry(link, 3 + row);
+        double const* const r2 = cache.entry(link, 6 + row);
+        double* const out = cache.entry(link, 9 + row);
+        for (size_t k = 0; k < cache.count; ++k) {
+            out[k] += (r0[k] * axis.x() + r1[k] * axis.y() + r2[k] * axis.z()) * values[k];
+        }
+    }
+}
+
+}  // namespace
+
+auto update_batch_frames(KinematicChain const& chain,
+                         BatchChainFrames& cache,
+                         double const* configurations,
+                         size_t count) -> void {
+    assert(chain.has_analytic_jacobian);
+    auto const num_variables = chain.group_variable_indices.size();
+    cache.count = count;
+    cache.frames.resize(chain.links.size() * BatchChainFrames::kFrameEntries * count);
+    cache.joint_values.resize(count);
+    cache.sines.resize(count);
+    cache.cosines.resize(count);
+
+    for (size_t i = 0; i < chain.links.size(); ++i) {
+        auto const& link = chain.links[i];
+        auto const& joint_model = *link.joint_model;
+        auto const type = joint_model.getType();
+        bool const moves = link.variable.has_value() &&
+                           (type == moveit::core::JointModel::REVOLUTE ||
+                            type == moveit::core::JointModel::PRISMATIC);
+
+        // Joints that do not depend on the group variables are folded into the link origin.
+        Eigen::Isometry3d local = get_frame(*link.link_model, chain.link_frames);
+        if (!moves) {
+            local = local * get_frame(joint_model, chain.default_variables, chain.joint_axes);
+        }
+        if (link.parent.has_value()) {
+            compose_frame(cache, i, link.parent.value(), local);
+        } else {
+            fill_frame(cache, i, link.fixed_parent_frame * local);
+        }
+        if (!moves) {
+            continue;
+        }
+
+        double const offset = joint_model.getMimic() ? joint_model.getMimicOffset() : 0.0;
+        auto const variable = link.variable.value();
+        for (size_t k = 0; k < count; ++k) {
+            cache.joint_values[k] =
+                link.variable_factor * configurations[k * num_variables + variable] + offset;
+        }
+
+        auto const& axis = chain.joint_axes[joint_model.getJointIndex()];
+        auto const joint_axis = Eigen::Vector3d(axis.x(), axis.y(), axis.z());
+        if (type == moveit::core::JointModel::REVOLUTE) {
+            for (size_t k = 0; k < count; ++k) {
+                cache.sines[k] = std::sin(cache.joint_values[k]);
+                cache.cosines[k] = std::cos(cache.joint_values[k]);
+            }
+            rotate_frame(cache, i, joint_axis);
+        } else {
+            translate_frame(cache, i, joint_axis);
+        }
+    }
+}
+
+auto get_batch_tip_frame(KinematicChain const& chain,
+                         BatchChainFrames const& cache,
+                         size_t tip,
+                         size_t configuration) -> Eigen::Isometry3d {
+    auto const& chain_tip = chain.tips[tip];
+    if (!chain_tip.link.has_value()) {
+        return chain_tip.fixed_frame;
+    }
+    auto const link = chain_tip.link.value();
+    auto frame = Eigen::Isometry3d::Identity();
+    for (Eigen::Index col = 0; col < 3; ++col) {
+        for (Eigen::Index row = 0; row < 3; ++row) {
+            auto const index = static_cast<size_t>(col * 3 + row);
+            frame.linear()(row, col) = cache.entry(link, index)[configuration];
+        }
+        frame.translation()(col) = cache.entry(link, 9 + static_cast<size_t>(col))[configuration];
+    }
+    return frame;
+}
+
+auto make_incremental_fk_fn(std::shared_ptr<moveit::core::RobotModel const> const& robot_model,
+                            moveit::core::JointModelGroup const* jmg,
+                            std::vector<size_t> const& tip_link_indices) -> FkFn {
+    return make_incremental_fk_fn(std::make_shared<KinematicChain const>(
+        KinematicChain::from(robot_model, jmg, tip_link_indices)));
+}
+
+auto make_incremental_fk_fn(std::shared_ptr<KinematicChain const> chain) -> FkFn {
+    return [chain](std::vector<double> const& active_positions) {
+        auto& cache =
+            get_thread_local<ChainFrames>(chain, [&] { return ChainFrames::from(*chain); });
+        update_frames(*chain, cache, active_positions);
+
+        std::vector<Eigen::Isometry3d> tip_frames;
+        get_tip_frames(*chain, cache, tip_frames);
+        return tip_frames;
+    };
+}
+
 }  // namespace pick_ik
@@ -1,24 +1,145 @@
+#include <pick_ik/cost_evaluator.hpp>
 #include <pick_ik/fk_moveit.hpp>
+#include <pick_ik/forward_kinematics.hpp>
 #include <pick_ik/goal.hpp>
 #include <pick_ik/robot.hpp>
+#include <pick_ik/thread_local_cache.hpp>
 
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <memory>
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/robot_model/joint_model_group.h>
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
+#include <numeric>
 #include <optional>
+#include <utility>
 #include <vector>
 
+namespace {
+// Step size for central differences of goal cost functions.
+constexpr double kGoalGradientStepSize = 1.0e-6;
+
+// Rotation vector taking the goal orientation to the frame orientation, in the world frame.
+auto rotation_error(Eigen::Isometry3d const& frame, Eigen::Quaterniond const& goal_rotation_inv)
+    -> Eigen::Vector3d {
+    auto const error = Eigen::AngleAxisd(Eigen::Quaterniond(frame.rotation()) * goal_rotation_inv);
+    return error.angle() * error.axis();
+}
+
+// Adds the scaled pose cost of one tip to the costs of all configurations in a batch.
+auto add_batch_pose_costs(pick_ik::BatchChainFrames const& cache,
+                          size_t link,
+                          Eigen::Isometry3d const& goal,
+                          double position_scale_sq,
+                          double rotation_scale_sq,
+                          double* costs) -> void {
+    double const* f[pick_ik::BatchChainFrames::kFrameEntries];
+    for (size_t e = 0; e < pick_ik::BatchChainFrames::kFrameEntries; ++e) {
+        f[e] = cache.entry(link, e);
+    }
+    auto const& g = goal.linear();
+    auto const& goal_position = goal.translation();
+
+    for (size_t k = 0; k < cache.count; ++k) {
+        double const dx = f[9][k] - goal_position.x();
+        double const dy = f[10][k] - goal_position.y();
+        double const dz = f[11][k] - goal_position.z();
+        double const position_error_sq = dx * dx + dy * dy + dz * dz;
+
+        // The angle of the relative rotation goal^T * frame, from its trace and skew-symmetric
+        // part, which is accurate for small and large angles alike.
+        auto const rel = [&](Eigen::Index row, Eigen::Index col) {
+            return g(0, row) * f[col * 3][k] + g(1, row) * f[col * 3 + 1][k] +
+                   g(2, row) * f[col * 3 + 2][k];
+        };
+        double const trace = rel(0, 0) + rel(1, 1) + rel(2, 2);
+        double const sx = rel(2, 1) - rel(1, 2);
+        double const sy = rel(0, 2) - rel(2, 0);
+        double const sz = rel(1, 0) - rel(0, 1);
+        double const angle =
+            std::atan2(0.5 * std::sqrt(sx * sx + sy * sy + sz * sz), 0.5 * (trace - 1.0));
+
+        costs[k] += position_scale_sq * position_error_sq + rotation_scale_sq * angle * angle;
+    }
+}
+
+auto inverse_rotations(std::vector<Eigen::Isometry3d> const& frames)
+    -> std::vector<Eigen::Quaterniond> {
+    auto rotations = std::vector<Eigen::Quaterniond>{};
+    rotations.reserve(frames.size());
+    for (auto const& frame : frames) {
+        rotations.push_back(Eigen::Quaterniond(frame.rotation()).inverse());
+    }
+    return rotations;
+}
+
+// Pieces of the cost function and solution test shared by the evaluation functions.
+struct Evaluator {
+    std::vector<pick_ik::PoseCostFn> pose_cost_functions;
+    std::vector<pick_ik::FrameTestFn> frame_tests;
+    std::vector<pick_ik::Goal> goals;
+    double cost_threshold_sq;
+    pick_ik::FkFn fk;
+
+    // Computes the cost terms of a configuration, keeping its tip frames for the solution test.
+    auto evaluate_cost(std::vector<double> const& active_positions,
+                       std::vector<Eigen::Isometry3d>& tip_frames,
+                       pick_ik::Evaluation& evaluation) const -> void {
+        tip_frames = fk(active_positions);
+
+        auto pose_cost = 0.0;
+        evaluation.pose_costs.resize(pose_cost_functions.size());
+        for (size_t i = 0; i < pose_cost_functions.size(); ++i) {
+            evaluation.pose_costs[i] = pose_cost_functions[i](tip_frames);
+            pose_cost += evaluation.pose_costs[i];
+        }
+
+        auto goal_cost = 0.0;
+        evaluation.goal_costs.resize(goals.size());
+        for (size_t i = 0; i < goals.size(); ++i) {
+            evaluation.goal_costs[i] =
+                goals[i].eval(active_positions) * std::pow(goals[i].weight, 2);
+            goal_cost += evaluation.goal_costs[i];
+        }
+
+        evaluation.cost = pose_cost + goal_cost;
+    }
+
+    auto is_solution(std::vector<Eigen::Isometry3d> const& tip_frames,
+                     pick_ik::Evaluation const& evaluation) const -> bool {
+        assert(frame_tests.size() == tip_frames.size());
+        for (size_t i = 0; i < frame_tests.size(); ++i) {
+            if (!frame_tests[i](tip_frames[i])) {
+                return false;
+            }
+        }
+        return std::all_of(evaluation.goal_costs.cbegin(),
+                           evaluation.goal_costs.cend(),
+                           [&](auto cost) { return cost < cost_threshold_sq; });
+    }
+};
+
+// The last configuration a thread evaluated with an evaluator.
+struct LastEvaluation {
+    std::vector<double> active_positions;
+    std::vector<Eigen::Isometry3d> tip_frames;
+    pick_ik::Evaluation evaluation;
+    bool valid = false;
+    bool tested = false;  // Whether evaluation.is_solution has been computed.
+};
+}  // namespace
+
 namespace pick_ik {
 
-double linear_distance(Eigen::Isometry3d const& frame_1, Eigen::Isometry3d const& frame_2) {
+auto linear_distance(Eigen::Isometry3d const& frame_1, Eigen::Isometry3d const& frame_2) -> double {
     return (frame_1.translation() - frame_2.translation()).norm();
 }
 
-double angular_distance(Eigen::Isometry3d const& frame_1, Eigen::Isometry3d const& frame_2) {
+auto angular_distance(Eigen::Isometry3d const& frame_1, Eigen::Isometry3d const& frame_2)
+    -> double {
     auto const q_1 = Eigen::Quaterniond(frame_1.rotation());
     auto const q_2 = Eigen::Quaterniond(frame_2.rotation());
     return q_2.angularDistance(q_1);
@@ -88,59 +209,14 @@ auto make_pose_cost_functions(std::vector<Eigen::Isometry3d> goal_frames,
     return cost_functions;
 }
 
-auto make_center_joints_cost_fn(Robot robot) -> CostFn {
-    return [=](std::vector<double> const& active_positions) -> double {
-        double sum = 0;
-        assert(robot.variables.size() == active_positions.size());
-        for (size_t i = 0; i < active_positions.size(); ++i) {
-            auto const& variable = robot.variables[i];
-            if (!variable.bounded) {
-                continue;
-            }
-
-            auto const position = active_positions[i];
-            auto const weight = variable.minimal_displacement_factor;
-            auto const mid = (variable.min + variable.max) * 0.5;
-            sum += std::pow((position - mid) * weight, 2);
-        }
-        return sum;
-    };
-}
+auto make_center_joints_cost_fn(Robot robot) -> CostFn { return CenterJointsCost::from(robot); }
 
 auto make_avoid_joint_limits_cost_fn(Robot robot) -> CostFn {
-    return [=](std::vector<double> const& active_positions) -> double {
-        double sum = 0;
-        assert(robot.variables.size() == active_positions.size());
-        for (size_t i = 0; i < active_positions.size(); ++i) {
-            auto const& variable = robot.variables[i];
-            if (!variable.bounded) {
-                continue;
-            }
-
-            auto const position = active_positions[i];
-            auto const weight = variable.minimal_displacement_factor;
-            sum += std::pow(
-                std::fmax(0.0, std::fabs(position - variable.mid) * 2.0 - variable.half_span) *
-                    weight,
-                2);
-        }
-        return sum;
-    };
+    return AvoidJointLimitsCost::from(robot);
 }
 
 auto make_minimal_displacement_cost_fn(Robot robot, std::vector<double> initial_guess) -> CostFn {
-    return [=](std::vector<double> const& active_positions) -> double {
-        double sum = 0;
-        assert(active_positions.size() == robot.variables.size() &&
-               active_positions.size() == initial_guess.size());
-        for (size_t i = 0; i < active_positions.size(); ++i) {
-            auto const guess = initial_guess[i];
-            auto const position = active_positions[i];
-            auto const weight = robot.variables[i].minimal_displacement_factor;
-            sum += std::pow((position - guess) * weight, 2);
-        }
-        return sum;
-    };
+    return MinimalDisplacementCost::from(robot, std::move(initial_guess));
 }
 
 auto make_ik_cost_fn(geometry_msgs::msg::Pose pose,
@@ -148,12 +224,18 @@ auto make_ik_cost_fn(geometry_msgs::msg::Pose pose,
                      std::shared_ptr<moveit::core::RobotModel const> robot_model,
                      moveit::core::JointModelGroup const* jmg,
                      std::vector<double> initial_guess) -> CostFn {
-    auto robot_state = moveit::core::RobotState(robot_model);
-    robot_state.setToDefaultValues();
-    robot_state.setJointGroupPositions(jmg, initial_guess);
-    robot_state.update();
+    auto initial_state = std::make_shared<moveit::core::RobotState>(robot_model);
+    initial_state->setToDefaultValues();
+    initial_state->setJointGroupPositions(jmg, initial_guess);
+    initial_state->update();
+    auto const initial_robot_state =
+        std::shared_ptr<moveit::core::RobotState const>(std::move(initial_state));
 
-    return [=](std::vector<double> const& active_positions) mutable {
+    // Each thread works on its own copy of the robot state.
+    return [=](std::vector<double> const& active_positions) {
+        auto& robot_state = get_thread_local<moveit::core::RobotState>(
+            initial_robot_state,
+            [&] { return *initial_robot_state; });
         robot_state.setJointGroupPositions(jmg, active_positions);
         robot_state.update();
         return cost_fn(pose, robot_state, jmg, initial_guess);
@@ -202,4 +284,231 @@ auto make_cost_fn(std::vector<PoseCostFn> pose_cost_functions, std::vector<Goal>
     };
 }
 
+auto make_evaluation_fn(std::vector<PoseCostFn> pose_cost_functions,
+                        std::vector<FrameTestFn> frame_tests,
+                        std::vector<Goal> goals,
+                        double cost_threshold,
+                        FkFn fk) -> EvaluationFn {
+    auto const evaluator =
+        std::make_shared<Evaluator const>(Evaluator{std::move(pose_cost_functions),
+                                                    std::move(frame_tests),
+                                                    std::move(goals),
+                                                    std::pow(cost_threshold, 2),
+                                                    std::move(fk)});
+    return [evaluator](std::vector<double> const& active_positions) {
+        auto evaluation = Evaluation{};
+        auto tip_frames = std::vector<Eigen::Isometry3d>{};
+        evaluator->evaluate_cost(active_positions, tip_frames, evaluation);
+        evaluation.is_solution = evaluator->is_solution(tip_frames, evaluation);
+        return evaluation;
+    };
+}
+
+auto make_evaluation_fns(std::vector<PoseCostFn> pose_cost_functions,
+                         std::vector<FrameTestFn> frame_tests,
+                         std::vector<Goal> goals,
+                         double cost_threshold,
+                         FkFn fk) -> EvaluationFns {
+    auto const evaluator =
+        std::make_shared<Evaluator const>(Evaluator{std::move(pose_cost_functions),
+                                                    std::move(frame_tests),
+                                                    std::move(goals),
+                                                    std::pow(cost_threshold, 2),
+                                                    std::move(fk)});
+    auto const last_evaluation =
+        [evaluator](std::vector<double> const& active_positions) -> LastEvaluation& {
+        auto& last = get_thread_local<LastEvaluation>(evaluator, [] { return LastEvaluation{}; });
+        if (!last.valid || last.active_positions != active_positions) {
+            evaluator->evaluate_cost(active_positions, last.tip_frames, last.evaluation);
+            last.active_positions = active_positions;
+            last.valid = true;
+            last.tested = false;
+        }
+        return last;
+    };
+
+    return EvaluationFns{
+        [last_evaluation](std::vector<double> const& active_positions) {
+            return last_evaluation(active_positions).evaluation.cost;
+        },
+        [evaluator, last_evaluation](std::vector<double> const& active_positions) {
+            auto& last = last_evaluation(active_positions);
+            if (!last.tested) {
+                last.evaluation.is_solution =
+                    evaluator->is_solution(last.tip_frames, last.evaluation);
+                last.tested = true;
+            }
+            return last.evaluation.is_solution;
+        }};
+}
+
+auto make_batch_cost_fn(std::shared_ptr<KinematicChain const> chain,
+                        std::vector<Eigen::Isometry3d> goal_frames,
+                        double position_scale,
+                        double rotation_scale,
+                        std::vector<Goal> goals) -> BatchCostFn {
+    if (!chain->has_analytic_jacobian) {
+        return BatchCostFn();
+    }
+    assert(goal_frames.size() == chain->tips.size());
+
+    auto const position_scale_sq = position_scale > 0.0 ? std::pow(position_scale, 2) : 0.0;
+    auto const rotation_scale_sq = rotation_scale > 0.0 ? std::pow(rotation_scale, 2) : 0.0;
+
+    // Tips that do not move have the same pose cost for every configuration.
+    auto const pose_cost_functions =
+        make_pose_cost_functions(goal_frames, position_scale, rotation_scale);
+    auto fixed_pose_cost = 0.0;
+    for (size_t i = 0; i < chain->tips.size(); ++i) {
+        if (!chain->tips[i].link.has_value()) {
+            auto tip_frames = std::vector<Eigen::Isometry3d>(chain->tips.size());
+            tip_frames[i] = chain->tips[i].fixed_frame;
+            fixed_pose_cost += pose_cost_functions[i](tip_frames);
+        }
+    }
+
+    return [=](double const* configurations, size_t count, double* costs) {
+        auto& cache = get_thread_local<BatchChainFrames>(chain, [] { return BatchChainFrames{}; });
+        update_batch_frames(*chain, cache, configurations, count);
+
+        std::fill(costs, costs + count, fixed_pose_cost);
+        for (size_t i = 0; i < chain->tips.size(); ++i) {
+            auto const& tip = chain->tips[i];
+            if (tip.link.has_value()) {
+                add_batch_pose_costs(cache,
+                                     tip.link.value(),
+                                     goal_frames[i],
+                                     position_scale_sq,
+                                     rotation_scale_sq,
+                                     costs);
+            }
+        }
+
+        if (goals.empty()) {
+            return;
+        }
+        auto const num_variables = chain->group_variable_indices.size();
+        auto active_positions = std::vector<double>(num_variables);
+        for (size_t k = 0; k < count; ++k) {
+            auto const* row = configurations + k * num_variables;
+            std::copy(row, row + num_variables, active_positions.begin());
+            for (auto const& goal : goals) {
+                costs[k] += goal.eval(active_positions) * std::pow(goal.weight, 2);
+            }
+        }
+    };
+}
+
+auto make_cost_gradient_fn(std::shared_ptr<KinematicChain const> chain,
+                           std::vector<Eigen::Isometry3d> goal_frames,
+                           double position_scale,
+                           double rotation_scale,
+                           std::vector<Goal> goals) -> CostGradientFn {
+    if (!chain->has_analytic_jacobian) {
+        return CostGradientFn();
+    }
+    assert(goal_frames.size() == chain->tips.size());
+
+    auto const position_scale_sq = position_scale > 0.0 ? std::pow(position_scale, 2) : 0.0;
+    auto const rotation_scale_sq = rotation_scale > 0.0 ? std::pow(rotation_scale, 2) : 0.0;
+    auto const goal_rotations_inv = inverse_rotations(goal_frames);
+
+    auto const goal_cost = [goals](std::vector<double> const& active_positions) {
+        return std::accumulate(goals.cbegin(), goals.cend(), 0.0, [&](auto sum, auto const& goal) {
+            return sum + goal.eval(active_positions) * std::pow(goal.weight, 2);
+        });
+    };
+
+    return [=](std::vector<double> const& active_positions, std::vector<double>& gradient) {
+        auto& cache =
+            get_thread_local<ChainFrames>(chain, [&] { return ChainFrames::from(*chain); });
+        auto& jacobians =
+            get_thread_local<std::vector<Jacobian>>(chain, [] { return std::vector<Jacobian>{}; });
+        update_frames(*chain, cache, active_positions);
+        compute_jacobians(*chain, cache, jacobians);
+
+        auto const count = active_positions.size();
+        gradient.assign(count, 0.0);
+        auto gradient_vec = Eigen::Map<Eigen::VectorXd>(gradient.data(),
+                                                        static_cast<Eigen::Index>(count));
+
+        // The pose cost of each tip is position_scale^2 * |e_p|^2 + rotation_scale^2 * |e_r|^2,
+        // where e_r is the rotation vector from the goal to the tip orientation in the world
+        // frame. Its derivative along a world angular velocity w is 2 * e_r . w.
+        double cost = 0.0;
+        for (size_t t = 0; t < goal_frames.size(); ++t) {
+            auto const& tip = chain->tips[t];
+            auto const& frame =
+                tip.link.has_value() ? cache.frames[tip.link.value()] : tip.fixed_frame;
+            Eigen::Vector3d const position_error =
+                frame.translation() - goal_frames[t].translation();
+            Eigen::Vector3d const rotation_error_vec = rotation_error(frame, goal_rotations_inv[t]);
+
+            cost += position_scale_sq * position_error.squaredNorm() +
+                    rotation_scale_sq * rotation_error_vec.squaredNorm();
+            gradient_vec +=
+                2.0 * position_scale_sq * jacobians[t].topRows<3>().transpose() * position_error +
+                2.0 * rotation_scale_sq * jacobians[t].bottomRows<3>().transpose() *
+                    rotation_error_vec;
+        }
+
+        if (!goals.empty()) {
+            cost += goal_cost(active_positions);
+            auto working = active_positions;
+            for (size_t i = 0; i < count; ++i) {
+                working[i] = active_positions[i] + kGoalGradientStepSize;
+                auto const cost_plus = goal_cost(working);
+                working[i] = active_positions[i] - kGoalGradientStepSize;
+                auto const cost_minus = goal_cost(working);
+                working[i] = active_positions[i];
+                gradient[i] += (cost_plus - cost_minus) / (2.0 * kGoalGradientStepSize);
+            }
+        }
+
+        return cost;
+    };
+}
+
+auto make_pose_residual_fn(std::shared_ptr<KinematicChain const> chain,
+                           std::vector<Eigen::Isometry3d> goal_frames,
+                           double position_scale,
+                           double rotation_scale) -> PoseResidualFn {
+    if (!chain->has_analytic_jacobian) {
+        return PoseResidualFn();
+    }
+    assert(goal_frames.size() == chain->tips.size());
+
+    auto const goal_rotations_inv = inverse_rotations(goal_frames);
+    position_scale = std::fmax(position_scale, 0.0);
+    rotation_scale = std::fmax(rotation_scale, 0.0);
+
+    return [=](std::vector<double> const& active_positions,
+               Eigen::VectorXd& residual,
+               Eigen::MatrixXd& jacobian) {
+        auto& cache =
+            get_thread_local<ChainFrames>(chain, [&] { return ChainFrames::from(*chain); });
+        auto& jacobians =
+            get_thread_local<std::vector<Jacobian>>(chain, [] { return std::vector<Jacobian>{}; });
+        update_frames(*chain, cache, active_positions);
+        compute_jacobians(*chain, cache, jacobians);
+
+        auto const rows = static_cast<Eigen::Index>(6 * goal_frames.size());
+        auto const cols = static_cast<Eigen::Index>(active_positions.size());
+        residual.resize(rows);
+        jacobian.resize(rows, cols);
+        for (size_t t = 0; t < goal_frames.size(); ++t) {
+            auto const& tip = chain->tips[t];
+            auto const& frame =
+                tip.link.has_value() ? cache.frames[tip.link.value()] : tip.fixed_frame;
+            auto const row = static_cast<Eigen::Index>(6 * t);
+            residual.segment<3>(row) =
+                position_scale * (frame.translation() - goal_frames[t].translation());
+            residual.segment<3>(row + 3) =
+                rotation_scale * rotation_error(frame, goal_rotations_inv[t]);
+            jacobian.middleRows<3>(row) = position_scale * jacobians[t].topRows<3>();
+            jacobian.middleRows<3>(row + 3) = rotation_scale * jacobians[t].bottomRows<3>();
+        }
+    };
+}
+
 }  // namespace pick_ik
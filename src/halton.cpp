@@ -0,0 +1,68 @@
+#include <pick_ik/halton.hpp>
+#include <pick_ik/random.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace pick_ik {
+namespace {
+
+auto first_primes(size_t count) -> std::vector<uint32_t> {
+    auto primes = std::vector<uint32_t>{};
+    primes.reserve(count);
+    for (uint32_t candidate = 2; primes.size() < count; ++candidate) {
+        auto const is_prime = std::none_of(primes.cbegin(), primes.cend(), [candidate](auto p) {
+            return candidate % p == 0;
+        });
+        if (is_prime) {
+            primes.push_back(candidate);
+        }
+    }
+    return primes;
+}
+
+}  // namespace
+
+HaltonSequence::HaltonSequence(size_t dimensions, Rng& rng) : bases_(first_primes(dimensions)) {
+    permutations_.reserve(dimensions);
+    for (auto const base : bases_) {
+        // Digit 0 stays in place, as every index has infinitely many leading zero digits, which
+        // would otherwise each add to the value.
+        auto permutation = std::vector<uint32_t>(base);
+        std::iota(permutation.begin(), permutation.end(), uint32_t{0});
+        for (size_t i = base - 1; i > 1; --i) {
+            std::swap(permutation[i], permutation[rng.uniform_int(1, i)]);
+        }
+        permutations_.push_back(std::move(permutation));
+    }
+}
+
+auto HaltonSequence::random_start(Rng& rng) const -> uint64_t {
+    // Starts far enough apart that users rarely take the same points, with few enough digits that
+    // points stay cheap to compute.
+    return rng.uniform_int(1, size_t{1} << 32);
+}
+
+auto HaltonSequence::at(uint64_t index, std::vector<double>& point) const -> void {
+    assert(index > 0);
+    point.resize(bases_.size());
+    for (size_t j = 0; j < bases_.size(); ++j) {
+        auto const base = bases_[j];
+        auto const& permutation = permutations_[j];
+        auto const inverse_base = 1.0 / static_cast<double>(base);
+        auto scale = inverse_base;
+        auto value = 0.0;
+        for (auto remaining = index; remaining > 0; remaining /= base) {
+            value += static_cast<double>(permutation[remaining % base]) * scale;
+            scale *= inverse_base;
+        }
+        point[j] = value;
+    }
+}
+
+}  // namespace pick_ik
@@ -0,0 +1,108 @@
+#include <pick_ik/goal.hpp>
+#include <pick_ik/ik_dls.hpp>
+#include <pick_ik/robot.hpp>
+#include <pick_ik/trace.hpp>
+
+#include <Eigen/Cholesky>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <optional>
+#include <vector>
+
+namespace pick_ik {
+
+DlsIk DlsIk::from(std::vector<double> const& initial_guess,
+                  CostFn const& cost_fn,
+                  DlsIkParams const& params) {
+    auto ik = DlsIk{};
+    ik.local = initial_guess;
+    ik.working = initial_guess;
+    ik.local_cost = cost_fn(initial_guess);
+    ik.damping = params.initial_damping;
+    return ik;
+}
+
+auto step(DlsIk& self,
+          Robot const& robot,
+          CostFn const& cost_fn,
+          PoseResidualFn const& residual_fn,
+          DlsIkParams const& params) -> bool {
+    PICK_IK_TRACE_SCOPE("ik_dls step");
+    auto const count = self.local.size();
+
+    // Solve (J^T J + damping * I) delta = -J^T r
+    residual_fn(self.local, self.residual, self.jacobian);
+    self.hessian.noalias() = self.jacobian.transpose() * self.jacobian;
+    self.hessian.diagonal().array() += self.damping;
+    self.delta.noalias() = -(self.jacobian.transpose() * self.residual);
+    self.delta = self.hessian.ldlt().solve(self.delta);
+
+    for (size_t i = 0; i < count; ++i) {
+        auto const updated_value = self.local[i] + self.delta[static_cast<Eigen::Index>(i)];
+        self.working[i] = robot.variables[i].clamp_to_limits(updated_value);
+    }
+
+    // Accept the step only if it decreases the full cost, and adapt the damping accordingly.
+    auto const working_cost = cost_fn(self.working);
+    if (working_cost < self.local_cost) {
+        std::swap(self.local, self.working);
+        self.local_cost = working_cost;
+        self.damping = std::max(self.damping * params.damping_decrease, params.min_damping);
+        return true;
+    }
+    self.damping *= params.damping_increase;
+    return false;
+}
+
+auto ik_dls(std::vector<double> const& initial_guess,
+            Robot const& robot,
+            CostFn const& cost_fn,
+            PoseResidualFn const& residual_fn,
+            SolutionTestFn const& solution_fn,
+            DlsIkParams const& params,
+            bool approx_solution,
+            std::atomic<bool> const* cancel) -> std::optional<std::vector<double>> {
+    PICK_IK_TRACE_SCOPE("ik_dls");
+    if (params.stop_optimization_on_valid_solution && solution_fn(initial_guess)) {
+        return initial_guess;
+    }
+
+    assert(robot.variables.size() == initial_guess.size());
+    auto ik = DlsIk::from(initial_guess, cost_fn, params);
+
+    // Main loop
+    int num_iterations = 0;
+    auto const timeout_point =
+        std::chrono::system_clock::now() + std::chrono::duration<double>(params.max_time);
+
+    while ((std::chrono::system_clock::now() < timeout_point) &&
+           (num_iterations < params.max_iterations) && (ik.damping <= params.max_damping)) {
+        if (cancel != nullptr && *cancel) {
+            break;
+        }
+        auto const previous_cost = ik.local_cost;
+        if (step(ik, robot, cost_fn, residual_fn, params)) {
+            if (params.stop_optimization_on_valid_solution && solution_fn(ik.local)) {
+                return ik.local;
+            }
+            if (previous_cost - ik.local_cost <= params.min_cost_delta) {
+                break;
+            }
+        }
+        num_iterations++;
+    }
+
+    if (!params.stop_optimization_on_valid_solution && solution_fn(ik.local)) {
+        return ik.local;
+    }
+
+    // If no solution was found, either return the approximate solution or nothing.
+    if (approx_solution) {
+        return ik.local;
+    }
+    return std::nullopt;
+}
+
+}  // namespace pick_ik
@@ -1,8 +1,11 @@
 #include <pick_ik/goal.hpp>
 #include <pick_ik/ik_gradient.hpp>
 #include <pick_ik/robot.hpp>
+#include <pick_ik/solve_stats.hpp>
+#include <pick_ik/trace.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <fmt/core.h>
@@ -21,26 +24,12 @@ GradientIk GradientIk::from(std::vector<double> const& initial_guess, CostFn con
                       initial_cost};
 }
 
-auto step(GradientIk& self, Robot const& robot, CostFn const& cost_fn, double step_size) -> bool {
-    auto const count = self.local.size();
-
-    // compute gradient direction
-    for (size_t i = 0; i < count; ++i) {
-        // test negative displacement
-        self.working[i] = self.local[i] - step_size;
-        double const p1 = cost_fn(self.working);
+namespace {
 
-        // test positive displacement
-        self.working[i] = self.local[i] + step_size;
-        double const p3 = cost_fn(self.working);
-
-        // reset self.working
-        self.working[i] = self.local[i];
-
-        // + gradient = + on this joint increases cost fn result
-        // - gradient = - on this joint increases cost fn result
-        self.gradient[i] = p3 - p1;
-    }
+// Takes a step along self.gradient, which holds cost differences over +/- step_size.
+auto line_search_step(GradientIk& self, Robot const& robot, CostFn const& cost_fn, double step_size)
+    -> bool {
+    auto const count = self.local.size();
 
     // normalize gradient direction
     auto sum = std::accumulate(self.gradient.cbegin(),
@@ -93,12 +82,58 @@ auto step(GradientIk& self, Robot const& robot, CostFn const& cost_fn, double st
     return false;
 }
 
+}  // namespace
+
+auto step(GradientIk& self, Robot const& robot, CostFn const& cost_fn, double step_size) -> bool {
+    PICK_IK_TRACE_SCOPE("ik_gradient step");
+    auto const count = self.local.size();
+
+    // compute gradient direction
+    for (size_t i = 0; i < count; ++i) {
+        // test negative displacement
+        self.working[i] = self.local[i] - step_size;
+        double const p1 = cost_fn(self.working);
+
+        // test positive displacement
+        self.working[i] = self.local[i] + step_size;
+        double const p3 = cost_fn(self.working);
+
+        // reset self.working
+        self.working[i] = self.local[i];
+
+        // + gradient = + on this joint increases cost fn result
+        // - gradient = - on this joint increases cost fn result
+        self.gradient[i] = p3 - p1;
+    }
+
+    return line_search_step(self, robot, cost_fn, step_size);
+}
+
+auto step(GradientIk& self,
+          Robot const& robot,
+          CostFn const& cost_fn,
+          CostGradientFn const& gradient_fn,
+          double step_size) -> bool {
+    PICK_IK_TRACE_SCOPE("ik_gradient analytic step");
+    // Scale the gradient to match the central differences of the numerical version.
+    gradient_fn(self.local, self.gradient);
+    for (auto& value : self.gradient) {
+        value *= 2.0 * step_size;
+    }
+
+    return line_search_step(self, robot, cost_fn, step_size);
+}
+
 auto ik_gradient(std::vector<double> const& initial_guess,
                  Robot const& robot,
                  CostFn const& cost_fn,
                  SolutionTestFn const& solution_fn,
                  GradientIkParams const& params,
-                 bool approx_solution) -> std::optional<std::vector<double>> {
+                 bool approx_solution,
+                 CostGradientFn const& gradient_fn,
+                 std::atomic<bool> const* cancel,
+                 SolveStats* stats) -> std::optional<std::vector<double>> {
+    PICK_IK_TRACE_SCOPE("ik_gradient");
     if (params.stop_optimization_on_valid_solution && solution_fn(initial_guess)) {
         return initial_guess;
     }
@@ -109,14 +144,24 @@ auto ik_gradient(std::vector<double> const& initial_guess,
     // Main loop
     int num_iterations = 0;
     double previous_cost = 0.0;
+    bool found_solution = false;
     auto const timeout_point =
         std::chrono::system_clock::now() + std::chrono::duration<double>(params.max_time);
 
     while ((std::chrono::system_clock::now() < timeout_point) &&
            (num_iterations < params.max_iterations)) {
-        if (step(ik, robot, cost_fn, params.step_size)) {
+        if (cancel != nullptr && *cancel) {
+            break;
+        }
+        bool const improved = gradient_fn ? step(ik, robot, cost_fn, gradient_fn, params.step_size)
+                                          : step(ik, robot, cost_fn, params.step_size);
+        num_iterations++;
+        if (improved) {
+            // The best solution was the last one evaluated, so solution tests sharing evaluations
+            // with the cost function (see make_evaluation_fns) do not repeat FK here.
             if (params.stop_optimization_on_valid_solution && solution_fn(ik.best)) {
-                return ik.best;
+                found_solution = true;
+                break;
             }
         }
 
@@ -124,10 +169,14 @@ auto ik_gradient(std::vector<double> const& initial_guess,
             break;
         }
         previous_cost = ik.local_cost;
-        num_iterations++;
     }
 
-    if (!params.stop_optimization_on_valid_solution && solution_fn(ik.best)) {
+    if (stats != nullptr) {
+        stats->gradient_iterations += static_cast<size_t>(num_iterations);
+    }
+
+    if (found_solution ||
+        (!params.stop_optimization_on_valid_solution && solution_fn(ik.best))) {
         return ik.best;
     }
 
@@ -1,20 +1,48 @@
 #include <pick_ik/goal.hpp>
+#include <pick_ik/halton.hpp>
 #include <pick_ik/ik_gradient.hpp>
 #include <pick_ik/ik_memetic.hpp>
+#include <pick_ik/random.hpp>
 #include <pick_ik/robot.hpp>
-
-#include <rsl/queue.hpp>
+#include <pick_ik/solve_stats.hpp>
+#include <pick_ik/thread_pool.hpp>
+#include <pick_ik/trace.hpp>
 
 #include <algorithm>
+#include <cassert>
 #include <chrono>
 #include <cmath>
 #include <fmt/core.h>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <thread>
+#include <utility>
 #include <vector>
 
 namespace pick_ik {
 
+bool MigrationRing::push(Individual const& individual) {
+    auto const tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= slots_.size()) {
+        return false;
+    }
+    slots_[tail % slots_.size()] = individual;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool MigrationRing::pop(Individual& individual) {
+    auto const head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    individual = slots_[head % slots_.size()];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
 MemeticIk MemeticIk::from(std::vector<double> const& initial_guess,
                           CostFn const& cost_fn,
                           MemeticIkParams const& params) {
@@ -24,11 +52,16 @@ MemeticIk MemeticIk::from(std::vector<double> const& initial_guess,
 MemeticIk::MemeticIk(std::vector<double> const& initial_guess,
                      double cost,
                      MemeticIkParams const& params)
-    : params_{params} {
-    best_ = Individual{initial_guess, cost, 0.0, std::vector<double>(initial_guess.size(), 0.0)};
+    : dof_{initial_guess.size()}, params_{params} {
+    best_ = Individual{initial_guess, cost, 0.0, std::vector<double>(dof_, 0.0)};
     best_curr_ = best_;
+    migrant_ = best_;
 
-    population_.reserve(params.population_size);
+    genes_.resize(params.population_size * dof_);
+    gradients_.resize(params.population_size * dof_);
+    fitness_.resize(params.population_size);
+    extinction_.resize(params.population_size);
+    order_.resize(params.population_size);
     mating_pool_.reserve(params.elite_size);
 
     // Cache some coefficients to not have to recompute them all the time.
@@ -37,9 +70,34 @@ MemeticIk::MemeticIk(std::vector<double> const& initial_guess,
         extinction_grading_.push_back(static_cast<double>(i) /
                                       static_cast<double>(params.population_size - 1));
     }
-    inverse_gene_size_ = 1.0 / static_cast<double>(initial_guess.size());
+    inverse_gene_size_ = 1.0 / static_cast<double>(dof_);
+
+    auto const zeros = std::vector<double>(dof_, 0.0);
+    gd_workspaces_.resize(params.elite_size, GradientIk{zeros, zeros, zeros, zeros, 0.0, 0.0});
+    scratch_genes_ = zeros;
+    batch_genes_.resize((params.population_size - params.elite_size) * dof_);
+    batch_costs_.resize(params.population_size - params.elite_size);
+    random_a_ = zeros;
+    random_b_ = zeros;
+    mutations_ = zeros;
+    unit_point_ = zeros;
 };
 
+void MemeticIk::copyToIndividual(size_t slot, Individual& individual) const {
+    auto const* genes = genes_.data() + slot * dof_;
+    auto const* gradient = gradients_.data() + slot * dof_;
+    individual.genes.assign(genes, genes + dof_);
+    individual.gradient.assign(gradient, gradient + dof_);
+    individual.fitness = fitness_[slot];
+    individual.extinction = extinction_[slot];
+}
+
+double MemeticIk::evaluate(size_t slot, CostFn const& cost_fn) {
+    auto const* genes = genesOf(slot);
+    std::copy(genes, genes + dof_, scratch_genes_.begin());
+    return cost_fn(scratch_genes_);
+}
+
 bool MemeticIk::checkWipeout() {
     // Handle wipeouts if no progress is being made.
     if (previous_fitness_.has_value()) {
@@ -55,20 +113,32 @@ bool MemeticIk::checkWipeout() {
 }
 
 void MemeticIk::computeExtinctions() {
-    double min_fitness = population_.front().fitness;
-    double max_fitness = population_.back().fitness;
+    double min_fitness = fitness_[order_.front()];
+    double max_fitness = fitness_[order_.back()];
     for (size_t i = 0; i < params_.population_size; ++i) {
-        population_[i].extinction =
-            (population_[i].fitness + min_fitness * (extinction_grading_[i] - 1)) / max_fitness;
+        auto const slot = order_[i];
+        extinction_[slot] =
+            (fitness_[slot] + min_fitness * (extinction_grading_[i] - 1)) / max_fitness;
     }
 }
 
-void MemeticIk::gradientDescent(size_t const i,
-                                Robot const& robot,
-                                CostFn const& cost_fn,
-                                GradientIkParams const& gd_params) {
-    auto& individual = population_[i];
-    auto local_ik = GradientIk::from(individual.genes, cost_fn);
+size_t MemeticIk::gradientDescent(size_t const i,
+                                  Robot const& robot,
+                                  CostFn const& cost_fn,
+                                  GradientIkParams const& gd_params,
+                                  CostGradientFn const& gradient_fn,
+                                  StopFlags const& stop) {
+    PICK_IK_TRACE_SCOPE("MemeticIk::gradientDescent");
+    // Elites run concurrently, so each one only touches its own slot and workspace.
+    auto const slot = order_[i];
+    auto* const genes = genesOf(slot);
+    auto& local_ik = gd_workspaces_[i];
+    local_ik.local.assign(genes, genes + dof_);
+    local_ik.working = local_ik.local;
+    local_ik.best = local_ik.local;
+    std::fill(local_ik.gradient.begin(), local_ik.gradient.end(), 0.0);
+    local_ik.local_cost = fitness_[slot];
+    local_ik.best_cost = fitness_[slot];
 
     int num_iterations = 0;
     double previous_cost = 0;
@@ -77,114 +147,231 @@ void MemeticIk::gradientDescent(size_t const i,
 
     while ((std::chrono::system_clock::now() < timeout_point_local) &&
            (num_iterations < gd_params.max_iterations)) {
-        step(local_ik, robot, cost_fn, gd_params.step_size);
+        if (stop.isSet()) {
+            break;
+        }
+        if (gradient_fn) {
+            step(local_ik, robot, cost_fn, gradient_fn, gd_params.step_size);
+        } else {
+            step(local_ik, robot, cost_fn, gd_params.step_size);
+        }
+        num_iterations++;
         if (abs(local_ik.local_cost - previous_cost) <= gd_params.min_cost_delta) {
             break;
         }
         previous_cost = local_ik.local_cost;
-        num_iterations++;
     }
 
-    individual.genes = local_ik.best;
-    individual.fitness = cost_fn(individual.genes);
-    individual.gradient = local_ik.gradient;
+    std::copy(local_ik.best.cbegin(), local_ik.best.cend(), genes);
+    std::copy(local_ik.gradient.cbegin(), local_ik.gradient.cend(), gradientOf(slot));
+    fitness_[slot] = local_ik.best_cost;
+    return static_cast<size_t>(num_iterations);
 }
 
 void MemeticIk::initPopulation(Robot const& robot,
                                CostFn const& cost_fn,
-                               std::vector<double> const& initial_guess) {
-    std::vector<double> const zero_grad(robot.variables.size(), 0.0);
-    population_.resize(params_.population_size);
-    for (size_t i = 0; i < params_.elite_size; ++i) {
-        auto genotype = initial_guess;
-        if (i > 0) {
-            robot.set_random_valid_configuration(genotype);
-        }
-        population_[i] = Individual{genotype, cost_fn(genotype), 1.0, zero_grad};
+                               std::vector<double> const& initial_guess,
+                               Rng& rng,
+                               BatchCostFn const& batch_cost_fn,
+                               std::vector<std::vector<double>> const& elite_guesses) {
+    PICK_IK_TRACE_SCOPE("MemeticIk::initPopulation");
+    lower_limits_.resize(dof_);
+    upper_limits_.resize(dof_);
+    half_spans_.resize(dof_);
+    for (size_t j_idx = 0; j_idx < dof_; ++j_idx) {
+        auto const& variable = robot.variables[j_idx];
+        auto constexpr infinity = std::numeric_limits<double>::infinity();
+        lower_limits_[j_idx] = variable.bounded ? variable.min : -infinity;
+        upper_limits_[j_idx] = variable.bounded ? variable.max : infinity;
+        half_spans_[j_idx] = variable.half_span;
     }
 
-    // Initialize children to some dummy values that will be overwritten.
-    for (size_t i = params_.elite_size; i < params_.population_size; ++i) {
-        population_[i] = Individual{initial_guess, 0.0, 1.0, zero_grad};
+    // Elites other than the first one start at the elite guesses, then at random configurations.
+    // Children are initialized to the initial guess and will be overwritten.
+    for (size_t slot = 0; slot < params_.population_size; ++slot) {
+        std::copy(initial_guess.cbegin(), initial_guess.cend(), scratch_genes_.begin());
+        if (slot > 0 && slot < params_.elite_size) {
+            if (slot <= elite_guesses.size()) {
+                auto const& guess = elite_guesses[slot - 1];
+                assert(guess.size() == dof_);
+                std::copy(guess.cbegin(), guess.cend(), scratch_genes_.begin());
+            } else if (params_.halton) {
+                assert(params_.halton->dimensions() == dof_);
+                if (halton_index_ == 0) {
+                    halton_index_ = params_.halton->random_start(rng);
+                }
+                params_.halton->at(halton_index_++, unit_point_);
+                for (size_t j_idx = 0; j_idx < dof_; ++j_idx) {
+                    scratch_genes_[j_idx] =
+                        robot.variables[j_idx].from_unit(unit_point_[j_idx], scratch_genes_[j_idx]);
+                }
+            } else {
+                robot.set_random_valid_configuration(scratch_genes_, rng);
+            }
+        }
+        std::copy(scratch_genes_.cbegin(), scratch_genes_.cend(), genesOf(slot));
+        std::fill(gradientOf(slot), gradientOf(slot) + dof_, 0.0);
+        if (!batch_cost_fn) {
+            fitness_[slot] = cost_fn(scratch_genes_);
+        }
+        order_[slot] = slot;
     }
-
-    // Initialize fitnesses and extinctions
-    for (auto& individual : population_) {
-        individual.fitness = cost_fn(individual.genes);
+    if (batch_cost_fn) {
+        batch_cost_fn(genes_.data(), params_.population_size, fitness_.data());
     }
+
+    // Initialize extinctions
     computeExtinctions();
     previous_fitness_.reset();
 }
 
-void MemeticIk::reproduce(Robot const& robot, CostFn const& cost_fn) {
+void MemeticIk::emigrate(MigrationRing& outbox, size_t count) {
+    for (size_t i = 0; i < std::min(count, params_.population_size); ++i) {
+        copyToIndividual(order_[i], migrant_);
+        if (!outbox.push(migrant_)) {
+            break;
+        }
+    }
+}
+
+void MemeticIk::immigrate(MigrationRing& inbox) {
+    bool replaced = false;
+    while (inbox.pop(migrant_)) {
+        auto const worst =
+            *std::max_element(order_.cbegin(), order_.cend(), [this](size_t a, size_t b) {
+                return fitness_[a] < fitness_[b];
+            });
+        if (migrant_.fitness < fitness_[worst]) {
+            std::copy(migrant_.genes.cbegin(), migrant_.genes.cend(), genesOf(worst));
+            std::copy(migrant_.gradient.cbegin(), migrant_.gradient.cend(), gradientOf(worst));
+            fitness_[worst] = migrant_.fitness;
+            replaced = true;
+        }
+    }
+    if (replaced) {
+        sortPopulation();
+    }
+}
+
+void MemeticIk::crossover(size_t child, size_t parentA, size_t parentB, Rng& rng) {
+    // Get mutation probability
+    double const extinction = 0.5 * (extinction_[parentA] + extinction_[parentB]);
+    double const mutation_prob = extinction * (1.0 - inverse_gene_size_) + inverse_gene_size_;
+
+    // Draw all random numbers up front, so that the loop below vectorizes.
+    auto const mix_ratio = rng.uniform_real(0.0, 1.0);
+    for (size_t j_idx = 0; j_idx < dof_; ++j_idx) {
+        random_a_[j_idx] = rng.uniform_real(0.0, 1.0);
+        random_b_[j_idx] = rng.uniform_real(0.0, 1.0);
+        mutations_[j_idx] = (rng.uniform_real(0.0, 1.0) < mutation_prob)
+                                ? extinction * rng.uniform_real(-1.0, 1.0)
+                                : 0.0;
+    }
+
+    auto* const genes = genesOf(child);
+    auto* const gradient = gradientOf(child);
+    auto const* const genes_a = genesOf(parentA);
+    auto const* const genes_b = genesOf(parentB);
+    auto const* const gradient_a = gradientOf(parentA);
+    auto const* const gradient_b = gradientOf(parentB);
+    for (size_t j_idx = 0; j_idx < dof_; ++j_idx) {
+        // Reproduce, and add in parent gradients
+        auto const gene = mix_ratio * genes_a[j_idx] + (1.0 - mix_ratio) * genes_b[j_idx] +
+                          random_a_[j_idx] * gradient_a[j_idx] +
+                          random_b_[j_idx] * gradient_b[j_idx];
+
+        // Mutate and clamp to valid joint values
+        auto const mutated = std::clamp(gene + mutations_[j_idx] * half_spans_[j_idx],
+                                        lower_limits_[j_idx],
+                                        upper_limits_[j_idx]);
+
+        // Approximate gradient
+        gradient[j_idx] = mutated - gene;
+        genes[j_idx] = mutated;
+    }
+}
+
+void MemeticIk::reproduce(Robot const& robot,
+                          CostFn const& cost_fn,
+                          Rng& rng,
+                          StopFlags const& stop,
+                          BatchCostFn const& batch_cost_fn) {
+    PICK_IK_TRACE_SCOPE("MemeticIk::reproduce");
     // Reset mating pool
     mating_pool_.resize(params_.elite_size);
     for (size_t i = 0; i < params_.elite_size; ++i) {
-        mating_pool_[i] = &population_[i];
+        mating_pool_[i] = order_[i];
+    }
+
+    auto const select_parents = [this, &rng]() {
+        size_t const idxA = rng.uniform_int(0, mating_pool_.size() - 1);
+        size_t idxB = idxA;
+        while (idxB == idxA && mating_pool_.size() > 1) {
+            idxB = rng.uniform_int(0, mating_pool_.size() - 1);
+        }
+        return std::make_pair(mating_pool_[idxA], mating_pool_[idxB]);
+    };
+
+    if (batch_cost_fn) {
+        if (stop.isSet()) {
+            return;
+        }
+
+        // The children are only evaluated once all of them exist, so the mating pool cannot be
+        // pruned within a generation.
+        for (size_t i = params_.elite_size; i < params_.population_size; ++i) {
+            auto const [parentA, parentB] = select_parents();
+            crossover(order_[i], parentA, parentB, rng);
+        }
+
+        // Children are scattered over the arena, so gather them into contiguous rows first.
+        auto const num_children = params_.population_size - params_.elite_size;
+        for (size_t i = 0; i < num_children; ++i) {
+            auto const* genes = genesOf(order_[params_.elite_size + i]);
+            std::copy(genes, genes + dof_, batch_genes_.data() + i * dof_);
+        }
+        batch_cost_fn(batch_genes_.data(), num_children, batch_costs_.data());
+        for (size_t i = 0; i < num_children; ++i) {
+            fitness_[order_[params_.elite_size + i]] = batch_costs_[i];
+        }
+        return;
     }
 
     for (size_t i = params_.elite_size; i < params_.population_size; ++i) {
+        // Children not reproduced yet keep their previous genes and fitness.
+        if (stop.isSet()) {
+            return;
+        }
+
         // Select parents from the mating pool
         // Note that we permit there being only one parent, which basically counts as just
         // mutations.
+        auto const child = order_[i];
         if (!mating_pool_.empty()) {
-            size_t const idxA = rsl::uniform_int<size_t>(0, mating_pool_.size() - 1);
-            size_t idxB = idxA;
-            while (idxB == idxA && mating_pool_.size() > 1) {
-                idxB = rsl::uniform_int<size_t>(0, mating_pool_.size() - 1);
-            }
-            auto& parentA = *(mating_pool_[idxA]);
-            auto& parentB = *(mating_pool_[idxB]);
-
-            // Get mutation probability
-            double const extinction = 0.5 * (parentA.extinction + parentB.extinction);
-            double const mutation_prob =
-                extinction * (1.0 - inverse_gene_size_) + inverse_gene_size_;
-
-            auto const mix_ratio = rsl::uniform_real(0.0, 1.0);
-            for (size_t j_idx = 0; j_idx < robot.variables.size(); ++j_idx) {
-                auto& gene = population_[i].genes[j_idx];
-                auto joint = robot.variables[j_idx];
-
-                // Reproduce
-                gene = mix_ratio * parentA.genes[j_idx] + (1.0 - mix_ratio) * parentB.genes[j_idx];
-
-                // Add in parent gradients
-                gene += rsl::uniform_real(0.0, 1.0) * parentA.gradient[j_idx] +
-                        rsl::uniform_real(0.0, 1.0) * parentB.gradient[j_idx];
-                auto original_gene = gene;
-
-                // Mutate
-                if (rsl::uniform_real(0.0, 1.0) < mutation_prob) {
-                    gene += extinction * joint.half_span * rsl::uniform_real(-1.0, 1.0);
-                }
-
-                // Clamp to valid joint values
-                gene = robot.variables[j_idx].clamp_to_limits(gene);
-
-                // Approximate gradient
-                population_[i].gradient[j_idx] = gene - original_gene;
-            }
+            auto const [parentA, parentB] = select_parents();
+            crossover(child, parentA, parentB, rng);
 
             // Evaluate fitness and remove parents from the mating pool if a child with better
             // fitness exists.
-            population_[i].fitness = cost_fn(population_[i].genes);
-            if (population_[i].fitness < parentA.fitness) {
-                auto it = std::find(mating_pool_.begin(), mating_pool_.end(), &parentA);
+            fitness_[child] = evaluate(child, cost_fn);
+            if (fitness_[child] < fitness_[parentA]) {
+                auto it = std::find(mating_pool_.begin(), mating_pool_.end(), parentA);
                 if (it != mating_pool_.end()) mating_pool_.erase(it);
             }
-            if (population_[i].fitness < parentB.fitness) {
-                auto it = std::find(mating_pool_.begin(), mating_pool_.end(), &parentB);
+            if (fitness_[child] < fitness_[parentB]) {
+                auto it = std::find(mating_pool_.begin(), mating_pool_.end(), parentB);
                 if (it != mating_pool_.end()) mating_pool_.erase(it);
             }
 
         } else {
             // If the mating pool is empty, roll a new population member randomly.
-            robot.set_random_valid_configuration(population_[i].genes);
-            population_[i].fitness = cost_fn(population_[i].genes);
-            for (auto& g : population_[i].gradient) {
-                g = 0.0;
-            }
+            auto* const genes = genesOf(child);
+            auto* const gradient = gradientOf(child);
+            std::copy(genes, genes + dof_, scratch_genes_.begin());
+            robot.set_random_valid_configuration(scratch_genes_, rng);
+            std::copy(scratch_genes_.cbegin(), scratch_genes_.cend(), genes);
+            fitness_[child] = cost_fn(scratch_genes_);
+            std::fill(gradient, gradient + dof_, 0.0);
         }
     }
 }
@@ -192,17 +379,18 @@ void MemeticIk::reproduce(Robot const& robot, CostFn const& cost_fn) {
 void MemeticIk::printPopulation() const {
     fmt::print("Fitnesses:\n");
     for (size_t i = 0; i < populationCount(); ++i) {
-        fmt::print("{}: {}\n", i, population_[i].fitness);
+        fmt::print("{}: {}\n", i, fitness_[order_[i]]);
     }
     fmt::print("\n");
 }
 
 void MemeticIk::sortPopulation() {
-    std::sort(population_.begin(), population_.end(), [](Individual const& a, Individual const& b) {
-        return a.fitness < b.fitness;
+    PICK_IK_TRACE_SCOPE("MemeticIk::sortPopulation");
+    std::sort(order_.begin(), order_.end(), [this](size_t a, size_t b) {
+        return fitness_[a] < fitness_[b];
     });
     computeExtinctions();
-    best_curr_ = population_[0];
+    copyToIndividual(order_[0], best_curr_);
     if (best_curr_.fitness < best_.fitness) {
         best_ = best_curr_;
     }
@@ -215,58 +403,112 @@ auto ik_memetic_impl(std::vector<double> const& initial_guess,
                      MemeticIkParams const& params,
                      std::atomic<bool>& terminate,
                      bool approx_solution,
-                     bool print_debug) -> std::optional<Individual> {
+                     bool print_debug,
+                     CostGradientFn const& gradient_fn,
+                     BatchCostFn const& batch_cost_fn,
+                     ThreadPool* thread_pool,
+                     MigrationRing* inbox,
+                     MigrationRing* outbox,
+                     std::vector<std::vector<double>> const& elite_guesses,
+                     std::atomic<bool> const* cancel,
+                     SolveStats* stats) -> std::optional<Individual> {
+    PICK_IK_TRACE_SCOPE("ik_memetic_impl");
     assert(robot.variables.size() == initial_guess.size());
     auto ik = MemeticIk::from(initial_guess, cost_fn, params);
+    auto rng = Rng(params.seed);
+    auto const stop = StopFlags{&terminate, cancel};
 
-    ik.initPopulation(robot, cost_fn, initial_guess);
+    ik.initPopulation(robot, cost_fn, initial_guess, rng, batch_cost_fn, elite_guesses);
+
+    // Fitness of the best individual when it last failed the solution test. The best individual
+    // only changes when the fitness improves, so until then it does not need to be tested again.
+    std::optional<double> rejected_fitness;
+
+    // Counters of this species, added to stats when it finishes.
+    auto species_stats = SolveStats{};
+    std::vector<size_t> gd_iterations(ik.eliteCount(), 0);
+    auto const record_stats = [&] {
+        if (stats == nullptr) {
+            return;
+        }
+        merge(*stats, species_stats);
+    };
 
     // Main loop
     int iter = 0;
     auto const timeout_point =
         std::chrono::system_clock::now() + std::chrono::duration<double>(params.max_time);
     while ((std::chrono::system_clock::now() < timeout_point) && (iter < params.max_generations)) {
+        auto const gd_start = std::chrono::steady_clock::now();
+
         // Do gradient descent on elites.
-        std::vector<std::thread> gd_threads;
-        gd_threads.reserve(ik.eliteCount());
+        TaskGroup gd_tasks(thread_pool);
         for (size_t i = 0; i < ik.eliteCount(); ++i) {
-            gd_threads.push_back(std::thread([&ik, i, &robot, cost_fn, &params] {
-                ik.gradientDescent(i, robot, cost_fn, params.gd_params);
-            }));
-        }
-        for (auto& t : gd_threads) {
-            t.join();
+            gd_tasks.run([&ik, i, &robot, &cost_fn, &params, &gradient_fn, &stop, &gd_iterations] {
+                gd_iterations[i] =
+                    ik.gradientDescent(i, robot, cost_fn, params.gd_params, gradient_fn, stop);
+            });
         }
+        gd_tasks.wait();
+        auto const reproduction_start = std::chrono::steady_clock::now();
 
         // Perform mutation and recombination
-        ik.reproduce(robot, cost_fn);
+        ik.reproduce(robot, cost_fn, rng, stop, batch_cost_fn);
+        auto const sort_start = std::chrono::steady_clock::now();
 
         // Sort fitnesses and update extinctions
         ik.sortPopulation();
+        auto const sort_end = std::chrono::steady_clock::now();
+
+        ++species_stats.generations;
+        for (auto const iterations : gd_iterations) {
+            species_stats.gradient_iterations += iterations;
+        }
+        species_stats.descent_time +=
+            std::chrono::duration<double>(reproduction_start - gd_start).count();
+        species_stats.reproduction_time +=
+            std::chrono::duration<double>(sort_start - reproduction_start).count();
+        species_stats.sort_time += std::chrono::duration<double>(sort_end - sort_start).count();
+
         if (print_debug) {
             fmt::print("Iteration {}\n", iter);
             ik.printPopulation();
         }
 
         // Check for termination and wipeout conditions
-        if (params.stop_optimization_on_valid_solution && solution_fn(ik.best().genes)) {
-            if (print_debug) fmt::print("Found solution!\n");
-            return ik.best();
-        }
-        if (ik.checkWipeout()) {
-            // Ensure the first member of the new population is the best so far.
-            if (print_debug) fmt::print("Population wipeout\n");
-            ik.initPopulation(robot, cost_fn, ik.best().genes);
+        if (params.stop_optimization_on_valid_solution && rejected_fitness != ik.best().fitness) {
+            if (solution_fn(ik.best().genes)) {
+                if (print_debug) fmt::print("Found solution!\n");
+                record_stats();
+                return ik.best();
+            }
+            rejected_fitness = ik.best().fitness;
         }
 
-        // Check termination condition from other threads finding a solution.
-        if (terminate) {
+        // Check termination condition from other threads finding a solution, or the caller.
+        if (stop.isSet()) {
             if (print_debug) fmt::print("Terminated\n");
             break;
         }
 
+        // Exchange the best individuals with the neighboring species. Immigrants that are better
+        // than this species' best also become the seed of the next wipeout.
+        if (params.migration_interval > 0 &&
+            static_cast<size_t>(iter + 1) % params.migration_interval == 0) {
+            if (outbox != nullptr) ik.emigrate(*outbox, params.num_migrants);
+            if (inbox != nullptr) ik.immigrate(*inbox);
+        }
+
+        if (ik.checkWipeout()) {
+            // Ensure the first member of the new population is the best so far.
+            if (print_debug) fmt::print("Population wipeout\n");
+            ik.initPopulation(robot, cost_fn, ik.best().genes, rng, batch_cost_fn);
+            ++species_stats.wipeouts;
+        }
+
         iter++;
     }
+    record_stats();
 
     // If we kept optimizing, we need to check if we found a valid solution
     if (!params.stop_optimization_on_valid_solution && solution_fn(ik.best().genes)) {
@@ -288,13 +530,28 @@ auto ik_memetic(std::vector<double> const& initial_guess,
                 SolutionTestFn const& solution_fn,
                 MemeticIkParams const& params,
                 bool approx_solution,
-                bool print_debug) -> std::optional<std::vector<double>> {
+                bool print_debug,
+                CostGradientFn const& gradient_fn,
+                BatchCostFn const& batch_cost_fn,
+                ThreadPool* thread_pool,
+                std::vector<std::vector<double>> const& elite_guesses,
+                std::shared_ptr<std::atomic<bool> const> cancel,
+                SolveStats* stats) -> std::optional<std::vector<double>> {
+    PICK_IK_TRACE_SCOPE("ik_memetic");
     // Check whether the initial guess already meets the goal,
     // before starting to solve.
     if (params.stop_optimization_on_valid_solution && solution_fn(initial_guess)) {
         return initial_guess;
     }
 
+    // Without a pool from the caller, keep one for the duration of this solve so that threads are
+    // at least reused across generations.
+    auto owned_thread_pool = std::unique_ptr<ThreadPool>{};
+    if (thread_pool == nullptr) {
+        owned_thread_pool = std::make_unique<ThreadPool>(params.num_threads * params.elite_size);
+        thread_pool = owned_thread_pool.get();
+    }
+
     std::atomic<bool> terminate{false};
     if (params.num_threads <= 1) {
         // Single-threaded implementation
@@ -305,69 +562,138 @@ auto ik_memetic(std::vector<double> const& initial_guess,
                                               params,
                                               terminate,
                                               approx_solution,
-                                              print_debug);
+                                              print_debug,
+                                              gradient_fn,
+                                              batch_cost_fn,
+                                              thread_pool,
+                                              nullptr,
+                                              nullptr,
+                                              elite_guesses,
+                                              cancel.get(),
+                                              stats);
         if (maybe_solution.has_value()) {
+            if (stats != nullptr) {
+                stats->species_wins.resize(std::max<size_t>(stats->species_wins.size(), 1), 0);
+                ++stats->species_wins[0];
+            }
             return maybe_solution.value().genes;
         }
     } else {
         // Multi-threaded implementation
-        rsl::Queue<std::optional<Individual>> solution_queue;
-        std::vector<std::thread> ik_threads;
-        ik_threads.reserve(params.num_threads);
+        // Every species is joined before returning, as the functions may reference the caller's
+        // state.
+        struct SpeciesResults {
+            std::mutex mutex;
+            std::vector<Individual> solutions;
+            std::vector<size_t> solution_species;  // Species that found each of the solutions.
+            std::optional<Individual> first_valid_solution;
+            std::optional<size_t> first_valid_species;
+            SolveStats stats;
+        };
+        auto results = SpeciesResults{};
+
+        // Species i receives migrants from species i - 1 in migration_rings[i].
+        auto migration_rings = std::vector<std::unique_ptr<MigrationRing>>{};
+        if (params.migration_interval > 0) {
+            for (size_t i = 0; i < params.num_threads; ++i) {
+                migration_rings.push_back(std::make_unique<MigrationRing>(2 * params.num_migrants));
+            }
+        }
 
-        auto ik_thread_fn = [=, &terminate, &solution_queue]() {
+        auto const stop = StopFlags{&terminate, cancel.get()};
+        auto ik_thread_fn = [&](size_t species) {
+            // Species that only start once another one found a solution, or the caller cancelled
+            // the solve, have nothing to add.
+            if (stop.isSet()) {
+                return;
+            }
+            auto* const inbox = migration_rings.empty() ? nullptr : migration_rings[species].get();
+            auto* const outbox =
+                migration_rings.empty()
+                    ? nullptr
+                    : migration_rings[(species + 1) % migration_rings.size()].get();
+            auto species_params = params;
+            species_params.seed = stream_seed(params.seed, species);
+            auto species_stats = SolveStats{};
             auto soln = ik_memetic_impl(initial_guess,
                                         robot,
                                         cost_fn,
                                         solution_fn,
-                                        params,
+                                        species_params,
                                         terminate,
                                         approx_solution,
-                                        print_debug);
-            solution_queue.push(soln);
+                                        print_debug,
+                                        gradient_fn,
+                                        batch_cost_fn,
+                                        thread_pool,
+                                        inbox,
+                                        outbox,
+                                        elite_guesses,
+                                        cancel.get(),
+                                        &species_stats);
+            if (!soln.has_value()) {
+                std::scoped_lock lock(results.mutex);
+                merge(results.stats, species_stats);
+                return;
+            }
+
+            // If enabled, stop all other species once one of them finds a valid solution.
+            auto const is_valid =
+                params.stop_on_first_soln && !terminate && solution_fn(soln->genes);
+            std::scoped_lock lock(results.mutex);
+            merge(results.stats, species_stats);
+            if (is_valid && !results.first_valid_solution.has_value()) {
+                results.first_valid_solution = soln;
+                results.first_valid_species = species;
+                terminate = true;
+            }
+            results.solutions.push_back(std::move(*soln));
+            results.solution_species.push_back(species);
         };
 
+        TaskGroup ik_tasks(thread_pool);
         for (size_t i = 0; i < params.num_threads; ++i) {
-            ik_threads.push_back(std::thread(ik_thread_fn));
+            ik_tasks.run([&ik_thread_fn, i] { ik_thread_fn(i); });
+        }
+
+        // The caller stops running species itself as soon as one of them found a valid solution or
+        // the solve is cancelled, then waits for the others, which check both flags on every step.
+        if (!ik_tasks.wait_until([&stop] { return stop.isSet(); })) {
+            ik_tasks.wait();
         }
 
-        // If enabled, stop all other threads once one thread finds a valid solution.
-        size_t n_threads_done = 0;
+        auto const record_win = [&](size_t species) {
+            if (stats == nullptr) {
+                return;
+            }
+            merge(*stats, results.stats);
+            stats->species_wins.resize(std::max(stats->species_wins.size(), params.num_threads), 0);
+            ++stats->species_wins[species];
+        };
+        if (results.first_valid_solution.has_value()) {
+            record_win(results.first_valid_species.value());
+            return results.first_valid_solution->genes;
+        }
+
+        // Get the minimum-cost solution from all threads.
         std::vector<double> best_solution;
+        auto best_species = size_t{0};
         auto min_cost = std::numeric_limits<double>::max();
-        auto maybe_solution = std::optional<std::optional<Individual>>{std::nullopt};
-        if (params.stop_on_first_soln) {
-            while (!maybe_solution && (n_threads_done < params.num_threads)) {
-                maybe_solution = solution_queue.pop(std::chrono::milliseconds(1));
-            }
-            if (maybe_solution.value().has_value()) {
-                auto const& solution = maybe_solution.value().value();
+        for (size_t i = 0; i < results.solutions.size(); ++i) {
+            auto const& solution = results.solutions[i];
+            if (solution.fitness < min_cost) {
                 best_solution = solution.genes;
+                best_species = results.solution_species[i];
                 min_cost = solution.fitness;
-                terminate = true;
             }
-            n_threads_done++;
         }
-
-        for (auto& t : ik_threads) {
-            t.join();
+        if (!best_solution.empty()) {
+            record_win(best_species);
+            return best_solution;
         }
-
-        // Get the minimum-cost solution from all threads.
-        // Note that if approximate solutions are enabled, even if we terminate threads early, we
-        // can still compare our first solution with the approximate ones from the other threads
-        while (!solution_queue.empty()) {
-            maybe_solution = solution_queue.pop();
-            if (maybe_solution.value().has_value()) {
-                auto const& solution = maybe_solution.value().value();
-                auto const& cost = solution.fitness;
-                if (cost < min_cost) {
-                    best_solution = solution.genes;
-                    min_cost = cost;
-                }
-            }
+        if (stats != nullptr) {
+            merge(*stats, results.stats);
         }
-        if (!best_solution.empty()) return best_solution;
     }
     return std::nullopt;
 }
@@ -0,0 +1,46 @@
+#include <pick_ik/ik_stream.hpp>
+#include <pick_ik/robot.hpp>
+
+#include <cassert>
+#include <utility>
+#include <vector>
+
+namespace pick_ik {
+
+auto reset(IkStream& self, std::vector<double> const& seed_state) -> void {
+    self.solutions.clear();
+    record_solution(self, seed_state);
+}
+
+auto record_solution(IkStream& self, std::vector<double> const& solution) -> void {
+    if (self.history_size == 0) {
+        return;
+    }
+    if (self.solutions.size() == self.history_size) {
+        // Reuse the storage of the oldest solution for the newest one.
+        auto oldest = std::move(self.solutions.front());
+        self.solutions.erase(self.solutions.begin());
+        oldest = solution;
+        self.solutions.push_back(std::move(oldest));
+    } else {
+        self.solutions.push_back(solution);
+    }
+}
+
+auto predict_seed(IkStream const& self, Robot const& robot) -> std::vector<double> {
+    if (self.solutions.empty()) {
+        return {};
+    }
+    auto seed = self.solutions.back();
+    if (self.solutions.size() < 2) {
+        return seed;
+    }
+    auto const& previous = self.solutions[self.solutions.size() - 2];
+    assert(seed.size() == robot.variables.size() && previous.size() == seed.size());
+    for (size_t i = 0; i < seed.size(); ++i) {
+        seed[i] = robot.variables[i].clamp_to_limits(2.0 * seed[i] - previous[i]);
+    }
+    return seed;
+}
+
+}  // namespace pick_ik
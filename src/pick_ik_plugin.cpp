@@ -1,26 +1,188 @@
-#include <pick_ik/fk_moveit.hpp>
+#include <pick_ik/batch_ik.hpp>
+#include <pick_ik/cost_evaluator.hpp>
+#include <pick_ik/forward_kinematics.hpp>
 #include <pick_ik/goal.hpp>
+#include <pick_ik/halton.hpp>
+#include <pick_ik/hybrid_ik.hpp>
+#include <pick_ik/ik_dls.hpp>
 #include <pick_ik/ik_gradient.hpp>
 #include <pick_ik/ik_memetic.hpp>
+#include <pick_ik/ik_stream.hpp>
+#include <pick_ik/random.hpp>
+#include <pick_ik/restart_portfolio.hpp>
 #include <pick_ik/robot.hpp>
+#include <pick_ik/seed_database.hpp>
+#include <pick_ik/solution_cache.hpp>
+#include <pick_ik/solve_stats.hpp>
+#include <pick_ik/thread_local_cache.hpp>
+#include <pick_ik/thread_pool.hpp>
+#include <pick_ik/trace.hpp>
 
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
 #include <pick_ik_parameters.hpp>
 #include <pluginlib/class_list_macros.hpp>
 #include <rclcpp/rclcpp.hpp>
+#include <rsl/random.hpp>
+#include <tf2_eigen/tf2_eigen.hpp>
 
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <iterator>
+#include <memory>
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/robot_model/joint_model_group.h>
 #include <moveit/robot_state/robot_state.h>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace pick_ik {
 namespace {
 auto const LOGGER = rclcpp::get_logger("pick_ik");
+
+// Joint vectors whose frames getPositionFKBatch computes together, few enough for the batch frames
+// to stay in cache.
+constexpr size_t kFkBatchSize = 256;
+
+// Solver settings derived from the parameters, rebuilt only when the parameters change.
+struct SolveContext {
+    Params params;
+
+    // Frame test thresholds, unset for the parts of the pose that are not optimized.
+    std::optional<double> position_threshold;
+    std::optional<double> orientation_threshold;
+    std::optional<double> approximate_solution_position_threshold;
+    std::optional<double> approximate_solution_orientation_threshold;
+
+    // Solver parameters, except for the time limits which depend on each request.
+    MemeticIkParams memetic_params;
+    GradientIkParams gd_params;
+    DlsIkParams dls_params;
+
+    // Goals that do not depend on the request, and the minimal displacement goal, whose initial
+    // guess is the seed of each request.
+    std::vector<GoalTerm> goal_terms;
+    std::optional<MinimalDisplacementCost> minimal_displacement;
+
+    // Solutions of previous requests, if enabled. Replacing the context with new parameters also
+    // starts a new cache, as the cached solutions may not solve their goals anymore.
+    std::shared_ptr<SolutionCache> solution_cache;
+
+    // Workspace samples whose configurations seed the global solver, if a database is set.
+    std::shared_ptr<SeedDatabase const> seed_database;
+
+    // Why the parameters cannot solve any request, if they cannot. It is logged once, when the
+    // context is built, and every request fails with it.
+    std::optional<std::string> error;
+
+    static auto from(Params params, Robot const& robot) -> SolveContext;
+};
+
+auto SolveContext::from(Params params, Robot const& robot) -> SolveContext {
+    auto context = SolveContext{};
+
+    if (params.position_scale > 0) {
+        context.position_threshold = params.position_threshold;
+        context.approximate_solution_position_threshold =
+            params.approximate_solution_position_threshold;
+    }
+    if (params.rotation_scale > 0) {
+        context.orientation_threshold = params.orientation_threshold;
+        context.approximate_solution_orientation_threshold =
+            params.approximate_solution_orientation_threshold;
+    }
+
+    auto& ik_params = context.memetic_params;
+    ik_params.population_size = static_cast<size_t>(params.memetic_population_size);
+    ik_params.elite_size = static_cast<size_t>(params.memetic_elite_size);
+    ik_params.wipeout_fitness_tol = params.memetic_wipeout_fitness_tol;
+    ik_params.stop_optimization_on_valid_solution = params.stop_optimization_on_valid_solution;
+    ik_params.num_threads = static_cast<size_t>(params.memetic_num_threads);
+    ik_params.stop_on_first_soln = params.memetic_stop_on_first_solution;
+    ik_params.migration_interval = static_cast<size_t>(params.memetic_migration_interval);
+    ik_params.num_migrants = static_cast<size_t>(params.memetic_num_migrants);
+    ik_params.max_generations = static_cast<int>(params.memetic_max_generations);
+    ik_params.gd_params.step_size = params.gd_step_size;
+    ik_params.gd_params.min_cost_delta = params.gd_min_cost_delta;
+    ik_params.gd_params.max_iterations = static_cast<int>(params.memetic_gd_max_iters);
+    ik_params.gd_params.max_time = params.memetic_gd_max_time;
+
+    auto& gd_params = context.gd_params;
+    gd_params.step_size = params.gd_step_size;
+    gd_params.min_cost_delta = params.gd_min_cost_delta;
+    gd_params.max_iterations = static_cast<int>(params.gd_max_iters);
+    gd_params.stop_optimization_on_valid_solution = params.stop_optimization_on_valid_solution;
+
+    auto& dls_params = context.dls_params;
+    dls_params.initial_damping = params.dls_initial_damping;
+    dls_params.min_cost_delta = params.gd_min_cost_delta;
+    dls_params.max_iterations = static_cast<int>(params.dls_max_iters);
+    dls_params.stop_optimization_on_valid_solution = params.stop_optimization_on_valid_solution;
+
+    if (params.center_joints_weight > 0.0) {
+        context.goal_terms.push_back(
+            GoalTerm{CenterJointsCost::from(robot), params.center_joints_weight});
+    }
+    if (params.avoid_joint_limits_weight > 0.0) {
+        context.goal_terms.push_back(
+            GoalTerm{AvoidJointLimitsCost::from(robot), params.avoid_joint_limits_weight});
+    }
+    if (params.minimal_displacement_weight > 0.0) {
+        context.minimal_displacement = MinimalDisplacementCost::from(
+            robot, std::vector<double>(robot.variables.size(), 0.0));
+    }
+
+    if (params.solution_cache_max_bytes > 0) {
+        auto cache_params = SolutionCacheParams{};
+        cache_params.max_bytes = static_cast<size_t>(params.solution_cache_max_bytes);
+        if (params.position_scale > 0) {
+            cache_params.position_tolerance = params.solution_cache_position_tolerance;
+        }
+        if (params.rotation_scale > 0) {
+            cache_params.orientation_tolerance = params.solution_cache_orientation_tolerance;
+        }
+        context.solution_cache = std::make_shared<SolutionCache>(cache_params);
+    }
+
+    context.params = std::move(params);
+    return context;
 }
 
-class PickIKPlugin : public kinematics::KinematicsBase {
+// Counts the calls of an analytic cost gradient, each of which evaluates the frames once.
+auto count_evaluations(CostGradientFn gradient_fn, std::shared_ptr<EvaluationCounters> counters)
+    -> CostGradientFn {
+    return [gradient_fn = std::move(gradient_fn), counters = std::move(counters)](
+               std::vector<double> const& active_positions, std::vector<double>& gradient) {
+        counters->cost_evaluations.fetch_add(1, std::memory_order_relaxed);
+        counters->fk_evaluations.fetch_add(1, std::memory_order_relaxed);
+        return gradient_fn(active_positions, gradient);
+    };
+}
+
+// Counts the configurations evaluated by a batched cost function.
+auto count_evaluations(BatchCostFn batch_cost_fn, std::shared_ptr<EvaluationCounters> counters)
+    -> BatchCostFn {
+    return [batch_cost_fn = std::move(batch_cost_fn), counters = std::move(counters)](
+               double const* configurations, size_t count, double* costs) {
+        counters->cost_evaluations.fetch_add(count, std::memory_order_relaxed);
+        counters->fk_evaluations.fetch_add(count, std::memory_order_relaxed);
+        batch_cost_fn(configurations, count, costs);
+    };
+}
+}  // namespace
+
+class PickIKPlugin : public kinematics::KinematicsBase,
+                     public BatchIkSolver,
+                     public StreamingIkSolver,
+                     public CachingIkSolver,
+                     public HybridIkSolver {
     rclcpp::Node::SharedPtr node_;
     std::shared_ptr<ParamListener> parameter_listener_;
     moveit::core::JointModelGroup const* jmg_;
@@ -29,79 +191,179 @@ class PickIKPlugin : public kinematics::KinematicsBase {
     std::vector<std::string> link_names_;
     std::vector<size_t> tip_link_indices_;
     Robot robot_;
+    std::shared_ptr<KinematicChain const> chain_;
+    FkFn fk_fn_;
 
-    mutable std::mutex fk_mutex_;
+    // Identifies the samples of seed databases built for the group and its first tip frame.
+    uint64_t model_hash_ = 0;
 
-   public:
-    virtual bool initialize(rclcpp::Node::SharedPtr const& node,
-                            moveit::core::RobotModel const& robot_model,
-                            std::string const& group_name,
-                            std::string const& base_frame,
-                            std::vector<std::string> const& tip_frames,
-                            double search_discretization) {
-        node_ = node;
-        parameter_listener_ = std::make_shared<ParamListener>(
-            node,
-            std::string("robot_description_kinematics.").append(group_name));
+    // Chain whose first tip is the base frame, followed by every link of the group and the tip
+    // frames, for FK queries. Unset if the base frame is not a link of the robot model.
+    std::shared_ptr<KinematicChain const> fk_chain_;
+    std::unordered_map<std::string, size_t> fk_tips_;  // FK chain tip of each link name.
 
-        // Initialize internal state of base class KinematicsBase
-        // Creates these internal state variables:
-        // robot_model_ <- shared_ptr to RobotModel
-        // robot_description_ <- empty string
-        // group_name_ <- group_name string
-        // base_frame_ <- base_frame without leading /
-        // tip_frames_ <- tip_frames without leading /
-        // redundant_joint_discretization_ <- vector initialized with
-        // search_discretization
-        storeValues(robot_model, group_name, base_frame, tip_frames, search_discretization);
+    // Long-lived workers for memetic species and elite gradient descent, reused across solves.
+    std::unique_ptr<ThreadPool> thread_pool_;
 
-        // Initialize internal state
-        jmg_ = robot_model_->getJointModelGroup(group_name);
-        if (!jmg_) {
-            RCLCPP_ERROR(LOGGER, "failed to get joint model group %s", group_name.c_str());
-            return false;
+    // Transform of the base frame, if it does not depend on the group variables.
+    std::optional<Eigen::Isometry3d> base_frame_transform_;
+
+    mutable std::mutex hybrid_stats_mutex_;
+    mutable HybridIkStats hybrid_stats_;
+
+    // Settings for the current parameters, replaced when the parameters change. Solves keep their
+    // own reference, so replacing it does not affect solves in progress.
+    mutable std::mutex solve_context_mutex_;
+    mutable std::shared_ptr<SolveContext const> solve_context_;
+
+    // Solver statistics since they were last published, if telemetry is enabled. The timer is
+    // declared last, so that it is destroyed before the state it publishes.
+    mutable std::mutex solve_stats_mutex_;
+    mutable SolveStats solve_stats_;
+    rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr telemetry_publisher_;
+    rclcpp::TimerBase::SharedPtr telemetry_timer_;
+
+    void record_solve_stats(SolveStats const& stats) const {
+        std::lock_guard<std::mutex> lock(solve_stats_mutex_);
+        merge(solve_stats_, stats);
+    }
+
+    // Publishes the statistics of the solves since the last call and starts over.
+    void publish_telemetry() {
+        auto stats = SolveStats{};
+        {
+            std::lock_guard<std::mutex> lock(solve_stats_mutex_);
+            std::swap(stats, solve_stats_);
         }
 
-        // Joint names come from jmg
-        for (auto* joint_model : jmg_->getJointModels()) {
-            if (joint_model->getName() != base_frame_ &&
-                joint_model->getType() != moveit::core::JointModel::UNKNOWN &&
-                joint_model->getType() != moveit::core::JointModel::FIXED) {
-                joint_names_.push_back(joint_model->getName());
-            }
+        auto status = diagnostic_msgs::msg::DiagnosticStatus{};
+        status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+        status.name = "pick_ik: " + jmg_->getName();
+        auto const add_value = [&status](std::string key, std::string value) {
+            auto key_value = diagnostic_msgs::msg::KeyValue{};
+            key_value.key = std::move(key);
+            key_value.value = std::move(value);
+            status.values.push_back(std::move(key_value));
+        };
+        add_value("solves", std::to_string(stats.solves));
+        add_value("successes", std::to_string(stats.successes));
+        add_value("restarts", std::to_string(stats.restarts));
+        add_value("generations", std::to_string(stats.generations));
+        add_value("wipeouts", std::to_string(stats.wipeouts));
+        add_value("gradient_iterations", std::to_string(stats.gradient_iterations));
+        add_value("cost_evaluations", std::to_string(stats.cost_evaluations));
+        add_value("fk_evaluations", std::to_string(stats.fk_evaluations));
+        add_value("descent_time", std::to_string(stats.descent_time));
+        add_value("reproduction_time", std::to_string(stats.reproduction_time));
+        add_value("sort_time", std::to_string(stats.sort_time));
+        auto species_wins = std::string{};
+        for (auto const wins : stats.species_wins) {
+            species_wins += (species_wins.empty() ? "" : " ") + std::to_string(wins);
         }
+        add_value("species_wins", std::move(species_wins));
 
-        // link_names are the same as tip frames
-        // TODO: why do we need to set this
-        link_names_ = tip_frames_;
+        auto message = diagnostic_msgs::msg::DiagnosticArray{};
+        message.header.stamp = node_->now();
+        message.status.push_back(std::move(status));
+        telemetry_publisher_->publish(message);
+    }
 
-        // Create our internal Robot object from the robot model
-        tip_link_indices_ =
-            get_link_indices(robot_model_, tip_frames_)
-                .or_else([](auto const& error) { throw std::invalid_argument(error); })
-                .value();
-        robot_ = Robot::from(robot_model_, jmg_, tip_link_indices_);
+    auto get_solve_context() const -> std::shared_ptr<SolveContext const> {
+        std::lock_guard<std::mutex> lock(solve_context_mutex_);
+        if (parameter_listener_->is_old(solve_context_->params)) {
+            solve_context_ = make_solve_context(solve_context_.get());
+        }
+        return solve_context_;
+    }
 
-        return true;
+    // Settings for the current parameters. The seed database of the previous settings is kept if
+    // its path did not change.
+    auto make_solve_context(SolveContext const* previous) const
+        -> std::shared_ptr<SolveContext const> {
+        auto context = SolveContext::from(parameter_listener_->get_params(), robot_);
+        auto const& mode = context.params.mode;
+        if (mode != "global" && mode != "local" && mode != "local_dls" && mode != "hybrid") {
+            context.error = "Invalid solver mode: " + mode;
+        } else if (mode == "local_dls" && !chain_->has_analytic_jacobian) {
+            context.error = "Solver mode local_dls requires an analytic Jacobian, which is not "
+                            "available for group " +
+                            jmg_->getName();
+        }
+        if (context.error.has_value()) {
+            RCLCPP_ERROR(LOGGER, "%s", context.error->c_str());
+        }
+
+        auto const& path = context.params.memetic_seed_database_path;
+        if (previous != nullptr && previous->params.memetic_seed_database_path == path) {
+            context.seed_database = previous->seed_database;
+        } else if (!path.empty()) {
+            context.seed_database = load_group_seed_database(path);
+        }
+        return std::make_shared<SolveContext const>(std::move(context));
     }
 
-    virtual bool searchPositionIK(
-        std::vector<geometry_msgs::msg::Pose> const& ik_poses,
-        std::vector<double> const& ik_seed_state,
-        double timeout,
-        std::vector<double> const&,
-        std::vector<double>& solution,
-        IKCallbackFn const& solution_callback,
-        IKCostFn const& cost_function,
-        moveit_msgs::msg::MoveItErrorCodes& error_code,
-        kinematics::KinematicsQueryOptions const& options = kinematics::KinematicsQueryOptions(),
-        moveit::core::RobotState const* context_state = nullptr) const {
-        (void)context_state;  // not used
+    // Loads a seed database, if it was built for this group and tip.
+    auto load_group_seed_database(std::string const& path) const
+        -> std::shared_ptr<SeedDatabase const> {
+        auto database = load_seed_database(path);
+        if (!database.has_value()) {
+            RCLCPP_ERROR(LOGGER, "Cannot load seed database: %s", database.error().c_str());
+            return nullptr;
+        }
+        if (database->group_name != jmg_->getName() ||
+            database->tip_link_name != tip_frames_.front() ||
+            database->num_variables != robot_.variables.size()) {
+            RCLCPP_ERROR(LOGGER,
+                         "Seed database %s was built for group %s and tip %s, not group %s and "
+                         "tip %s",
+                         path.c_str(),
+                         database->group_name.c_str(),
+                         database->tip_link_name.c_str(),
+                         jmg_->getName().c_str(),
+                         tip_frames_.front().c_str());
+            return nullptr;
+        }
+        if (database->model_hash != model_hash_) {
+            RCLCPP_ERROR(LOGGER,
+                         "Seed database %s was built for another version of the robot model",
+                         path.c_str());
+            return nullptr;
+        }
+        return std::make_shared<SeedDatabase const>(std::move(database.value()));
+    }
 
-        // Read current ROS parameters
-        auto params = parameter_listener_->get_params();
+    // FK chain tip of a link, logging an error if the link is not part of the group.
+    auto get_fk_tip(std::string const& link_name) const -> std::optional<size_t> {
+        auto const tip = fk_tips_.find(link_name);
+        if (tip == fk_tips_.end()) {
+            RCLCPP_ERROR(LOGGER,
+                         "Cannot compute FK of link %s, which is not part of group %s",
+                         link_name.c_str(),
+                         jmg_->getName().c_str());
+            return std::nullopt;
+        }
+        return tip->second;
+    }
+
+    // Solves one request with the settings of a solve context. Requests of a streaming session
+    // pass its stream, and their seed state is the seed predicted by the stream.
+    bool solve(SolveContext const& context,
+               std::vector<geometry_msgs::msg::Pose> const& ik_poses,
+               std::vector<double> const& ik_seed_state,
+               double timeout,
+               std::vector<double>& solution,
+               IKCallbackFn const& solution_callback,
+               IKCostFn const& cost_function,
+               moveit_msgs::msg::MoveItErrorCodes& error_code,
+               kinematics::KinematicsQueryOptions const& options,
+               IkStream const* stream = nullptr) const {
+        PICK_IK_TRACE_SCOPE("PickIKPlugin::solve");
+        auto const& params = context.params;
 
         auto const goal_frames = [&]() {
+            if (base_frame_transform_.has_value()) {
+                return transform_poses_to_frames(base_frame_transform_.value(), ik_poses);
+            }
             auto robot_state = moveit::core::RobotState(robot_model_);
             robot_state.setToDefaultValues();
             robot_state.setJointGroupPositions(jmg_, ik_seed_state);
@@ -110,53 +372,96 @@ class PickIKPlugin : public kinematics::KinematicsBase {
         }();
 
         // Test functions to determine if we are at our goal frame
-        auto const test_position = (params.position_scale > 0);
-        std::optional<double> position_threshold = std::nullopt;
-        if (test_position) {
-            position_threshold = params.position_threshold;
-        }
-        auto const test_rotation = (params.rotation_scale > 0);
-        std::optional<double> orientation_threshold = std::nullopt;
-        if (test_rotation) {
-            orientation_threshold = params.orientation_threshold;
-        }
-        auto const frame_tests =
-            make_frame_tests(goal_frames, position_threshold, orientation_threshold);
-
-        // Cost functions used for optimizing towards goal frames
-        auto const pose_cost_functions =
-            make_pose_cost_functions(goal_frames, params.position_scale, params.rotation_scale);
-
-        // forward kinematics function
-        auto const fk_fn = make_fk_fn(robot_model_, jmg_, fk_mutex_, tip_link_indices_);
+        auto const frame_tests = make_frame_tests(
+            goal_frames, context.position_threshold, context.orientation_threshold);
 
         // Create goals (weighted cost functions)
-        auto goals = std::vector<Goal>{};
-        if (params.center_joints_weight > 0.0) {
-            goals.push_back(Goal{make_center_joints_cost_fn(robot_), params.center_joints_weight});
-        }
-        if (params.avoid_joint_limits_weight > 0.0) {
-            goals.push_back(
-                Goal{make_avoid_joint_limits_cost_fn(robot_), params.avoid_joint_limits_weight});
-        }
-        if (params.minimal_displacement_weight > 0.0) {
-            goals.push_back(Goal{make_minimal_displacement_cost_fn(robot_, ik_seed_state),
-                                 params.minimal_displacement_weight});
+        auto goal_terms = context.goal_terms;
+        if (context.minimal_displacement.has_value()) {
+            auto minimal_displacement = context.minimal_displacement.value();
+            minimal_displacement.initial_guess = ik_seed_state;
+            goal_terms.push_back(
+                GoalTerm{std::move(minimal_displacement), params.minimal_displacement_weight});
         }
         if (cost_function) {
             for (auto const& pose : ik_poses) {
-                goals.push_back(
-                    Goal{make_ik_cost_fn(pose, cost_function, robot_model_, jmg_, ik_seed_state),
-                         1.0});
+                goal_terms.push_back(GoalTerm{
+                    make_ik_cost_fn(pose, cost_function, robot_model_, jmg_, ik_seed_state), 1.0});
             }
         }
+        auto goals = to_goals(goal_terms);
 
-        // test if this is a valid solution
-        auto const solution_fn =
-            make_is_solution_test_fn(frame_tests, goals, params.cost_threshold, fk_fn);
+        // Evaluations are only counted while telemetry is enabled.
+        auto const counters =
+            telemetry_publisher_ ? std::make_shared<EvaluationCounters>() : nullptr;
+        auto num_restarts = size_t{0};
+        auto const record_request = [&](bool success) {
+            if (!counters) {
+                return;
+            }
+            auto stats = SolveStats{};
+            stats.solves = 1;
+            stats.successes = success ? 1 : 0;
+            stats.restarts = num_restarts;
+            stats.cost_evaluations = counters->cost_evaluations.load();
+            stats.fk_evaluations = counters->fk_evaluations.load();
+            record_solve_stats(stats);
+        };
 
-        // single function used by gradient descent to calculate cost of solution
-        auto const cost_fn = make_cost_fn(pose_cost_functions, goals, fk_fn);
+        // The parameters were reported as unusable when the context was built.
+        if (context.error.has_value()) {
+            error_code.val = error_code.FAILURE;
+            record_request(false);
+            return false;
+        }
+
+        // single function used by gradient descent to calculate cost of solution, and test if a
+        // solution is valid, which share FK and goal evaluations of the same configuration and
+        // do not allocate
+        auto const evaluation_fns = make_evaluation_fns(
+            CostEvaluator::from(
+                chain_, goal_frames, params.position_scale, params.rotation_scale, goal_terms),
+            frame_tests,
+            params.cost_threshold,
+            counters);
+        auto const& cost_fn = evaluation_fns.cost_fn;
+        auto const& solution_fn = evaluation_fns.solution_fn;
+
+        // Goals close to a cached goal start from its solution, which is returned right away if it
+        // solves this goal too. Custom cost functions cannot be told apart, so they skip the cache.
+        auto* const solution_cache = cost_function ? nullptr : context.solution_cache.get();
+        auto const cached_solution = solution_cache != nullptr
+                                         ? solution_cache->find(goal_frames)
+                                         : std::optional<std::vector<double>>{};
+        if (cached_solution.has_value() && params.stop_optimization_on_valid_solution &&
+            solution_fn(cached_solution.value())) {
+            error_code.val = error_code.SUCCESS;
+            solution = cached_solution.value();
+            if (solution_callback) {
+                solution_callback(ik_poses.front(), solution, error_code);
+            }
+            record_request(true);
+            return true;
+        }
+
+        // analytic gradient of the cost function, if the kinematic chain supports it
+        auto gradient_fn = make_cost_gradient_fn(
+            chain_, goal_frames, params.position_scale, params.rotation_scale, goals);
+
+        // batched cost function for evaluating whole memetic populations, if enabled and the chain
+        // supports it
+        auto batch_cost_fn =
+            params.memetic_batch_evaluation
+                ? make_batch_cost_fn(
+                      chain_, goal_frames, params.position_scale, params.rotation_scale, goals)
+                : BatchCostFn();
+
+        if (counters && gradient_fn) {
+            gradient_fn = count_evaluations(std::move(gradient_fn), counters);
+        }
+        if (counters && batch_cost_fn) {
+            batch_cost_fn = count_evaluations(std::move(batch_cost_fn), counters);
+        }
 
         // Set up initial optimization variables
         bool done_optimizing = false;
@@ -166,61 +471,223 @@ class PickIKPlugin : public kinematics::KinematicsBase {
         std::chrono::duration<double> const total_timeout{timeout};
         auto last_optim_time = std::chrono::system_clock::now();
 
+        // Random seeds and the seeds of the solvers are drawn from a stream of the request seed,
+        // in the order of the solves, so that a fixed seed reproduces the request.
+        auto rng = Rng(params.random_seed >= 0 ? static_cast<uint64_t>(params.random_seed)
+                                               : uint64_t{rsl::rng()()});
+
+        // The global solves of this request share the scrambling of the sequence, and each of their
+        // species takes points from its own start.
+        auto const halton = params.memetic_population_init == "halton"
+                                ? std::make_shared<HaltonSequence>(robot_.variables.size(), rng)
+                                : nullptr;
+
         // If the initial state is not valid, restart from a random valid state.
         auto init_state = ik_seed_state;
         if (!robot_.is_valid_configuration(init_state)) {
             RCLCPP_WARN(
                 LOGGER,
                 "Initial guess exceeds joint limits. Regenerating a random valid configuration.");
-            robot_.set_random_valid_configuration(init_state);
+            robot_.set_random_valid_configuration(init_state, rng);
+        }
+
+        // Streams and cache hits first try a short local solve from the predicted seed or the
+        // cached solution, which is usually enough, before falling back to the configured solver.
+        // The global solver then also starts with them among its elites.
+        bool warm_start = stream != nullptr || cached_solution.has_value();
+        auto const& warm_start_guess = cached_solution.has_value() ? cached_solution.value()
+                                                                   : ik_seed_state;
+        auto elite_guesses = std::vector<std::vector<double>>{};
+        if (stream != nullptr) {
+            elite_guesses = stream->solutions;
+        }
+        if (cached_solution.has_value()) {
+            elite_guesses.push_back(cached_solution.value());
+        }
+
+        // The global solver also starts from the workspace samples closest to the first goal.
+        if (context.seed_database && (params.mode == "global" || params.mode == "hybrid")) {
+            auto seeds = find_seeds(*context.seed_database,
+                                    goal_frames.front(),
+                                    context.memetic_params.elite_size - 1,
+                                    params.position_scale,
+                                    params.rotation_scale);
+            std::move(seeds.begin(), seeds.end(), std::back_inserter(elite_guesses));
         }
 
+        // pose residuals for damped least squares, if the kinematic chain supports it, which the
+        // solve context checked for mode local_dls
+        auto const residual_fn = make_pose_residual_fn(
+            chain_, goal_frames, params.position_scale, params.rotation_scale);
+
+        // Search for a solution using either the local or global solver.
+        auto const run_solver = [&](std::string_view mode,
+                                    std::vector<double> const& initial_guess,
+                                    double max_time,
+                                    std::shared_ptr<std::atomic<bool> const> const& cancel,
+                                    uint64_t seed) -> std::optional<std::vector<double>> {
+            // Solves may run at once, so each one counts into its own statistics.
+            auto solver_stats = SolveStats{};
+            auto* const stats = counters ? &solver_stats : nullptr;
+            auto maybe_solution = [&]() -> std::optional<std::vector<double>> {
+                if (mode == "global") {
+                    auto ik_params = context.memetic_params;
+                    ik_params.max_time = max_time;
+                    ik_params.seed = seed;
+                    ik_params.halton = halton;
+
+                    return ik_memetic(initial_guess,
+                                      robot_,
+                                      cost_fn,
+                                      solution_fn,
+                                      ik_params,
+                                      options.return_approximate_solution,
+                                      false /* No debug print */,
+                                      gradient_fn,
+                                      batch_cost_fn,
+                                      thread_pool_.get(),
+                                      elite_guesses,
+                                      cancel,
+                                      stats);
+                }
+                if (mode == "local") {
+                    auto gd_params = context.gd_params;
+                    gd_params.max_time = max_time;
+
+                    return ik_gradient(initial_guess,
+                                       robot_,
+                                       cost_fn,
+                                       solution_fn,
+                                       gd_params,
+                                       options.return_approximate_solution,
+                                       gradient_fn,
+                                       cancel.get(),
+                                       stats);
+                }
+                auto dls_params = context.dls_params;
+                dls_params.max_time = max_time;
+
+                return ik_dls(initial_guess,
+                              robot_,
+                              cost_fn,
+                              residual_fn,
+                              solution_fn,
+                              dls_params,
+                              options.return_approximate_solution,
+                              cancel.get());
+            }();
+            if (stats != nullptr) {
+                record_solve_stats(solver_stats);
+            }
+            return maybe_solution;
+        };
+
+        // Hybrid mode races a local solver against the global solver from the same initial guess,
+        // and takes the first valid solution.
+        auto const local_mode = std::string_view(residual_fn ? "local_dls" : "local");
+        auto const run_race = [&](std::vector<double> const& initial_guess,
+                                  double max_time) -> std::optional<std::vector<double>> {
+            auto const make_solver_fn = [&run_solver, &rng, max_time](std::string_view mode) {
+                return [&run_solver, mode, max_time, seed = rng()](
+                           std::vector<double> const& guess,
+                           std::shared_ptr<std::atomic<bool> const> const& cancel) {
+                    return run_solver(mode, guess, max_time, cancel, seed);
+                };
+            };
+            auto const race = solve_portfolio({Restart{make_solver_fn(local_mode), initial_guess},
+                                               Restart{make_solver_fn("global"), initial_guess}},
+                                              cost_fn,
+                                              solution_fn,
+                                              params.stop_optimization_on_valid_solution,
+                                              thread_pool_.get());
+
+            auto const valid = race.has_value() && solution_fn(race->solution);
+            {
+                std::lock_guard<std::mutex> lock(hybrid_stats_mutex_);
+                if (!valid) {
+                    ++hybrid_stats_.failures;
+                } else if (race->restart == 0) {
+                    ++hybrid_stats_.local_wins;
+                } else {
+                    ++hybrid_stats_.global_wins;
+                }
+            }
+            if (valid) {
+                RCLCPP_DEBUG(LOGGER,
+                             "Hybrid solve won by the %s solver",
+                             race->restart == 0 ? "local" : "global");
+            }
+            return race.has_value() ? std::optional(race->solution) : std::nullopt;
+        };
+
+        // Restarts from random seeds run restart_portfolio_size solves at once, cycling through
+        // the configured mode and the other local solvers, until one of them succeeds. Hybrid
+        // mode already races both solvers, so its restarts start with the global solver.
+        auto portfolio_modes =
+            std::vector<std::string_view>{params.mode == "hybrid" ? "global" : params.mode};
+        for (std::string_view const mode : {"local_dls", "local"}) {
+            if (mode != portfolio_modes.front() && (mode != "local_dls" || residual_fn)) {
+                portfolio_modes.push_back(mode);
+            }
+        }
+        auto const portfolio_size = static_cast<size_t>(params.restart_portfolio_size);
+        bool restart = false;
+
         // Optimize until a valid solution is found or we have timed out.
         while (!done_optimizing) {
-            // Search for a solution using either the local or global solver.
+            auto mode = std::string_view(params.mode);
+            auto max_time = remaining_timeout;
+            auto const warm_start_attempt = warm_start;
+            if (warm_start) {
+                mode = chain_->has_analytic_jacobian ? "local_dls" : "local";
+                max_time = std::min(max_time, params.warm_start_max_time);
+                warm_start = false;
+            }
+            auto const& initial_guess = warm_start_attempt ? warm_start_guess : init_state;
+            if (restart) {
+                num_restarts += portfolio_size;
+            }
+
             std::optional<std::vector<double>> maybe_solution;
-            if (params.mode == "global") {
-                MemeticIkParams ik_params;
-                ik_params.population_size = static_cast<size_t>(params.memetic_population_size);
-                ik_params.elite_size = static_cast<size_t>(params.memetic_elite_size);
-                ik_params.wipeout_fitness_tol = params.memetic_wipeout_fitness_tol;
-                ik_params.stop_optimization_on_valid_solution =
-                    params.stop_optimization_on_valid_solution;
-                ik_params.num_threads = static_cast<size_t>(params.memetic_num_threads);
-                ik_params.stop_on_first_soln = params.memetic_stop_on_first_solution;
-                ik_params.max_generations = static_cast<int>(params.memetic_max_generations);
-                ik_params.max_time = remaining_timeout;
-
-                ik_params.gd_params.step_size = params.gd_step_size;
-                ik_params.gd_params.min_cost_delta = params.gd_min_cost_delta;
-                ik_params.gd_params.max_iterations = static_cast<int>(params.memetic_gd_max_iters);
-                ik_params.gd_params.max_time = params.memetic_gd_max_time;
-
-                maybe_solution = ik_memetic(ik_seed_state,
-                                            robot_,
-                                            cost_fn,
-                                            solution_fn,
-                                            ik_params,
-                                            options.return_approximate_solution,
-                                            false /* No debug print */);
-            } else if (params.mode == "local") {
-                GradientIkParams gd_params;
-                gd_params.step_size = params.gd_step_size;
-                gd_params.min_cost_delta = params.gd_min_cost_delta;
-                gd_params.max_time = remaining_timeout;
-                gd_params.max_iterations = static_cast<int>(params.gd_max_iters);
-                gd_params.stop_optimization_on_valid_solution =
-                    params.stop_optimization_on_valid_solution;
-
-                maybe_solution = ik_gradient(ik_seed_state,
-                                             robot_,
-                                             cost_fn,
-                                             solution_fn,
-                                             gd_params,
-                                             options.return_approximate_solution);
+            if (restart && portfolio_size > 1) {
+                // Solves queued behind others on the pool only get the time that is left.
+                auto const deadline = std::chrono::steady_clock::now() +
+                                      std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::duration<double>(max_time));
+                auto restarts = std::vector<Restart>{};
+                for (size_t i = 0; i < portfolio_size; ++i) {
+                    auto seed = init_state;
+                    if (i > 0) {
+                        robot_.set_random_valid_configuration(seed, rng);
+                    }
+                    auto const restart_mode = portfolio_modes[i % portfolio_modes.size()];
+                    auto solver_fn = [&run_solver, restart_mode, deadline, solver_seed = rng()](
+                                         std::vector<double> const& guess,
+                                         std::shared_ptr<std::atomic<bool> const> const& cancel)
+                        -> std::optional<std::vector<double>> {
+                        std::chrono::duration<double> const time_left =
+                            deadline - std::chrono::steady_clock::now();
+                        if (time_left.count() <= 0.0) {
+                            return std::nullopt;
+                        }
+                        return run_solver(
+                            restart_mode, guess, time_left.count(), cancel, solver_seed);
+                    };
+                    restarts.push_back(Restart{std::move(solver_fn), std::move(seed)});
+                }
+                auto portfolio_solution =
+                    solve_portfolio(restarts,
+                                    cost_fn,
+                                    solution_fn,
+                                    params.stop_optimization_on_valid_solution,
+                                    thread_pool_.get());
+                if (portfolio_solution.has_value()) {
+                    maybe_solution = std::move(portfolio_solution->solution);
+                }
+            } else if (mode == "hybrid") {
+                maybe_solution = run_race(initial_guess, max_time);
             } else {
-                RCLCPP_ERROR(LOGGER, "Invalid solver mode: %s", params.mode.c_str());
-                return false;
+                maybe_solution = run_solver(mode, initial_guess, max_time, nullptr, rng());
             }
 
             if (maybe_solution.has_value()) {
@@ -238,20 +705,10 @@ class PickIKPlugin : public kinematics::KinematicsBase {
             // fall back to the initial state.
             if (options.return_approximate_solution) {
                 // Check pose thresholds
-                std::optional<double> approximate_solution_position_threshold = std::nullopt;
-                if (test_position) {
-                    approximate_solution_position_threshold =
-                        params.approximate_solution_position_threshold;
-                }
-                std::optional<double> approximate_solution_orientation_threshold = std::nullopt;
-                if (test_rotation) {
-                    approximate_solution_orientation_threshold =
-                        params.approximate_solution_orientation_threshold;
-                }
                 auto const approx_frame_tests =
                     make_frame_tests(goal_frames,
-                                     approximate_solution_position_threshold,
-                                     approximate_solution_orientation_threshold);
+                                     context.approximate_solution_position_threshold,
+                                     context.approximate_solution_orientation_threshold);
 
                 // If we have no cost threshold, we don't need to check the goals
                 if (params.approximate_solution_cost_threshold <= 0.0) {
@@ -262,7 +719,7 @@ class PickIKPlugin : public kinematics::KinematicsBase {
                     make_is_solution_test_fn(frame_tests,
                                              goals,
                                              params.approximate_solution_cost_threshold,
-                                             fk_fn);
+                                             fk_fn_);
 
                 bool approx_solution_valid = approx_solution_fn(solution);
 
@@ -298,26 +755,217 @@ class PickIKPlugin : public kinematics::KinematicsBase {
 
             // If we found a valid solution or hit the timeout, we are done optimizing.
             // Otherwise, pick a random new initial seed and keep optimizing with the remaining
-            // time.
+            // time. A failed warm start falls back to the configured solver from the same seed.
             if (found_valid_solution || timeout_elapsed) {
                 done_optimizing = true;
             } else {
-                robot_.set_random_valid_configuration(init_state);
+                if (!warm_start_attempt) {
+                    robot_.set_random_valid_configuration(init_state, rng);
+                    restart = true;
+                }
                 remaining_timeout = timeout - total_optim_time.count();
             }
         }
 
+        // Approximate solutions are not cached, only those that solve the goal.
+        if (solution_cache != nullptr && found_valid_solution && solution_fn(solution)) {
+            solution_cache->insert(goal_frames, solution);
+        }
+
+        record_request(found_valid_solution);
         return found_valid_solution;
     }
 
+    // Streaming session that warm-starts each request from the solutions of the previous ones.
+    class StreamSession : public IkStreamSession {
+        PickIKPlugin const* solver_;
+        IkStream stream_;
+
+       public:
+        StreamSession(PickIKPlugin const* solver, std::vector<double> const& seed_state)
+            : solver_(solver) {
+            pick_ik::reset(stream_, seed_state);
+        }
+
+        virtual auto solve(std::vector<geometry_msgs::msg::Pose> const& poses,
+                           double timeout,
+                           std::vector<double>& solution,
+                           moveit_msgs::msg::MoveItErrorCodes& error_code,
+                           kinematics::KinematicsQueryOptions const& options) -> bool {
+            auto const seed = predict_seed(stream_, solver_->robot_);
+            auto const found = solver_->solve(*solver_->get_solve_context(),
+                                              poses,
+                                              seed,
+                                              timeout,
+                                              solution,
+                                              IKCallbackFn(),
+                                              IKCostFn(),
+                                              error_code,
+                                              options,
+                                              &stream_);
+            if (found) {
+                record_solution(stream_, solution);
+            }
+            return found;
+        }
+
+        virtual auto reset(std::vector<double> const& seed_state) -> void {
+            pick_ik::reset(stream_, seed_state);
+        }
+    };
+
+   public:
+    virtual bool initialize(rclcpp::Node::SharedPtr const& node,
+                            moveit::core::RobotModel const& robot_model,
+                            std::string const& group_name,
+                            std::string const& base_frame,
+                            std::vector<std::string> const& tip_frames,
+                            double search_discretization) {
+        node_ = node;
+        parameter_listener_ = std::make_shared<ParamListener>(
+            node,
+            std::string("robot_description_kinematics.").append(group_name));
+
+        // Initialize internal state of base class KinematicsBase
+        // Creates these internal state variables:
+        // robot_model_ <- shared_ptr to RobotModel
+        // robot_description_ <- empty string
+        // group_name_ <- group_name string
+        // base_frame_ <- base_frame without leading /
+        // tip_frames_ <- tip_frames without leading /
+        // redundant_joint_discretization_ <- vector initialized with
+        // search_discretization
+        storeValues(robot_model, group_name, base_frame, tip_frames, search_discretization);
+
+        // Initialize internal state
+        jmg_ = robot_model_->getJointModelGroup(group_name);
+        if (!jmg_) {
+            RCLCPP_ERROR(LOGGER, "failed to get joint model group %s", group_name.c_str());
+            return false;
+        }
+
+        // Joint names come from jmg
+        for (auto* joint_model : jmg_->getJointModels()) {
+            if (joint_model->getName() != base_frame_ &&
+                joint_model->getType() != moveit::core::JointModel::UNKNOWN &&
+                joint_model->getType() != moveit::core::JointModel::FIXED) {
+                joint_names_.push_back(joint_model->getName());
+            }
+        }
+
+        // link_names are the same as tip frames
+        // TODO: why do we need to set this
+        link_names_ = tip_frames_;
+
+        // Create our internal Robot object from the robot model
+        tip_link_indices_ =
+            get_link_indices(robot_model_, tip_frames_)
+                .or_else([](auto const& error) { throw std::invalid_argument(error); })
+                .value();
+        robot_ = Robot::from(robot_model_, jmg_, tip_link_indices_);
+        chain_ = std::make_shared<KinematicChain const>(
+            KinematicChain::from(robot_model_, jmg_, tip_link_indices_));
+        fk_fn_ = make_incremental_fk_fn(chain_);
+        model_hash_ = get_model_hash(robot_model_, jmg_, tip_link_indices_.front());
+
+        // FK queries may ask for any link of the group, relative to the base frame.
+        auto fk_link_names = std::vector<std::string>{base_frame_};
+        for (auto const* link_model : jmg_->getLinkModels()) {
+            fk_link_names.push_back(link_model->getName());
+        }
+        fk_link_names.insert(fk_link_names.end(), tip_frames_.begin(), tip_frames_.end());
+        auto const fk_link_indices = get_link_indices(robot_model_, fk_link_names);
+        if (fk_link_indices.has_value()) {
+            fk_chain_ = std::make_shared<KinematicChain const>(
+                KinematicChain::from(robot_model_, jmg_, fk_link_indices.value()));
+            for (size_t i = 0; i < fk_link_names.size(); ++i) {
+                fk_tips_.emplace(fk_link_names[i], i);
+            }
+        } else {
+            RCLCPP_WARN(LOGGER, "FK is not available: %s", fk_link_indices.error().c_str());
+        }
+
+        thread_pool_ =
+            std::make_unique<ThreadPool>(std::max(1u, std::thread::hardware_concurrency()));
+
+        // Goal poses are given in the base frame, which usually does not move with the group.
+        if (!jmg_->isLinkUpdated(base_frame_)) {
+            auto robot_state = moveit::core::RobotState(robot_model_);
+            robot_state.setToDefaultValues();
+            robot_state.update();
+            base_frame_transform_ = robot_state.getGlobalLinkTransform(base_frame_);
+        }
+
+        solve_context_ = make_solve_context(nullptr);
+        if (solve_context_->error.has_value()) {
+            return false;
+        }
+
+        auto const telemetry_publish_period = solve_context_->params.telemetry_publish_period;
+        if (telemetry_publish_period > 0.0) {
+            telemetry_publisher_ = node_->create_publisher<diagnostic_msgs::msg::DiagnosticArray>(
+                "pick_ik/" + group_name + "/solve_stats", rclcpp::QoS(1));
+            telemetry_timer_ = node_->create_wall_timer(
+                std::chrono::duration<double>(telemetry_publish_period),
+                [this] { publish_telemetry(); });
+        }
+
+        return true;
+    }
+
+    virtual bool searchPositionIK(
+        std::vector<geometry_msgs::msg::Pose> const& ik_poses,
+        std::vector<double> const& ik_seed_state,
+        double timeout,
+        std::vector<double> const&,
+        std::vector<double>& solution,
+        IKCallbackFn const& solution_callback,
+        IKCostFn const& cost_function,
+        moveit_msgs::msg::MoveItErrorCodes& error_code,
+        kinematics::KinematicsQueryOptions const& options = kinematics::KinematicsQueryOptions(),
+        moveit::core::RobotState const* context_state = nullptr) const {
+        (void)context_state;  // not used
+
+        // Settings for the current ROS parameters
+        auto const context = get_solve_context();
+        return solve(*context,
+                     ik_poses,
+                     ik_seed_state,
+                     timeout,
+                     solution,
+                     solution_callback,
+                     cost_function,
+                     error_code,
+                     options);
+    }
+
     virtual std::vector<std::string> const& getJointNames() const { return joint_names_; }
 
     virtual std::vector<std::string> const& getLinkNames() const { return link_names_; }
 
-    virtual bool getPositionFK(std::vector<std::string> const&,
-                               std::vector<double> const&,
-                               std::vector<geometry_msgs::msg::Pose>&) const {
-        return false;
+    virtual bool getPositionFK(std::vector<std::string> const& link_names,
+                               std::vector<double> const& joint_angles,
+                               std::vector<geometry_msgs::msg::Pose>& poses) const {
+        if (!fk_chain_ || joint_angles.size() != fk_chain_->group_variable_indices.size()) {
+            RCLCPP_ERROR(LOGGER, "Cannot compute FK for %zu joint angles", joint_angles.size());
+            return false;
+        }
+
+        // Each thread updates its own frames incrementally from its previous query.
+        auto& frames =
+            get_thread_local<ChainFrames>(fk_chain_, [&] { return ChainFrames::from(*fk_chain_); });
+        update_frames(*fk_chain_, frames, joint_angles);
+
+        auto const base_inverse = get_tip_frame(*fk_chain_, frames, 0).inverse(Eigen::Isometry);
+        poses.resize(link_names.size());
+        for (size_t i = 0; i < link_names.size(); ++i) {
+            auto const tip = get_fk_tip(link_names[i]);
+            if (!tip.has_value()) {
+                return false;
+            }
+            poses[i] = tf2::toMsg(base_inverse * get_tip_frame(*fk_chain_, frames, tip.value()));
+        }
+        return true;
     }
 
     virtual bool getPositionIK(geometry_msgs::msg::Pose const&,
@@ -421,6 +1069,138 @@ class PickIKPlugin : public kinematics::KinematicsBase {
                                 options,
                                 context_state);
     }
+
+    virtual auto searchPositionIKBatch(std::vector<IkRequest> const& requests,
+                                       double timeout,
+                                       IkResultCallback const& result_callback,
+                                       kinematics::KinematicsQueryOptions const& options) const
+        -> std::vector<IkResult> {
+        // Requests run on the same pool as the memetic species and gradient descent tasks they
+        // start. A request waiting on its own tasks helps run them, so nesting does not deadlock.
+        auto const context = get_solve_context();
+        auto results = std::vector<IkResult>(requests.size());
+        parallel_for(thread_pool_.get(), requests.size(), [&](size_t i) {
+            auto& result = results[i];
+            solve(*context,
+                  requests[i].poses,
+                  requests[i].seed_state,
+                  timeout,
+                  result.solution,
+                  IKCallbackFn(),
+                  IKCostFn(),
+                  result.error_code,
+                  options);
+            if (result_callback) {
+                result_callback(i, result);
+            }
+        });
+        return results;
+    }
+
+    virtual auto startIkStream(std::vector<double> const& seed_state) const
+        -> std::unique_ptr<IkStreamSession> {
+        return std::make_unique<StreamSession>(this, seed_state);
+    }
+
+    virtual auto getSolutionCacheStats() const -> SolutionCacheStats {
+        auto const context = get_solve_context();
+        return context->solution_cache ? context->solution_cache->stats() : SolutionCacheStats{};
+    }
+
+    virtual auto getHybridIkStats() const -> HybridIkStats {
+        std::lock_guard<std::mutex> lock(hybrid_stats_mutex_);
+        return hybrid_stats_;
+    }
+
+    virtual auto saveSolutionCache(std::string const& path) const -> bool {
+        auto const context = get_solve_context();
+        auto configurations = std::vector<double>{};
+        auto tip_poses = std::vector<double>{};
+        if (context->solution_cache) {
+            for (auto const& [goal_frames, solution] : context->solution_cache->entries()) {
+                configurations.insert(configurations.end(), solution.cbegin(), solution.cend());
+                append_tip_pose(tip_poses, goal_frames.front());
+            }
+        }
+
+        auto const database = make_seed_database(jmg_->getName(),
+                                                 tip_frames_.front(),
+                                                 model_hash_,
+                                                 robot_.variables.size(),
+                                                 std::move(configurations),
+                                                 std::move(tip_poses));
+        if (!database.has_value()) {
+            RCLCPP_ERROR(LOGGER, "Cannot save the solution cache: %s", database.error().c_str());
+            return false;
+        }
+        auto const saved = save_seed_database(database.value(), path);
+        if (!saved.has_value()) {
+            RCLCPP_ERROR(LOGGER, "Cannot save the solution cache: %s", saved.error().c_str());
+            return false;
+        }
+        return true;
+    }
+
+    virtual auto getPositionFKBatch(std::vector<std::string> const& link_names,
+                                    std::vector<double> const& joint_angles,
+                                    std::vector<geometry_msgs::msg::Pose>& poses) const -> bool {
+        auto const num_variables = fk_chain_ ? fk_chain_->group_variable_indices.size() : 0;
+        if (num_variables == 0 || joint_angles.size() % num_variables != 0) {
+            RCLCPP_ERROR(LOGGER, "Cannot compute FK for %zu joint angles", joint_angles.size());
+            return false;
+        }
+        auto tips = std::vector<size_t>{};
+        for (auto const& link_name : link_names) {
+            auto const tip = get_fk_tip(link_name);
+            if (!tip.has_value()) {
+                return false;
+            }
+            tips.push_back(tip.value());
+        }
+
+        auto const count = joint_angles.size() / num_variables;
+        poses.resize(count * tips.size());
+        auto const num_chunks = (count + kFkBatchSize - 1) / kFkBatchSize;
+        parallel_for(thread_pool_.get(), num_chunks, [&](size_t chunk) {
+            auto const begin = chunk * kFkBatchSize;
+            auto const size = std::min(kFkBatchSize, count - begin);
+            auto const* const configurations = joint_angles.data() + begin * num_variables;
+            auto* const chunk_poses = poses.data() + begin * tips.size();
+
+            if (fk_chain_->has_analytic_jacobian) {
+                auto& frames = get_thread_local<BatchChainFrames>(
+                    fk_chain_, [] { return BatchChainFrames{}; });
+                update_batch_frames(*fk_chain_, frames, configurations, size);
+                for (size_t k = 0; k < size; ++k) {
+                    auto const base_inverse =
+                        get_batch_tip_frame(*fk_chain_, frames, 0, k).inverse(Eigen::Isometry);
+                    for (size_t j = 0; j < tips.size(); ++j) {
+                        chunk_poses[k * tips.size() + j] = tf2::toMsg(
+                            base_inverse * get_batch_tip_frame(*fk_chain_, frames, tips[j], k));
+                    }
+                }
+                return;
+            }
+
+            // Chains with other joint types fall back to incremental FK of one joint vector at a
+            // time.
+            auto& frames = get_thread_local<ChainFrames>(
+                fk_chain_, [&] { return ChainFrames::from(*fk_chain_); });
+            auto configuration = std::vector<double>(num_variables);
+            for (size_t k = 0; k < size; ++k) {
+                auto const* const row = configurations + k * num_variables;
+                std::copy(row, row + num_variables, configuration.begin());
+                update_frames(*fk_chain_, frames, configuration);
+                auto const base_inverse =
+                    get_tip_frame(*fk_chain_, frames, 0).inverse(Eigen::Isometry);
+                for (size_t j = 0; j < tips.size(); ++j) {
+                    chunk_poses[k * tips.size() + j] =
+                        tf2::toMsg(base_inverse * get_tip_frame(*fk_chain_, frames, tips[j]));
+                }
+            }
+        });
+        return true;
+    }
 };
 
 }  // namespace pick_ik
@@ -0,0 +1,32 @@
+#include <pick_ik/random.hpp>
+
+#include <cstdint>
+
+namespace pick_ik {
+namespace {
+
+// SplitMix64, which turns similar seeds into unrelated states, as recommended for seeding
+// xoshiro generators.
+auto split_mix(uint64_t& state) -> uint64_t {
+    state += 0x9e3779b97f4a7c15;
+    auto z = state;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+}  // namespace
+
+auto stream_seed(uint64_t seed, uint64_t stream) -> uint64_t {
+    auto state = stream;
+    return seed ^ split_mix(state);
+}
+
+Rng::Rng(uint64_t seed) {
+    // SplitMix64 never outputs zero twice in a row, so the state is never all zeros.
+    for (auto& word : state_) {
+        word = split_mix(seed);
+    }
+}
+
+}  // namespace pick_ik
@@ -0,0 +1,67 @@
+#include <pick_ik/goal.hpp>
+#include <pick_ik/restart_portfolio.hpp>
+#include <pick_ik/thread_pool.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace pick_ik {
+
+auto solve_portfolio(std::vector<Restart> const& restarts,
+                     CostFn const& cost_fn,
+                     SolutionTestFn const& solution_fn,
+                     bool stop_on_first_solution,
+                     ThreadPool* thread_pool) -> std::optional<PortfolioSolution> {
+    // A returned solution, ranked first by validity and then by cost.
+    struct Candidate {
+        bool valid;
+        double cost;
+        PortfolioSolution solution;
+    };
+
+    auto const cancel = std::make_shared<std::atomic<bool>>(false);
+    std::mutex mutex;
+    std::optional<Candidate> best;
+
+    TaskGroup tasks(thread_pool);
+    for (size_t i = 0; i < restarts.size(); ++i) {
+        tasks.run([&, i] {
+            auto const& restart = restarts[i];
+            // Restarts that had not started when another one succeeded are skipped.
+            if (*cancel) {
+                return;
+            }
+            auto solution = restart.solver_fn(restart.initial_guess, cancel);
+            if (!solution.has_value()) {
+                return;
+            }
+
+            // Evaluated here, as the cost and solution functions cache per thread.
+            auto const valid = solution_fn(solution.value());
+            auto const cost = cost_fn(solution.value());
+            auto candidate = Candidate{valid, cost, {std::move(solution.value()), i}};
+            std::scoped_lock lock(mutex);
+            if (stop_on_first_solution && best.has_value() && best->valid) {
+                return;
+            }
+            if (!best.has_value() || (candidate.valid && !best->valid) ||
+                (candidate.valid == best->valid && candidate.cost < best->cost)) {
+                best = std::move(candidate);
+            }
+            if (stop_on_first_solution && best->valid) {
+                *cancel = true;
+            }
+        });
+    }
+    tasks.wait();
+
+    if (!best.has_value()) {
+        return std::nullopt;
+    }
+    return std::move(best->solution);
+}
+
+}  // namespace pick_ik
@@ -1,3 +1,4 @@
+#include <pick_ik/random.hpp>
 #include <pick_ik/robot.hpp>
 
 #include <rsl/random.hpp>
@@ -20,12 +21,15 @@ constexpr double kUnboundedJointSampleSpread = M_PI;
 
 namespace pick_ik {
 
-auto Robot::Variable::generate_valid_value(double init_val /* = 0.0*/) const -> double {
+auto Robot::Variable::generate_valid_value(Rng& rng, double init_val /* = 0.0*/) const -> double {
+    return from_unit(rng.uniform_real(0.0, 1.0), init_val);
+}
+
+auto Robot::Variable::from_unit(double unit, double init_val /* = 0.0*/) const -> double {
     if (bounded) {
-        return rsl::uniform_real(min, max);
+        return min + (max - min) * unit;
     } else {
-        return rsl::uniform_real(init_val - kUnboundedJointSampleSpread,
-                                 init_val + kUnboundedJointSampleSpread);
+        return init_val + kUnboundedJointSampleSpread * (2.0 * unit - 1.0);
     }
 }
 
@@ -84,16 +88,21 @@ auto Robot::from(std::shared_ptr<moveit::core::RobotModel const> const& model,
     return robot;
 }
 
-auto Robot::set_random_valid_configuration(std::vector<double>& config) const -> void {
+auto Robot::set_random_valid_configuration(std::vector<double>& config, Rng& rng) const -> void {
     auto const num_vars = variables.size();
     if (config.size() != num_vars) {
         config.resize(num_vars);
     }
     for (size_t idx = 0; idx < num_vars; ++idx) {
-        config[idx] = variables[idx].generate_valid_value(config[idx]);
+        config[idx] = variables[idx].generate_valid_value(rng, config[idx]);
     }
 }
 
+auto Robot::set_random_valid_configuration(std::vector<double>& config) const -> void {
+    auto rng = Rng(rsl::rng()());
+    set_random_valid_configuration(config, rng);
+}
+
 auto Robot::is_valid_configuration(std::vector<double> const& config) const -> bool {
     auto const num_vars = variables.size();
     for (size_t idx = 0; idx < num_vars; ++idx) {
@@ -180,4 +189,17 @@ auto transform_poses_to_frames(moveit::core::RobotState const& robot_state,
     return frames;
 }
 
+auto transform_poses_to_frames(Eigen::Isometry3d const& base_frame,
+                               std::vector<geometry_msgs::msg::Pose> const& poses)
+    -> std::vector<Eigen::Isometry3d> {
+    auto frames = std::vector<Eigen::Isometry3d>{};
+    frames.reserve(poses.size());
+    for (auto const& pose : poses) {
+        Eigen::Isometry3d p;
+        tf2::fromMsg(pose, p);
+        frames.push_back(base_frame * p);
+    }
+    return frames;
+}
+
 }  // namespace pick_ik
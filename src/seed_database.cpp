@@ -0,0 +1,528 @@
+#include <pick_ik/forward_kinematics.hpp>
+#include <pick_ik/goal.hpp>
+#include <pick_ik/random.hpp>
+#include <pick_ik/robot.hpp>
+#include <pick_ik/seed_database.hpp>
+
+#include <fmt/core.h>
+#include <rsl/random.hpp>
+#include <tl_expected/expected.hpp>
+
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <moveit/robot_model/joint_model_group.h>
+#include <moveit/robot_model/robot_model.h>
+#include <numeric>
+#include <queue>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace pick_ik {
+namespace {
+constexpr std::array<char, 4> kMagic = {'P', 'K', 'S', 'D'};
+constexpr uint32_t kVersion = 3;
+constexpr uint64_t kAlignment = 64;  // Of the arrays within the file.
+constexpr uint64_t kMaxNameSize = 4096;
+constexpr uint64_t kMaxVariables = 4096;
+
+// Start of the file, followed by the group and tip link names and then the arrays at their offsets.
+// Files written on a machine of the other byte order fail the version check.
+struct FileHeader {
+    std::array<char, 4> magic;
+    uint32_t version;
+    uint64_t model_hash;
+    uint64_t num_variables;
+    uint64_t num_samples;
+    uint64_t group_name_size;
+    uint64_t tip_link_name_size;
+    uint64_t configurations_offset;
+    uint64_t tip_poses_offset;
+    uint64_t kd_tree_offset;
+    uint64_t orientation_kd_tree_offset;
+    uint64_t file_size;
+};
+
+// Arrays of a database built in memory.
+struct OwnedArrays {
+    std::vector<double> configurations;
+    std::vector<double> tip_poses;
+    std::vector<uint32_t> kd_tree;
+    std::vector<uint32_t> orientation_kd_tree;
+};
+
+// A read-only mapping of a whole file.
+class MappedFile {
+    void* data_;
+    size_t size_;
+
+   public:
+    MappedFile(void* data, size_t size) : data_(data), size_(size) {}
+    MappedFile(MappedFile const&) = delete;
+    auto operator=(MappedFile const&) -> MappedFile& = delete;
+    ~MappedFile() { ::munmap(data_, size_); }
+
+    auto data() const -> char const* { return static_cast<char const*>(data_); }
+};
+
+auto hash_bytes(uint64_t hash, void const* data, size_t size) -> uint64_t {
+    // FNV-1a
+    auto const* const bytes = static_cast<unsigned char const*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+template <typename T>
+auto hash_value(uint64_t hash, T const& value) -> uint64_t {
+    return hash_bytes(hash, &value, sizeof(T));
+}
+
+auto hash_string(uint64_t hash, std::string const& value) -> uint64_t {
+    return hash_bytes(hash_value(hash, value.size()), value.data(), value.size());
+}
+
+auto hash_frame(uint64_t hash, Eigen::Isometry3d const& frame) -> uint64_t {
+    return hash_bytes(hash, frame.matrix().data(), sizeof(double) * 16);
+}
+
+// The tip pose entries that a k-d tree indexes: the position or the orientation.
+struct KdKey {
+    size_t first_entry;
+    size_t dimensions;
+};
+constexpr auto kPositionKey = KdKey{0, 3};
+constexpr auto kOrientationKey = KdKey{3, 4};
+
+// Samples of one subtree of a k-d tree.
+struct KdRange {
+    size_t begin;
+    size_t end;
+    size_t axis;
+};
+
+auto build_kd_tree(std::vector<uint32_t>& kd_tree,
+                   std::vector<double> const& tip_poses,
+                   KdKey key,
+                   KdRange range) -> void {
+    if (range.end - range.begin <= 1) {
+        return;
+    }
+    auto const middle = range.begin + (range.end - range.begin) / 2;
+    auto const first = kd_tree.begin();
+    auto const* const entries = tip_poses.data() + key.first_entry + range.axis;
+    std::nth_element(first + static_cast<std::ptrdiff_t>(range.begin),
+                     first + static_cast<std::ptrdiff_t>(middle),
+                     first + static_cast<std::ptrdiff_t>(range.end),
+                     [&](uint32_t a, uint32_t b) {
+                         return entries[a * SeedDatabase::kPoseEntries] <
+                                entries[b * SeedDatabase::kPoseEntries];
+                     });
+    auto const next_axis = (range.axis + 1) % key.dimensions;
+    build_kd_tree(kd_tree, tip_poses, key, KdRange{range.begin, middle, next_axis});
+    build_kd_tree(kd_tree, tip_poses, key, KdRange{middle + 1, range.end, next_axis});
+}
+
+// Squared distance of a sample and its index, ordered by distance.
+using Neighbor = std::pair<double, uint32_t>;
+
+// Keeps the count samples whose key entries are closest to point in neighbors, a max-heap by
+// distance.
+auto find_nearest(SeedDatabase const& self,
+                  uint32_t const* kd_tree,
+                  KdKey key,
+                  double const* point,
+                  size_t count,
+                  KdRange range,
+                  std::priority_queue<Neighbor>& neighbors) -> void {
+    if (range.begin >= range.end) {
+        return;
+    }
+    auto const middle = range.begin + (range.end - range.begin) / 2;
+    auto const sample = kd_tree[middle];
+    if (sample >= self.size()) {
+        return;  // Corrupt index.
+    }
+    auto const* const entries =
+        self.tip_poses + sample * SeedDatabase::kPoseEntries + key.first_entry;
+    auto distance = 0.0;
+    for (size_t i = 0; i < key.dimensions; ++i) {
+        distance += (entries[i] - point[i]) * (entries[i] - point[i]);
+    }
+    if (neighbors.size() < count) {
+        neighbors.emplace(distance, sample);
+    } else if (distance < neighbors.top().first) {
+        neighbors.pop();
+        neighbors.emplace(distance, sample);
+    }
+
+    // Search the side of the goal first, and the other side only if it can hold closer samples.
+    auto const offset = point[range.axis] - entries[range.axis];
+    auto const next_axis = (range.axis + 1) % key.dimensions;
+    auto const lower = KdRange{range.begin, middle, next_axis};
+    auto const upper = KdRange{middle + 1, range.end, next_axis};
+    find_nearest(self, kd_tree, key, point, count, offset < 0.0 ? lower : upper, neighbors);
+    if (neighbors.size() < count || offset * offset < neighbors.top().first) {
+        find_nearest(self, kd_tree, key, point, count, offset < 0.0 ? upper : lower, neighbors);
+    }
+}
+
+// Appends the samples of neighbors to candidates, the farthest first.
+auto append_candidates(std::priority_queue<Neighbor>& neighbors, std::vector<uint32_t>& candidates)
+    -> void {
+    while (!neighbors.empty()) {
+        candidates.push_back(neighbors.top().second);
+        neighbors.pop();
+    }
+}
+
+auto get_tip_pose(SeedDatabase const& self, size_t sample) -> Eigen::Isometry3d {
+    auto const* const pose = self.tip_poses + sample * SeedDatabase::kPoseEntries;
+    auto frame = Eigen::Isometry3d::Identity();
+    frame.translation() = Eigen::Vector3d(pose[0], pose[1], pose[2]);
+    frame.linear() = Eigen::Quaterniond(pose[3], pose[4], pose[5], pose[6]).toRotationMatrix();
+    return frame;
+}
+
+auto align_offset(uint64_t offset) -> uint64_t {
+    return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Pads the file with zeros up to offset, then writes size bytes.
+auto write_at(std::ofstream& file, uint64_t offset, void const* data, uint64_t size) -> void {
+    auto const position = static_cast<uint64_t>(file.tellp());
+    auto const padding = std::array<char, kAlignment>{};
+    file.write(padding.data(), static_cast<std::streamsize>(offset - position));
+    file.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+}
+
+// True if an array of count elements of type T at offset lies within the file, aligned for T.
+template <typename T>
+auto is_in_file(FileHeader const& header, uint64_t offset, uint64_t count) -> bool {
+    auto const min_offset =
+        sizeof(FileHeader) + header.group_name_size + header.tip_link_name_size;
+    return offset % alignof(T) == 0 && offset >= min_offset && offset <= header.file_size &&
+           count * sizeof(T) <= header.file_size - offset;
+}
+}  // namespace
+
+auto get_model_hash(std::shared_ptr<moveit::core::RobotModel const> const& model,
+                    moveit::core::JointModelGroup const* jmg,
+                    size_t tip_link_index) -> uint64_t {
+    auto const chain = KinematicChain::from(model, jmg, {tip_link_index});
+    auto const robot = Robot::from(model, jmg, {tip_link_index});
+
+    auto hash = uint64_t{14695981039346656037ULL};
+    hash = hash_string(hash, jmg->getName());
+    hash = hash_string(hash, model->getLinkModel(tip_link_index)->getName());
+    for (auto const& link : chain.links) {
+        auto const& axis = chain.joint_axes[link.joint_model->getJointIndex()];
+        hash = hash_string(hash, link.link_model->getName());
+        hash = hash_string(hash, link.joint_model->getName());
+        hash = hash_value(hash, static_cast<int>(link.joint_model->getType()));
+        hash = hash_value(hash, link.parent.value_or(std::numeric_limits<size_t>::max()));
+        hash = hash_frame(hash, link.fixed_parent_frame);
+        hash = hash_frame(hash, chain.link_frames[link.link_model->getLinkIndex()]);
+        hash = hash_value(hash, std::array<double, 3>{axis.x(), axis.y(), axis.z()});
+        hash = hash_value(hash, link.variable.value_or(std::numeric_limits<size_t>::max()));
+        hash = hash_value(hash, link.variable_factor);
+    }
+    for (auto const& tip : chain.tips) {
+        hash = hash_value(hash, tip.link.value_or(std::numeric_limits<size_t>::max()));
+        hash = hash_frame(hash, tip.fixed_frame);
+    }
+    for (auto const& variable : robot.variables) {
+        hash = hash_value(hash, std::array<double, 2>{variable.min, variable.max});
+        hash = hash_value(hash, variable.bounded);
+    }
+    return hash;
+}
+
+auto append_tip_pose(std::vector<double>& tip_poses, Eigen::Isometry3d const& frame) -> void {
+    auto const position = frame.translation();
+    auto const orientation = Eigen::Quaterniond(frame.rotation());
+    tip_poses.insert(tip_poses.end(),
+                     {position.x(),
+                      position.y(),
+                      position.z(),
+                      orientation.w(),
+                      orientation.x(),
+                      orientation.y(),
+                      orientation.z()});
+}
+
+auto make_seed_database(std::string group_name,
+                        std::string tip_link_name,
+                        uint64_t model_hash,
+                        size_t num_variables,
+                        std::vector<double> configurations,
+                        std::vector<double> tip_poses)
+    -> tl::expected<SeedDatabase, std::string> {
+    auto const num_samples = tip_poses.size() / SeedDatabase::kPoseEntries;
+    if (tip_poses.size() % SeedDatabase::kPoseEntries != 0 ||
+        configurations.size() != num_samples * num_variables) {
+        return tl::make_unexpected(
+            fmt::format("{} configuration entries of {} variables do not match {} tip pose entries",
+                        configurations.size(),
+                        num_variables,
+                        tip_poses.size()));
+    }
+    if (num_samples > SeedDatabase::kMaxSamples) {
+        return tl::make_unexpected(fmt::format("{} samples exceed the limit of {}",
+                                               num_samples,
+                                               SeedDatabase::kMaxSamples));
+    }
+
+    auto arrays = std::make_shared<OwnedArrays>();
+    arrays->configurations = std::move(configurations);
+    arrays->tip_poses = std::move(tip_poses);
+    arrays->kd_tree.resize(num_samples);
+    std::iota(arrays->kd_tree.begin(), arrays->kd_tree.end(), uint32_t{0});
+    arrays->orientation_kd_tree = arrays->kd_tree;
+    build_kd_tree(arrays->kd_tree, arrays->tip_poses, kPositionKey, KdRange{0, num_samples, 0});
+    build_kd_tree(arrays->orientation_kd_tree,
+                  arrays->tip_poses,
+                  kOrientationKey,
+                  KdRange{0, num_samples, 0});
+
+    auto self = SeedDatabase{};
+    self.group_name = std::move(group_name);
+    self.tip_link_name = std::move(tip_link_name);
+    self.model_hash = model_hash;
+    self.num_variables = num_variables;
+    self.num_samples = num_samples;
+    self.configurations = arrays->configurations.data();
+    self.tip_poses = arrays->tip_poses.data();
+    self.kd_tree = arrays->kd_tree.data();
+    self.orientation_kd_tree = arrays->orientation_kd_tree.data();
+    self.storage = std::move(arrays);
+    return self;
+}
+
+auto build_seed_database(std::string group_name,
+                         std::string tip_link_name,
+                         uint64_t model_hash,
+                         Robot const& robot,
+                         FkFn const& fk_fn,
+                         size_t tip,
+                         size_t count) -> tl::expected<SeedDatabase, std::string> {
+    if (count > SeedDatabase::kMaxSamples) {
+        return tl::make_unexpected(
+            fmt::format("{} samples exceed the limit of {}", count, SeedDatabase::kMaxSamples));
+    }
+
+    auto const num_variables = robot.variables.size();
+    auto configurations = std::vector<double>{};
+    auto tip_poses = std::vector<double>{};
+    configurations.reserve(count * num_variables);
+    tip_poses.reserve(count * SeedDatabase::kPoseEntries);
+
+    auto configuration = std::vector<double>(num_variables, 0.0);
+    auto rng = Rng(rsl::rng()());
+    for (size_t i = 0; i < count; ++i) {
+        robot.set_random_valid_configuration(configuration, rng);
+        configurations.insert(configurations.end(), configuration.cbegin(), configuration.cend());
+        append_tip_pose(tip_poses, fk_fn(configuration)[tip]);
+    }
+
+    return make_seed_database(std::move(group_name),
+                              std::move(tip_link_name),
+                              model_hash,
+                              num_variables,
+                              std::move(configurations),
+                              std::move(tip_poses));
+}
+
+auto find_seeds(SeedDatabase const& self,
+                Eigen::Isometry3d const& goal,
+                size_t count,
+                double position_scale,
+                double rotation_scale) -> std::vector<std::vector<double>> {
+    if (count == 0 || self.size() == 0) {
+        return {};
+    }
+
+    // Candidates: the closest samples by position, and otherwise by orientation. Several
+    // candidates per seed leave room to rank them by orientation as well. If both are ignored, any
+    // samples will do.
+    auto candidates = std::vector<uint32_t>{};
+    if (position_scale > 0.0) {
+        auto neighbors = std::priority_queue<Neighbor>{};
+        auto const num_candidates = rotation_scale > 0.0 ? 8 * count : count;
+        auto const position = goal.translation();
+        auto const point = std::array<double, 3>{position.x(), position.y(), position.z()};
+        find_nearest(self,
+                     self.kd_tree,
+                     kPositionKey,
+                     point.data(),
+                     num_candidates,
+                     KdRange{0, self.size(), 0},
+                     neighbors);
+        append_candidates(neighbors, candidates);
+    } else if (rotation_scale > 0.0) {
+        // q and -q are the same orientation, and the angle between two orientations grows with
+        // the distance to the closer of the two. The count closest samples of each sign therefore
+        // hold the count closest samples by angle.
+        auto const orientation = Eigen::Quaterniond(goal.rotation());
+        for (auto const sign : {1.0, -1.0}) {
+            auto neighbors = std::priority_queue<Neighbor>{};
+            auto const point = std::array<double, 4>{sign * orientation.w(),
+                                                     sign * orientation.x(),
+                                                     sign * orientation.y(),
+                                                     sign * orientation.z()};
+            find_nearest(self,
+                         self.orientation_kd_tree,
+                         kOrientationKey,
+                         point.data(),
+                         count,
+                         KdRange{0, self.size(), 0},
+                         neighbors);
+            append_candidates(neighbors, candidates);
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    } else {
+        candidates.resize(std::min(count, self.size()));
+        std::iota(candidates.begin(), candidates.end(), uint32_t{0});
+    }
+
+    auto ranked = std::vector<Neighbor>{};
+    ranked.reserve(candidates.size());
+    for (auto const sample : candidates) {
+        auto const tip_pose = get_tip_pose(self, sample);
+        auto cost = 0.0;
+        if (position_scale > 0.0) {
+            cost += std::pow(linear_distance(goal, tip_pose) * position_scale, 2);
+        }
+        if (rotation_scale > 0.0) {
+            cost += std::pow(angular_distance(goal, tip_pose) * rotation_scale, 2);
+        }
+        ranked.emplace_back(cost, sample);
+    }
+    auto const num_seeds = std::min(count, ranked.size());
+    std::partial_sort(ranked.begin(),
+                      ranked.begin() + static_cast<std::ptrdiff_t>(num_seeds),
+                      ranked.end());
+
+    auto seeds = std::vector<std::vector<double>>{};
+    seeds.reserve(num_seeds);
+    for (size_t i = 0; i < num_seeds; ++i) {
+        auto const* const configuration =
+            self.configurations + ranked[i].second * self.num_variables;
+        seeds.emplace_back(configuration, configuration + self.num_variables);
+    }
+    return seeds;
+}
+
+auto save_seed_database(SeedDatabase const& self, std::string const& path)
+    -> tl::expected<void, std::string> {
+    auto const configurations_size = self.size() * self.num_variables * sizeof(double);
+    auto const tip_poses_size = self.size() * SeedDatabase::kPoseEntries * sizeof(double);
+    auto const kd_tree_size = self.size() * sizeof(uint32_t);
+
+    auto header = FileHeader{};
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.model_hash = self.model_hash;
+    header.num_variables = self.num_variables;
+    header.num_samples = self.size();
+    header.group_name_size = self.group_name.size();
+    header.tip_link_name_size = self.tip_link_name.size();
+    header.configurations_offset =
+        align_offset(sizeof(FileHeader) + self.group_name.size() + self.tip_link_name.size());
+    header.tip_poses_offset = align_offset(header.configurations_offset + configurations_size);
+    header.kd_tree_offset = align_offset(header.tip_poses_offset + tip_poses_size);
+    header.orientation_kd_tree_offset = align_offset(header.kd_tree_offset + kd_tree_size);
+    header.file_size = header.orientation_kd_tree_offset + kd_tree_size;
+
+    auto file = std::ofstream(path, std::ios::binary);
+    if (!file) {
+        return tl::make_unexpected(fmt::format("Cannot open {} for writing", path));
+    }
+    file.write(reinterpret_cast<char const*>(&header), sizeof(FileHeader));
+    file.write(self.group_name.data(), static_cast<std::streamsize>(self.group_name.size()));
+    file.write(self.tip_link_name.data(), static_cast<std::streamsize>(self.tip_link_name.size()));
+    write_at(file, header.configurations_offset, self.configurations, configurations_size);
+    write_at(file, header.tip_poses_offset, self.tip_poses, tip_poses_size);
+    write_at(file, header.kd_tree_offset, self.kd_tree, kd_tree_size);
+    write_at(file, header.orientation_kd_tree_offset, self.orientation_kd_tree, kd_tree_size);
+    if (!file) {
+        return tl::make_unexpected(fmt::format("Failed to write {}", path));
+    }
+    return {};
+}
+
+auto load_seed_database(std::string const& path) -> tl::expected<SeedDatabase, std::string> {
+    auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return tl::make_unexpected(fmt::format("Cannot open {}: {}", path, std::strerror(errno)));
+    }
+    struct stat status {};
+    if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        return tl::make_unexpected(fmt::format("{} is not a seed database", path));
+    }
+    auto const size = static_cast<size_t>(status.st_size);
+    auto* const data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return tl::make_unexpected(fmt::format("Cannot map {}: {}", path, std::strerror(errno)));
+    }
+    auto mapping = std::make_shared<MappedFile>(data, size);
+    // Lookups visit a few scattered samples, so reading ahead only wastes memory.
+    ::madvise(data, size, MADV_RANDOM);
+
+    auto header = FileHeader{};
+    std::memcpy(&header, mapping->data(), sizeof(FileHeader));
+    if (header.magic != kMagic) {
+        return tl::make_unexpected(fmt::format("{} is not a seed database", path));
+    }
+    if (header.version != kVersion) {
+        return tl::make_unexpected(
+            fmt::format("{} has version {}, expected version {}", path, header.version, kVersion));
+    }
+    if (header.file_size != size || header.group_name_size > kMaxNameSize ||
+        header.tip_link_name_size > kMaxNameSize || header.num_variables > kMaxVariables ||
+        header.num_samples > SeedDatabase::kMaxSamples ||
+        !is_in_file<double>(header,
+                            header.configurations_offset,
+                            header.num_samples * header.num_variables) ||
+        !is_in_file<double>(header,
+                            header.tip_poses_offset,
+                            header.num_samples * SeedDatabase::kPoseEntries) ||
+        !is_in_file<uint32_t>(header, header.kd_tree_offset, header.num_samples) ||
+        !is_in_file<uint32_t>(header, header.orientation_kd_tree_offset, header.num_samples)) {
+        return tl::make_unexpected(fmt::format("{} is truncated or corrupt", path));
+    }
+
+    auto const* const names = mapping->data() + sizeof(FileHeader);
+    auto self = SeedDatabase{};
+    self.group_name = std::string(names, header.group_name_size);
+    self.tip_link_name = std::string(names + header.group_name_size, header.tip_link_name_size);
+    self.model_hash = header.model_hash;
+    self.num_variables = header.num_variables;
+    self.num_samples = header.num_samples;
+    self.configurations =
+        reinterpret_cast<double const*>(mapping->data() + header.configurations_offset);
+    self.tip_poses = reinterpret_cast<double const*>(mapping->data() + header.tip_poses_offset);
+    self.kd_tree = reinterpret_cast<uint32_t const*>(mapping->data() + header.kd_tree_offset);
+    self.orientation_kd_tree =
+        reinterpret_cast<uint32_t const*>(mapping->data() + header.orientation_kd_tree_offset);
+    self.storage = std::move(mapping);
+    return self;
+}
+
+}  // namespace pick_ik
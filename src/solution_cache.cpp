@@ -0,0 +1,184 @@
+#include <pick_ik/goal.hpp>
+#include <pick_ik/solution_cache.hpp>
+
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace pick_ik {
+namespace {
+// Largest distance of a tip from its cached goal, scaled by the tolerances so that position and
+// orientation weigh the same, or infinity if a tip is out of tolerance.
+auto get_match_distance(SolutionCacheParams const& params,
+                        std::vector<Eigen::Isometry3d> const& goal_frames,
+                        std::vector<Eigen::Isometry3d> const& cached_frames) -> double {
+    if (goal_frames.size() != cached_frames.size()) {
+        return std::numeric_limits<double>::infinity();
+    }
+    auto distance = 0.0;
+    for (size_t i = 0; i < goal_frames.size(); ++i) {
+        auto tip_distance = 0.0;
+        if (params.position_tolerance.has_value()) {
+            auto const linear = linear_distance(goal_frames[i], cached_frames[i]);
+            if (linear > params.position_tolerance.value()) {
+                return std::numeric_limits<double>::infinity();
+            }
+            tip_distance += linear / params.position_tolerance.value();
+        }
+        if (params.orientation_tolerance.has_value()) {
+            auto const angular = angular_distance(goal_frames[i], cached_frames[i]);
+            if (angular > params.orientation_tolerance.value()) {
+                return std::numeric_limits<double>::infinity();
+            }
+            tip_distance += angular / params.orientation_tolerance.value();
+        }
+        distance = std::max(distance, tip_distance);
+    }
+    return distance;
+}
+}  // namespace
+
+auto SolutionCache::CellHash::operator()(Cell const& cell) const -> size_t {
+    auto hash = size_t{0};
+    for (auto const index : cell) {
+        hash = hash * 0x9e3779b97f4a7c15ULL + static_cast<size_t>(index);
+    }
+    return hash;
+}
+
+SolutionCache::SolutionCache(SolutionCacheParams params) : params_(params) {}
+
+auto SolutionCache::get_cell(std::vector<Eigen::Isometry3d> const& goal_frames) const -> Cell {
+    if (goal_frames.empty()) {
+        return Cell{0, 0, 0};
+    }
+
+    // Without a position tolerance, goals are placed by where their rotation takes the x axis.
+    // Rotations an angle apart move it by at most that angle, so matching goals are still in
+    // neighboring cells. Without any tolerance, every goal is in the same cell.
+    auto point = Eigen::Vector3d();
+    auto cell_size = 1.0;
+    if (params_.position_tolerance.has_value()) {
+        point = goal_frames.front().translation();
+        cell_size = params_.position_tolerance.value();
+    } else if (params_.orientation_tolerance.has_value()) {
+        point = goal_frames.front().rotation() * Eigen::Vector3d::UnitX();
+        cell_size = params_.orientation_tolerance.value();
+    } else {
+        return Cell{0, 0, 0};
+    }
+
+    auto cell = Cell{};
+    for (size_t i = 0; i < cell.size(); ++i) {
+        cell[i] =
+            static_cast<int64_t>(std::floor(point(static_cast<Eigen::Index>(i)) / cell_size));
+    }
+    return cell;
+}
+
+auto SolutionCache::find_nearest(std::vector<Eigen::Isometry3d> const& goal_frames)
+    -> EntryIterator {
+    auto const center = get_cell(goal_frames);
+    auto const reach =
+        params_.position_tolerance.has_value() || params_.orientation_tolerance.has_value() ? 1
+                                                                                            : 0;
+
+    auto nearest = entries_.end();
+    auto nearest_distance = std::numeric_limits<double>::infinity();
+    for (auto x = center[0] - reach; x <= center[0] + reach; ++x) {
+        for (auto y = center[1] - reach; y <= center[1] + reach; ++y) {
+            for (auto z = center[2] - reach; z <= center[2] + reach; ++z) {
+                auto const cell = grid_.find(Cell{x, y, z});
+                if (cell == grid_.end()) {
+                    continue;
+                }
+                for (auto const& entry : cell->second) {
+                    auto const distance =
+                        get_match_distance(params_, goal_frames, entry->goal_frames);
+                    if (distance < nearest_distance) {
+                        nearest = entry;
+                        nearest_distance = distance;
+                    }
+                }
+            }
+        }
+    }
+    return nearest;
+}
+
+auto SolutionCache::entry_bytes(Entry const& entry) const -> size_t {
+    // The list node, the entry's grid slot and its vectors.
+    return sizeof(Entry) + 2 * sizeof(void*) + sizeof(EntryIterator) +
+           entry.goal_frames.capacity() * sizeof(Eigen::Isometry3d) +
+           entry.solution.capacity() * sizeof(double);
+}
+
+auto SolutionCache::evict(EntryIterator entry) -> void {
+    auto const cell = grid_.find(entry->cell);
+    auto& slots = cell->second;
+    slots.erase(std::find(slots.begin(), slots.end(), entry));
+    if (slots.empty()) {
+        grid_.erase(cell);
+    }
+    stats_.bytes -= entry_bytes(*entry);
+    --stats_.entries;
+    entries_.erase(entry);
+}
+
+auto SolutionCache::find(std::vector<Eigen::Isometry3d> const& goal_frames)
+    -> std::optional<std::vector<double>> {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto const entry = find_nearest(goal_frames);
+    if (entry == entries_.end()) {
+        ++stats_.misses;
+        return std::nullopt;
+    }
+    ++stats_.hits;
+    entries_.splice(entries_.begin(), entries_, entry);
+    return entry->solution;
+}
+
+auto SolutionCache::insert(std::vector<Eigen::Isometry3d> const& goal_frames,
+                           std::vector<double> const& solution) -> void {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // A matching entry is replaced as a whole, so that its goal stays the one its solution
+    // solves, rather than drifting away from it over repeated inserts.
+    auto const existing = find_nearest(goal_frames);
+    if (existing != entries_.end()) {
+        evict(existing);
+    }
+
+    entries_.push_front(Entry{goal_frames, solution, get_cell(goal_frames)});
+    grid_[entries_.front().cell].push_back(entries_.begin());
+    stats_.bytes += entry_bytes(entries_.front());
+    ++stats_.entries;
+
+    while (stats_.bytes > params_.max_bytes && !entries_.empty()) {
+        evict(std::prev(entries_.end()));
+        ++stats_.evictions;
+    }
+}
+
+auto SolutionCache::stats() const -> SolutionCacheStats {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+auto SolutionCache::entries() const
+    -> std::vector<std::pair<std::vector<Eigen::Isometry3d>, std::vector<double>>> {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto result = std::vector<std::pair<std::vector<Eigen::Isometry3d>, std::vector<double>>>{};
+    result.reserve(entries_.size());
+    for (auto const& entry : entries_) {
+        result.emplace_back(entry.goal_frames, entry.solution);
+    }
+    return result;
+}
+
+}  // namespace pick_ik
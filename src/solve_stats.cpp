@@ -0,0 +1,27 @@
+#include <pick_ik/solve_stats.hpp>
+
+#include <algorithm>
+#include <cstddef>
+
+namespace pick_ik {
+
+auto merge(SolveStats& self, SolveStats const& other) -> void {
+    self.solves += other.solves;
+    self.successes += other.successes;
+    self.restarts += other.restarts;
+    self.generations += other.generations;
+    self.wipeouts += other.wipeouts;
+    self.gradient_iterations += other.gradient_iterations;
+    self.cost_evaluations += other.cost_evaluations;
+    self.fk_evaluations += other.fk_evaluations;
+    self.descent_time += other.descent_time;
+    self.reproduction_time += other.reproduction_time;
+    self.sort_time += other.sort_time;
+
+    self.species_wins.resize(std::max(self.species_wins.size(), other.species_wins.size()), 0);
+    for (size_t i = 0; i < other.species_wins.size(); ++i) {
+        self.species_wins[i] += other.species_wins[i];
+    }
+}
+
+}  // namespace pick_ik
@@ -0,0 +1,123 @@
+#include <pick_ik/thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace pick_ik {
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    threads_.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+        threads_.emplace_back([this] { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::scoped_lock lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::scoped_lock lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void ThreadPool::work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex_);
+            cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+TaskGroup::TaskGroup(ThreadPool* pool) : pool_{pool}, state_{std::make_shared<State>()} {}
+
+TaskGroup::~TaskGroup() { wait(); }
+
+void TaskGroup::run(std::function<void()> task) {
+    {
+        std::scoped_lock lock(state_->mutex);
+        state_->pending.push_back(std::move(task));
+        ++state_->unfinished;
+    }
+
+    // The pool only gets a ticket to run one pending task of the group. The task itself may have
+    // been run by a waiting thread by the time a worker picks up the ticket.
+    if (pool_ != nullptr) {
+        pool_->submit([state = state_] { run_pending(*state); });
+    }
+}
+
+void TaskGroup::wait() { wait_until([] { return false; }); }
+
+bool TaskGroup::wait_until(std::function<bool()> const& done) {
+    while (!done() && run_pending(*state_)) {
+    }
+
+    std::unique_lock lock(state_->mutex);
+    state_->cv.wait(lock, [this, &done] { return state_->unfinished == 0 || done(); });
+    return state_->unfinished == 0;
+}
+
+bool TaskGroup::run_pending(State& state) {
+    std::function<void()> task;
+    {
+        std::scoped_lock lock(state.mutex);
+        if (state.pending.empty()) {
+            return false;
+        }
+        task = std::move(state.pending.front());
+        state.pending.pop_front();
+    }
+
+    task();
+
+    {
+        std::scoped_lock lock(state.mutex);
+        --state.unfinished;
+    }
+    state.cv.notify_all();
+    return true;
+}
+
+void parallel_for(ThreadPool* pool, size_t count, std::function<void(size_t)> const& fn) {
+    std::atomic<size_t> next{0};
+    auto const runner = [&next, count, &fn] {
+        for (auto i = next++; i < count; i = next++) {
+            fn(i);
+        }
+    };
+
+    // The calling thread is a runner too, so a pool of n workers runs up to n + 1 calls at once.
+    TaskGroup runners(pool);
+    auto const num_workers = pool != nullptr ? std::min(pool->size(), count) : 0;
+    for (size_t i = 0; i < num_workers; ++i) {
+        runners.run(runner);
+    }
+    runner();
+    runners.wait();
+}
+
+}  // namespace pick_ik
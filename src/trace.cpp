@@ -0,0 +1,114 @@
+#include <pick_ik/trace.hpp>
+
+#include <fmt/format.h>
+#include <tl_expected/expected.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace pick_ik {
+namespace trace {
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+auto get_registry() -> Registry& {
+    // Never destroyed, as threads may still record while static objects are destroyed.
+    static auto* const registry = new Registry();
+    return *registry;
+}
+
+}  // namespace
+
+auto register_thread_buffer() -> ThreadBuffer* {
+    auto& registry = get_registry();
+    std::scoped_lock lock(registry.mutex);
+    registry.buffers.push_back(std::make_unique<ThreadBuffer>());
+    auto* const buffer = registry.buffers.back().get();
+    buffer->thread_id = static_cast<uint32_t>(registry.buffers.size());
+    return buffer;
+}
+
+}  // namespace trace
+
+auto write_chrome_trace(std::string const& path) -> tl::expected<void, std::string> {
+    auto file = std::ofstream(path);
+    if (!file) {
+        return tl::make_unexpected(fmt::format("Cannot open {} for writing", path));
+    }
+
+    struct Copy {
+        char const* name;
+        int64_t start_ns;
+        int64_t duration_ns;
+    };
+
+    file << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    auto separator = "\n";
+    auto& registry = trace::get_registry();
+    std::scoped_lock lock(registry.mutex);
+    for (auto const& buffer : registry.buffers) {
+        // Copy the events that the ring still holds, keeping only those whose sequence number
+        // shows they were complete, and not overwritten, both before and after their fields were
+        // read.
+        auto const head = buffer->head.load(std::memory_order_acquire);
+        auto const capacity = uint64_t{trace::ThreadBuffer::kCapacity};
+        auto const begin =
+            std::max<uint64_t>(buffer->first.load(), head > capacity ? head - capacity : 0);
+        auto events = std::vector<Copy>{};
+        events.reserve(head - begin);
+        for (auto index = begin; index < head; ++index) {
+            auto const& event = buffer->events[index % capacity];
+            auto const sequence = 2 * index + 2;
+            if (event.sequence.load(std::memory_order_acquire) != sequence) {
+                continue;
+            }
+            auto const copy = Copy{event.name.load(std::memory_order_relaxed),
+                                   event.start_ns.load(std::memory_order_relaxed),
+                                   event.duration_ns.load(std::memory_order_relaxed)};
+            // Orders the field loads before the check, so that a field written by a later event
+            // means the check sees its sequence number.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (event.sequence.load(std::memory_order_relaxed) == sequence) {
+                events.push_back(copy);
+            }
+        }
+
+        for (auto const& event : events) {
+            // Chrome traces count in microseconds.
+            file << separator
+                 << fmt::format("{{\"name\": \"{}\", \"ph\": \"X\", \"pid\": 1, \"tid\": {}, "
+                                "\"ts\": {:.3f}, \"dur\": {:.3f}}}",
+                                event.name,
+                                buffer->thread_id,
+                                static_cast<double>(event.start_ns) / 1000.0,
+                                static_cast<double>(event.duration_ns) / 1000.0);
+            separator = ",\n";
+        }
+    }
+    file << "\n]}\n";
+
+    if (!file) {
+        return tl::make_unexpected(fmt::format("Failed to write {}", path));
+    }
+    return {};
+}
+
+auto clear_trace() -> void {
+    auto& registry = trace::get_registry();
+    std::scoped_lock lock(registry.mutex);
+    for (auto const& buffer : registry.buffers) {
+        buffer->first.store(buffer->head.load());
+    }
+}
+
+}  // namespace pick_ik
@@ -0,0 +1,172 @@
+#include <pick_ik/cost_evaluator.hpp>
+#include <pick_ik/forward_kinematics.hpp>
+#include <pick_ik/goal.hpp>
+#include <pick_ik/robot.hpp>
+#include <pick_ik/solve_stats.hpp>
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <Eigen/Geometry>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <new>
+#include <vector>
+
+// Counts the allocations made by the calling thread while counting is enabled.
+namespace {
+thread_local bool count_allocations = false;
+thread_local size_t allocation_count = 0;
+}  // namespace
+
+void* operator new(std::size_t size) {
+    if (count_allocations) {
+        ++allocation_count;
+    }
+    if (auto* const ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+// Number of allocations made by fn on the calling thread.
+template <typename Fn>
+auto count_allocations_of(Fn&& fn) -> size_t {
+    allocation_count = 0;
+    count_allocations = true;
+    fn();
+    count_allocations = false;
+    return allocation_count;
+}
+
+struct PandaFixture {
+    std::shared_ptr<moveit::core::RobotModel const> robot_model =
+        moveit::core::loadTestingRobotModel("panda");
+    moveit::core::JointModelGroup const* jmg = robot_model->getJointModelGroup("panda_arm");
+    std::vector<size_t> tip_link_indices =
+        pick_ik::get_link_indices(robot_model, {"panda_hand"}).value();
+    pick_ik::Robot robot = pick_ik::Robot::from(robot_model, jmg, tip_link_indices);
+    std::shared_ptr<pick_ik::KinematicChain const> chain =
+        std::make_shared<pick_ik::KinematicChain const>(
+            pick_ik::KinematicChain::from(robot_model, jmg, tip_link_indices));
+    std::vector<double> goal_joint_vals = {0.0, -M_PI_4, 0.0, -3.0 * M_PI_4, 0.0, M_PI_2, M_PI_4};
+    std::vector<Eigen::Isometry3d> goal_frames =
+        pick_ik::make_incremental_fk_fn(chain)(goal_joint_vals);
+    std::vector<pick_ik::GoalTerm> goal_terms = {
+        pick_ik::GoalTerm{pick_ik::CenterJointsCost::from(robot), 0.1},
+        pick_ik::GoalTerm{pick_ik::AvoidJointLimitsCost::from(robot), 0.3},
+        pick_ik::GoalTerm{pick_ik::MinimalDisplacementCost::from(robot, goal_joint_vals), 0.2}};
+
+    // Random valid configurations, with the goal configuration first.
+    auto make_configurations(size_t count) const -> std::vector<std::vector<double>> {
+        auto configurations = std::vector<std::vector<double>>{goal_joint_vals};
+        auto joint_vals = std::vector<double>(robot.variables.size(), 0.0);
+        while (configurations.size() < count) {
+            robot.set_random_valid_configuration(joint_vals);
+            configurations.push_back(joint_vals);
+        }
+        return configurations;
+    }
+};
+}  // namespace
+
+TEST_CASE("pick_ik::CostEvaluator") {
+    auto const fixture = PandaFixture{};
+    double const position_scale = 1.0;
+    double const rotation_scale = 0.5;
+    auto const cost_fn = pick_ik::make_cost_fn(
+        pick_ik::make_pose_cost_functions(fixture.goal_frames, position_scale, rotation_scale),
+        pick_ik::to_goals(fixture.goal_terms),
+        pick_ik::make_incremental_fk_fn(fixture.chain));
+
+    auto evaluator = pick_ik::CostEvaluator::from(
+        fixture.chain, fixture.goal_frames, position_scale, rotation_scale, fixture.goal_terms);
+    auto const configurations = fixture.make_configurations(20);
+
+    SECTION("Matches the cost function built from std::function goals") {
+        for (auto const& joint_vals : configurations) {
+            auto const cost = pick_ik::evaluate(evaluator, joint_vals);
+            CHECK(cost == Catch::Approx(cost_fn(joint_vals)));
+
+            REQUIRE(evaluator.pose_costs.size() == 1);
+            REQUIRE(evaluator.goal_costs.size() == 3);
+            auto sum = evaluator.pose_costs[0];
+            for (size_t i = 0; i < fixture.goal_terms.size(); ++i) {
+                CHECK(evaluator.goal_costs[i] ==
+                      Catch::Approx(fixture.goal_terms[i](joint_vals)));
+                sum += evaluator.goal_costs[i];
+            }
+            CHECK(sum == Catch::Approx(cost));
+        }
+    }
+
+    SECTION("Goal costs match their definitions") {
+        auto const center_joints = pick_ik::CenterJointsCost::from(fixture.robot);
+        auto const minimal_displacement =
+            pick_ik::MinimalDisplacementCost::from(fixture.robot, fixture.goal_joint_vals);
+        for (auto const& joint_vals : configurations) {
+            auto expected_center_joints = 0.0;
+            auto expected_minimal_displacement = 0.0;
+            for (size_t i = 0; i < joint_vals.size(); ++i) {
+                auto const& variable = fixture.robot.variables[i];
+                auto const factor = variable.minimal_displacement_factor;
+                if (variable.bounded) {
+                    expected_center_joints += std::pow((joint_vals[i] - variable.mid) * factor, 2);
+                }
+                expected_minimal_displacement +=
+                    std::pow((joint_vals[i] - fixture.goal_joint_vals[i]) * factor, 2);
+            }
+            CHECK(center_joints(joint_vals) == Catch::Approx(expected_center_joints));
+            CHECK(minimal_displacement(joint_vals) == Catch::Approx(expected_minimal_displacement));
+        }
+    }
+
+    SECTION("Evaluating does not allocate") {
+        pick_ik::evaluate(evaluator, fixture.goal_joint_vals);
+        auto total = 0.0;
+        auto const allocations = count_allocations_of([&] {
+            for (auto const& joint_vals : configurations) {
+                total += pick_ik::evaluate(evaluator, joint_vals);
+            }
+        });
+        CHECK(allocations == 0);
+        CHECK(total > 0.0);
+    }
+
+    SECTION("Cost function and solution test do not allocate after the first call") {
+        auto const evaluation_fns = pick_ik::make_evaluation_fns(
+            evaluator, pick_ik::make_frame_tests(fixture.goal_frames, 0.001, 0.01), 0.1);
+        CHECK(evaluation_fns.solution_fn(fixture.goal_joint_vals));
+
+        auto solutions = 0;
+        auto const allocations = count_allocations_of([&] {
+            for (auto const& joint_vals : configurations) {
+                evaluation_fns.cost_fn(joint_vals);
+                if (evaluation_fns.solution_fn(joint_vals)) {
+                    ++solutions;
+                }
+            }
+        });
+        CHECK(allocations == 0);
+        CHECK(solutions >= 1);
+    }
+
+    SECTION("Counts cost calls and the configurations evaluated") {
+        auto const counters = std::make_shared<pick_ik::EvaluationCounters>();
+        auto const evaluation_fns = pick_ik::make_evaluation_fns(
+            evaluator, pick_ik::make_frame_tests(fixture.goal_frames, 0.001, 0.01), 0.1, counters);
+
+        evaluation_fns.cost_fn(configurations[0]);
+        evaluation_fns.solution_fn(configurations[0]);
+        evaluation_fns.cost_fn(configurations[1]);
+        CHECK(counters->cost_evaluations == 2);
+        CHECK(counters->fk_evaluations == 2);
+    }
+}
@@ -0,0 +1,241 @@
+#include <pick_ik/fk_moveit.hpp>
+#include <pick_ik/forward_kinematics.hpp>
+#include <pick_ik/robot.hpp>
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <tf2_geometry_msgs/tf2_geometry_msgs.hpp>
+
+#include <Eigen/Geometry>
+#include <cmath>
+#include <moveit/utils/robot_model_test_utils.h>
+
+auto make_rr_model_for_fk() {
+    /**
+     * We aim to make an RR robot like this:
+     *
+     *  revolute_2 -->  (b) ==== |E  <-- ee
+     *                 //
+     *                //
+     *               (a)  <-- revolute_1
+     *             origin
+     **/
+    auto builder = moveit::core::RobotModelBuilder("rr", "base");
+
+    // Define transforms and joint axes
+    geometry_msgs::msg::Pose origin;
+    origin.orientation.w = 1.0;
+
+    geometry_msgs::msg::Pose tform_x1;
+    tform_x1.position.x = 1.0;
+    tform_x1.orientation.w = 1.0;
+
+    geometry_msgs::msg::Pose tform_x2;
+    tform_x2.position.x = 2.0;
+    tform_x2.orientation.w = 1.0;
+
+    auto const z_axis = urdf::Vector3(0, 0, 1);
+
+    // Build the actual robot chain.
+    builder.addChain("base->a", "revolute", {origin}, z_axis);
+    builder.addChain("a->b", "revolute", {tform_x2}, z_axis);
+    builder.addChain("b->ee", "fixed", {tform_x1});
+    builder.addGroupChain("base", "ee", "group");
+    CHECK(builder.isValid());
+    return builder.build();
+}
+
+TEST_CASE("pick_ik::make_link_frames") {
+    auto const robot_model = make_rr_model_for_fk();
+    auto const link_frames = pick_ik::make_link_frames(robot_model);
+
+    REQUIRE(link_frames.size() == robot_model->getLinkModelCount());
+    auto const* link_model = robot_model->getLinkModel("b");
+    CHECK(pick_ik::get_frame(*link_model, link_frames).translation().x() == Catch::Approx(2.0));
+}
+
+TEST_CASE("RR model incremental FK") {
+    auto const robot_model = make_rr_model_for_fk();
+
+    auto const jmg = robot_model->getJointModelGroup("group");
+    auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {"ee"}).value();
+    auto const chain = pick_ik::KinematicChain::from(robot_model, jmg, tip_link_indices);
+    auto cache = pick_ik::ChainFrames::from(chain);
+    std::vector<Eigen::Isometry3d> tip_frames;
+
+    SECTION("Chain contains only moving links") {
+        CHECK(chain.links.size() == 3);
+        REQUIRE(chain.tips.size() == 1);
+        CHECK(chain.tips[0].link.has_value());
+    }
+
+    SECTION("Zero joint position") {
+        pick_ik::update_frames(chain, cache, {0.0, 0.0});
+        pick_ik::get_tip_frames(chain, cache, tip_frames);
+        CHECK(tip_frames[0].translation().x() == Catch::Approx(3.0));
+        CHECK(tip_frames[0].translation().y() == Catch::Approx(0.0));
+    }
+
+    SECTION("Only links below a moved joint are updated") {
+        pick_ik::update_frames(chain, cache, {0.0, 0.0});
+        pick_ik::update_frames(chain, cache, {0.0, M_PI_2});
+        CHECK(!cache.updated[0]);
+        CHECK(cache.updated[1]);
+        CHECK(cache.updated[2]);
+
+        pick_ik::get_tip_frames(chain, cache, tip_frames);
+        CHECK(tip_frames[0].translation().x() == Catch::Approx(2.0));
+        CHECK(tip_frames[0].translation().y() == Catch::Approx(1.0));
+
+        pick_ik::update_frames(chain, cache, {0.0, M_PI_2});
+        CHECK(!cache.updated[0]);
+        CHECK(!cache.updated[1]);
+        CHECK(!cache.updated[2]);
+    }
+
+    SECTION("Non-zero joint position through FK function") {
+        auto const fk_fn = pick_ik::make_incremental_fk_fn(robot_model, jmg, tip_link_indices);
+        std::vector<double> const joint_vals = {M_PI_4, -M_PI_4};
+        auto const expected_x = 2.0 * std::cos(M_PI_4) + 1.0;
+        auto const expected_y = 2.0 * std::sin(M_PI_4);
+
+        auto const result = fk_fn(joint_vals);
+        CHECK(result[0].translation().x() == Catch::Approx(expected_x).margin(0.001));
+        CHECK(result[0].translation().y() == Catch::Approx(expected_y).margin(0.001));
+    }
+}
+
+TEST_CASE("Panda model incremental FK matches MoveIt FK") {
+    using moveit::core::loadTestingRobotModel;
+    auto const robot_model = loadTestingRobotModel("panda");
+
+    auto const jmg = robot_model->getJointModelGroup("panda_arm");
+    auto const tip_link_indices =
+        pick_ik::get_link_indices(robot_model, {"panda_hand", "panda_link4"}).value();
+    auto const robot = pick_ik::Robot::from(robot_model, jmg, tip_link_indices);
+    auto const moveit_fk_fn = pick_ik::make_fk_fn(robot_model, jmg, tip_link_indices);
+    auto const incremental_fk_fn =
+        pick_ik::make_incremental_fk_fn(robot_model, jmg, tip_link_indices);
+
+    auto const check_frames = [&](std::vector<double> const& joint_vals) {
+        auto const expected = moveit_fk_fn(joint_vals);
+        auto const result = incremental_fk_fn(joint_vals);
+        REQUIRE(result.size() == expected.size());
+        for (size_t i = 0; i < result.size(); ++i) {
+            CHECK(result[i].isApprox(expected[i], 1e-9));
+        }
+    };
+
+    SECTION("Random configurations") {
+        std::vector<double> joint_vals(robot.variables.size(), 0.0);
+        for (size_t i = 0; i < 100; ++i) {
+            robot.set_random_valid_configuration(joint_vals);
+            check_frames(joint_vals);
+        }
+    }
+
+    SECTION("Single joint perturbations") {
+        std::vector<double> joint_vals = {0.0, -M_PI_4, 0.0, -3.0 * M_PI_4, 0.0, M_PI_2, M_PI_4};
+        check_frames(joint_vals);
+        for (size_t i = 0; i < joint_vals.size(); ++i) {
+            joint_vals[i] += 0.1;
+            check_frames(joint_vals);
+            joint_vals[i] -= 0.2;
+            check_frames(joint_vals);
+        }
+    }
+}
+
+TEST_CASE("Panda model batch FK matches incremental FK") {
+    using moveit::core::loadTestingRobotModel;
+    auto const robot_model = loadTestingRobotModel("panda");
+
+    auto const jmg = robot_model->getJointModelGroup("panda_arm");
+    auto const tip_link_indices =
+        pick_ik::get_link_indices(robot_model, {"panda_hand", "panda_link4"}).value();
+    auto const robot = pick_ik::Robot::from(robot_model, jmg, tip_link_indices);
+    auto const chain = pick_ik::KinematicChain::from(robot_model, jmg, tip_link_indices);
+    auto cache = pick_ik::ChainFrames::from(chain);
+    REQUIRE(chain.has_analytic_jacobian);
+
+    // Batch sizes that are and are not a multiple of typical vector widths.
+    for (size_t const count : {1u, 5u, 16u}) {
+        auto const num_variables = robot.variables.size();
+        std::vector<double> configurations(count * num_variables);
+        std::vector<double> joint_vals(num_variables, 0.0);
+        for (size_t k = 0; k < count; ++k) {
+            robot.set_random_valid_configuration(joint_vals);
+            std::copy(joint_vals.cbegin(),
+                      joint_vals.cend(),
+                      configurations.data() + k * num_variables);
+        }
+
+        pick_ik::BatchChainFrames batch;
+        pick_ik::update_batch_frames(chain, batch, configurations.data(), count);
+        REQUIRE(batch.count == count);
+
+        for (size_t k = 0; k < count; ++k) {
+            auto const* const first = configurations.data() + k * num_variables;
+            pick_ik::update_frames(chain, cache, std::vector<double>(first, first + num_variables));
+            for (size_t link = 0; link < chain.links.size(); ++link) {
+                auto const& expected = cache.frames[link];
+                for (Eigen::Index col = 0; col < 3; ++col) {
+                    auto const entry = static_cast<size_t>(col) * 3;
+                    for (Eigen::Index row = 0; row < 3; ++row) {
+                        CHECK(batch.entry(link, entry + static_cast<size_t>(row))[k] ==
+                              Catch::Approx(expected.linear()(row, col)).margin(1e-12));
+                    }
+                    CHECK(batch.entry(link, 9 + static_cast<size_t>(col))[k] ==
+                          Catch::Approx(expected.translation()(col)).margin(1e-12));
+                }
+            }
+            for (size_t tip = 0; tip < chain.tips.size(); ++tip) {
+                auto const batch_tip_frame = pick_ik::get_batch_tip_frame(chain, batch, tip, k);
+                CHECK(batch_tip_frame.isApprox(pick_ik::get_tip_frame(chain, cache, tip), 1e-12));
+            }
+        }
+    }
+}
+
+TEST_CASE("Panda model Jacobian matches finite differences") {
+    using moveit::core::loadTestingRobotModel;
+    auto const robot_model = loadTestingRobotModel("panda");
+
+    auto const jmg = robot_model->getJointModelGroup("panda_arm");
+    auto const tip_link_indices =
+        pick_ik::get_link_indices(robot_model, {"panda_hand", "panda_link4"}).value();
+    auto const chain = pick_ik::KinematicChain::from(robot_model, jmg, tip_link_indices);
+    REQUIRE(chain.has_analytic_jacobian);
+    auto cache = pick_ik::ChainFrames::from(chain);
+
+    std::vector<double> const joint_vals = {0.1, -M_PI_4, 0.2, -3.0 * M_PI_4, 0.3, M_PI_2, M_PI_4};
+    pick_ik::update_frames(chain, cache, joint_vals);
+    std::vector<pick_ik::Jacobian> jacobians;
+    pick_ik::compute_jacobians(chain, cache, jacobians);
+    REQUIRE(jacobians.size() == 2);
+
+    // Central differences of the tip frames, with the angular part taken as a rotation vector.
+    double const h = 1.0e-6;
+    std::vector<Eigen::Isometry3d> frames_plus;
+    std::vector<Eigen::Isometry3d> frames_minus;
+    for (size_t i = 0; i < joint_vals.size(); ++i) {
+        auto working = joint_vals;
+        working[i] = joint_vals[i] + h;
+        pick_ik::update_frames(chain, cache, working);
+        pick_ik::get_tip_frames(chain, cache, frames_plus);
+        working[i] = joint_vals[i] - h;
+        pick_ik::update_frames(chain, cache, working);
+        pick_ik::get_tip_frames(chain, cache, frames_minus);
+
+        for (size_t t = 0; t < jacobians.size(); ++t) {
+            auto const col = static_cast<Eigen::Index>(i);
+            Eigen::Vector3d const linear =
+                (frames_plus[t].translation() - frames_minus[t].translation()) / (2.0 * h);
+            auto const rotation = Eigen::AngleAxisd(frames_plus[t].rotation() *
+                                                    frames_minus[t].rotation().transpose());
+            Eigen::Vector3d const angular = rotation.angle() * rotation.axis() / (2.0 * h);
+            CHECK(jacobians[t].col(col).head<3>().isApprox(linear, 1e-5));
+            CHECK((jacobians[t].col(col).tail<3>() - angular).norm() < 1e-5);
+        }
+    }
+}
@@ -1,10 +1,14 @@
+#include <pick_ik/forward_kinematics.hpp>
 #include <pick_ik/goal.hpp>
+#include <pick_ik/robot.hpp>
 
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
 
 #include <Eigen/Geometry>
 #include <cmath>
+#include <memory>
+#include <moveit/utils/robot_model_test_utils.h>
 
 TEST_CASE("pick_ik::make_frame_tests") {
     auto const position_epsilon = 0.00001;
@@ -273,3 +277,161 @@ TEST_CASE("pick_ik::make_pose_cost_functions") {
         CHECK(cost_fns.at(1)({goal, frame}) == Catch::Approx(0.0).margin(1e-15));
     }
 }
+
+TEST_CASE("pick_ik::make_cost_gradient_fn") {
+    using moveit::core::loadTestingRobotModel;
+    auto const robot_model = loadTestingRobotModel("panda");
+
+    auto const jmg = robot_model->getJointModelGroup("panda_arm");
+    auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {"panda_hand"}).value();
+    auto const robot = pick_ik::Robot::from(robot_model, jmg, tip_link_indices);
+    auto const chain = std::make_shared<pick_ik::KinematicChain const>(
+        pick_ik::KinematicChain::from(robot_model, jmg, tip_link_indices));
+    auto const fk_fn = pick_ik::make_incremental_fk_fn(chain);
+
+    std::vector<double> const goal_joint_vals =
+        {0.0, -M_PI_4, 0.0, -3.0 * M_PI_4, 0.0, M_PI_2, M_PI_4};
+    std::vector<double> const joint_vals = {0.2, -0.6, -0.1, -2.2, 0.3, 1.4, 0.9};
+    std::vector<Eigen::Isometry3d> const goal_frames = fk_fn(goal_joint_vals);
+    double const position_scale = 1.0;
+    double const rotation_scale = 0.5;
+    std::vector<pick_ik::Goal> const goals = {
+        pick_ik::Goal{pick_ik::make_center_joints_cost_fn(robot), 0.1},
+        pick_ik::Goal{pick_ik::make_minimal_displacement_cost_fn(robot, goal_joint_vals), 0.2}};
+
+    auto const cost_fn = pick_ik::make_cost_fn(
+        pick_ik::make_pose_cost_functions(goal_frames, position_scale, rotation_scale),
+        goals,
+        fk_fn);
+    auto const gradient_fn = pick_ik::make_cost_gradient_fn(
+        chain, goal_frames, position_scale, rotation_scale, goals);
+    REQUIRE(gradient_fn);
+
+    std::vector<double> gradient;
+    auto const cost = gradient_fn(joint_vals, gradient);
+    CHECK(cost == Catch::Approx(cost_fn(joint_vals)));
+    REQUIRE(gradient.size() == joint_vals.size());
+
+    double const h = 1.0e-6;
+    for (size_t i = 0; i < joint_vals.size(); ++i) {
+        auto working = joint_vals;
+        working[i] = joint_vals[i] + h;
+        auto const cost_plus = cost_fn(working);
+        working[i] = joint_vals[i] - h;
+        auto const cost_minus = cost_fn(working);
+        auto const expected = (cost_plus - cost_minus) / (2.0 * h);
+        CHECK(gradient[i] == Catch::Approx(expected).margin(1e-5));
+    }
+}
+
+TEST_CASE("pick_ik::make_batch_cost_fn") {
+    using moveit::core::loadTestingRobotModel;
+    auto const robot_model = loadTestingRobotModel("panda");
+
+    auto const jmg = robot_model->getJointModelGroup("panda_arm");
+    auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {"panda_hand"}).value();
+    auto const robot = pick_ik::Robot::from(robot_model, jmg, tip_link_indices);
+    auto const chain = std::make_shared<pick_ik::KinematicChain const>(
+        pick_ik::KinematicChain::from(robot_model, jmg, tip_link_indices));
+    auto const fk_fn = pick_ik::make_incremental_fk_fn(chain);
+
+    std::vector<double> const goal_joint_vals =
+        {0.0, -M_PI_4, 0.0, -3.0 * M_PI_4, 0.0, M_PI_2, M_PI_4};
+    std::vector<Eigen::Isometry3d> const goal_frames = fk_fn(goal_joint_vals);
+    double const position_scale = 1.0;
+    double const rotation_scale = 0.5;
+    std::vector<pick_ik::Goal> const goals = {
+        pick_ik::Goal{pick_ik::make_center_joints_cost_fn(robot), 0.1}};
+
+    auto const cost_fn = pick_ik::make_cost_fn(
+        pick_ik::make_pose_cost_functions(goal_frames, position_scale, rotation_scale),
+        goals,
+        fk_fn);
+    auto const batch_cost_fn =
+        pick_ik::make_batch_cost_fn(chain, goal_frames, position_scale, rotation_scale, goals);
+    REQUIRE(batch_cost_fn);
+
+    // Include the goal itself, where the rotation error is zero.
+    size_t const count = 20;
+    std::vector<double> configurations = goal_joint_vals;
+    std::vector<double> joint_vals(robot.variables.size(), 0.0);
+    for (size_t k = 1; k < count; ++k) {
+        robot.set_random_valid_configuration(joint_vals);
+        configurations.insert(configurations.end(), joint_vals.cbegin(), joint_vals.cend());
+    }
+
+    std::vector<double> costs(count);
+    batch_cost_fn(configurations.data(), count, costs.data());
+    for (size_t k = 0; k < count; ++k) {
+        auto const* const first = configurations.data() + k * joint_vals.size();
+        auto const expected = cost_fn(std::vector<double>(first, first + joint_vals.size()));
+        CHECK(costs[k] == Catch::Approx(expected).margin(1e-12));
+    }
+}
+
+TEST_CASE("pick_ik::make_evaluation_fns") {
+    using moveit::core::loadTestingRobotModel;
+    auto const robot_model = loadTestingRobotModel("panda");
+
+    auto const jmg = robot_model->getJointModelGroup("panda_arm");
+    auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {"panda_hand"}).value();
+    auto const robot = pick_ik::Robot::from(robot_model, jmg, tip_link_indices);
+    auto const chain = std::make_shared<pick_ik::KinematicChain const>(
+        pick_ik::KinematicChain::from(robot_model, jmg, tip_link_indices));
+    auto const incremental_fk_fn = pick_ik::make_incremental_fk_fn(chain);
+    auto fk_calls = std::make_shared<int>(0);
+    auto const fk_fn = [incremental_fk_fn, fk_calls](std::vector<double> const& active_positions) {
+        ++*fk_calls;
+        return incremental_fk_fn(active_positions);
+    };
+
+    std::vector<double> const goal_joint_vals =
+        {0.0, -M_PI_4, 0.0, -3.0 * M_PI_4, 0.0, M_PI_2, M_PI_4};
+    std::vector<double> const joint_vals = {0.2, -0.6, -0.1, -2.2, 0.3, 1.4, 0.9};
+    std::vector<Eigen::Isometry3d> const goal_frames = incremental_fk_fn(goal_joint_vals);
+    auto const pose_cost_functions = pick_ik::make_pose_cost_functions(goal_frames, 1.0, 0.5);
+    auto const frame_tests = pick_ik::make_frame_tests(goal_frames, 0.001, 0.01);
+    std::vector<pick_ik::Goal> const goals = {
+        pick_ik::Goal{pick_ik::make_center_joints_cost_fn(robot), 0.1},
+        pick_ik::Goal{pick_ik::make_minimal_displacement_cost_fn(robot, goal_joint_vals), 0.2}};
+    double const cost_threshold = 0.1;
+
+    auto const cost_fn = pick_ik::make_cost_fn(pose_cost_functions, goals, incremental_fk_fn);
+    auto const solution_fn = pick_ik::make_is_solution_test_fn(
+        frame_tests, goals, cost_threshold, incremental_fk_fn);
+
+    SECTION("Evaluation matches the cost function and solution test") {
+        auto const evaluation_fn = pick_ik::make_evaluation_fn(
+            pose_cost_functions, frame_tests, goals, cost_threshold, fk_fn);
+
+        for (auto const& positions : {goal_joint_vals, joint_vals}) {
+            auto const evaluation = evaluation_fn(positions);
+            CHECK(evaluation.cost == Catch::Approx(cost_fn(positions)));
+            CHECK(evaluation.is_solution == solution_fn(positions));
+            REQUIRE(evaluation.pose_costs.size() == 1);
+            REQUIRE(evaluation.goal_costs.size() == 2);
+            CHECK(evaluation.pose_costs[0] + evaluation.goal_costs[0] +
+                      evaluation.goal_costs[1] ==
+                  Catch::Approx(evaluation.cost));
+        }
+        CHECK(evaluation_fn(goal_joint_vals).is_solution);
+        CHECK(!evaluation_fn(joint_vals).is_solution);
+        CHECK(*fk_calls == 4);
+    }
+
+    SECTION("Shared evaluations do not repeat FK for the same configuration") {
+        auto const evaluation_fns = pick_ik::make_evaluation_fns(
+            pose_cost_functions, frame_tests, goals, cost_threshold, fk_fn);
+
+        CHECK(evaluation_fns.cost_fn(joint_vals) == Catch::Approx(cost_fn(joint_vals)));
+        CHECK(evaluation_fns.solution_fn(joint_vals) == solution_fn(joint_vals));
+        CHECK(*fk_calls == 1);
+
+        CHECK(evaluation_fns.solution_fn(goal_joint_vals));
+        CHECK(evaluation_fns.cost_fn(goal_joint_vals) == Catch::Approx(cost_fn(goal_joint_vals)));
+        CHECK(*fk_calls == 2);
+
+        CHECK(evaluation_fns.cost_fn(joint_vals) == Catch::Approx(cost_fn(joint_vals)));
+        CHECK(*fk_calls == 3);
+    }
+}
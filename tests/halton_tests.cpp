@@ -0,0 +1,69 @@
+#include <pick_ik/halton.hpp>
+#include <pick_ik/random.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+TEST_CASE("pick_ik::HaltonSequence") {
+    auto rng = pick_ik::Rng(42);
+    auto sequence = pick_ik::HaltonSequence(4, rng);
+    REQUIRE(sequence.dimensions() == 4);
+
+    SECTION("Points are in the unit cube") {
+        auto point = std::vector<double>{};
+        for (uint64_t index = 1; index <= 1000; ++index) {
+            sequence.at(index, point);
+            REQUIRE(point.size() == 4);
+            for (auto const value : point) {
+                CHECK(value >= 0.0);
+                CHECK(value < 1.0);
+            }
+        }
+    }
+
+    SECTION("Consecutive points fill the strata of each dimension") {
+        // Dimension j uses the j-th prime as base, and any base consecutive points fall into
+        // different strata of width 1 / base, from any start. Points on the lower edge of a
+        // stratum, such as 4 / 7, may be rounded down, hence the tolerance.
+        auto const bases = std::vector<size_t>{2, 3, 5, 7};
+        auto start_rng = pick_ik::Rng(7);
+        for (auto const start : {uint64_t{1}, sequence.random_start(start_rng)}) {
+            auto points = std::vector<std::vector<double>>(7);
+            for (size_t i = 0; i < points.size(); ++i) {
+                sequence.at(start + i, points[i]);
+            }
+            for (size_t j = 0; j < bases.size(); ++j) {
+                auto strata = std::set<size_t>{};
+                for (size_t i = 0; i < bases[j]; ++i) {
+                    strata.insert(
+                        static_cast<size_t>(points[i][j] * static_cast<double>(bases[j]) + 1e-9));
+                }
+                CHECK(strata.size() == bases[j]);
+            }
+        }
+    }
+
+    SECTION("The seed determines the scrambling") {
+        auto same_rng = pick_ik::Rng(42);
+        auto same = pick_ik::HaltonSequence(4, same_rng);
+        auto other_rng = pick_ik::Rng(43);
+        auto other = pick_ik::HaltonSequence(4, other_rng);
+
+        auto point = std::vector<double>{};
+        auto same_point = std::vector<double>{};
+        auto other_point = std::vector<double>{};
+        auto differs = false;
+        for (uint64_t index = 1; index <= 10; ++index) {
+            sequence.at(index, point);
+            same.at(index, same_point);
+            other.at(index, other_point);
+            CHECK(point == same_point);
+            differs = differs || point != other_point;
+        }
+        CHECK(differs);
+    }
+}
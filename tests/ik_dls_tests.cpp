@@ -0,0 +1,128 @@
+#include <pick_ik/forward_kinematics.hpp>
+#include <pick_ik/goal.hpp>
+#include <pick_ik/ik_dls.hpp>
+#include <pick_ik/robot.hpp>
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <Eigen/Geometry>
+#include <cmath>
+#include <memory>
+#include <moveit/utils/robot_model_test_utils.h>
+
+// Helper param struct and function to test damped least squares IK solution.
+struct DlsIkTestParams {
+    double position_threshold = 0.0001;
+    double orientation_threshold = 0.001;
+    double cost_threshold = 0.0001;
+    double position_scale = 1.0;
+    double rotation_scale = 0.5;
+    bool return_approximate_solution = false;
+    pick_ik::DlsIkParams dls_params;
+};
+
+auto solve_dls_ik_test(moveit::core::RobotModelPtr robot_model,
+                       std::string const group_name,
+                       std::string const goal_frame_name,
+                       Eigen::Isometry3d const& goal_frame,
+                       std::vector<double> const& initial_guess,
+                       DlsIkTestParams const& params = DlsIkTestParams())
+    -> std::optional<std::vector<double>> {
+    auto const jmg = robot_model->getJointModelGroup(group_name);
+    auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {goal_frame_name}).value();
+    auto const chain = std::make_shared<pick_ik::KinematicChain const>(
+        pick_ik::KinematicChain::from(robot_model, jmg, tip_link_indices));
+    auto const fk_fn = pick_ik::make_incremental_fk_fn(chain);
+    auto const robot = pick_ik::Robot::from(robot_model, jmg, tip_link_indices);
+
+    auto const frame_tests = pick_ik::make_frame_tests(
+        {goal_frame}, params.position_threshold, params.orientation_threshold);
+    std::vector<pick_ik::Goal> goals = {};
+    auto const solution_fn =
+        pick_ik::make_is_solution_test_fn(frame_tests, goals, params.cost_threshold, fk_fn);
+    auto const pose_cost_functions = pick_ik::make_pose_cost_functions({goal_frame},
+                                                                       params.position_scale,
+                                                                       params.rotation_scale);
+    auto const cost_fn = pick_ik::make_cost_fn(pose_cost_functions, goals, fk_fn);
+    auto const residual_fn = pick_ik::make_pose_residual_fn(
+        chain, {goal_frame}, params.position_scale, params.rotation_scale);
+    REQUIRE(residual_fn);
+
+    return pick_ik::ik_dls(initial_guess,
+                           robot,
+                           cost_fn,
+                           residual_fn,
+                           solution_fn,
+                           params.dls_params,
+                           params.return_approximate_solution);
+}
+
+TEST_CASE("Panda model damped least squares IK") {
+    using moveit::core::loadTestingRobotModel;
+    auto const robot_model = loadTestingRobotModel("panda");
+
+    auto const jmg = robot_model->getJointModelGroup("panda_arm");
+    auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {"panda_hand"}).value();
+    auto const fk_fn = pick_ik::make_incremental_fk_fn(robot_model, jmg, tip_link_indices);
+    auto const robot = pick_ik::Robot::from(robot_model, jmg, tip_link_indices);
+
+    std::vector<double> const home_joint_angles =
+        {0.0, -M_PI_4, 0.0, -3.0 * M_PI_4, 0.0, M_PI_2, M_PI_4};
+
+    SECTION("Pose residual matches pose cost") {
+        auto const goal_frame = fk_fn(home_joint_angles)[0];
+        auto const chain = std::make_shared<pick_ik::KinematicChain const>(
+            pick_ik::KinematicChain::from(robot_model, jmg, tip_link_indices));
+        auto const residual_fn = pick_ik::make_pose_residual_fn(chain, {goal_frame}, 1.0, 0.5);
+        auto const pose_cost_fn = pick_ik::make_pose_cost_fn(goal_frame, 0, 1.0, 0.5);
+
+        std::vector<double> const joint_vals = {0.2, -0.6, -0.1, -2.2, 0.3, 1.4, 0.9};
+        Eigen::VectorXd residual;
+        Eigen::MatrixXd jacobian;
+        residual_fn(joint_vals, residual, jacobian);
+        CHECK(residual.size() == 6);
+        CHECK(jacobian.rows() == 6);
+        CHECK(jacobian.cols() == 7);
+        CHECK(residual.squaredNorm() == Catch::Approx(pose_cost_fn(fk_fn(joint_vals))));
+    }
+
+    SECTION("Perturbed home values converge in a few iterations") {
+        std::vector<double> const actual_joint_angles =
+            {0.1, -M_PI_4 - 0.1, 0.1, -3.0 * M_PI_4 - 0.1, 0.1, M_PI_2 - 0.1, M_PI_4 + 0.1};
+        auto const goal_frame = fk_fn(actual_joint_angles)[0];
+        auto params = DlsIkTestParams();
+        params.dls_params.max_iterations = 10;
+
+        auto const maybe_solution = solve_dls_ik_test(
+            robot_model, "panda_arm", "panda_hand", goal_frame, home_joint_angles, params);
+
+        REQUIRE(maybe_solution.has_value());
+        CHECK(robot.is_valid_configuration(maybe_solution.value()));
+        auto const final_frame = fk_fn(maybe_solution.value())[0];
+        CHECK(goal_frame.isApprox(final_frame, 0.001));
+    }
+
+    SECTION("Solutions respect joint limits") {
+        // Joint 4 is close to its upper limit of -0.0698 rad.
+        std::vector<double> const actual_joint_angles = {0.3, 0.2, -0.3, -0.2, 0.4, 1.2, 0.5};
+        auto const goal_frame = fk_fn(actual_joint_angles)[0];
+        std::vector<double> const initial_guess = {0.2, 0.1, -0.2, -0.4, 0.3, 1.1, 0.4};
+
+        auto const maybe_solution = solve_dls_ik_test(
+            robot_model, "panda_arm", "panda_hand", goal_frame, initial_guess);
+
+        REQUIRE(maybe_solution.has_value());
+        CHECK(robot.is_valid_configuration(maybe_solution.value()));
+    }
+
+    SECTION("Unreachable position") {
+        Eigen::Isometry3d const goal_frame =
+            Eigen::Translation3d(5.0, 0.0, 0.0) * Eigen::Quaterniond::Identity();
+
+        auto const maybe_solution = solve_dls_ik_test(
+            robot_model, "panda_arm", "panda_hand", goal_frame, home_joint_angles);
+
+        CHECK(!maybe_solution.has_value());
+    }
+}
@@ -1,17 +1,28 @@
 #include <pick_ik/fk_moveit.hpp>
+#include <pick_ik/forward_kinematics.hpp>
 #include <pick_ik/goal.hpp>
+#include <pick_ik/halton.hpp>
 #include <pick_ik/ik_gradient.hpp>
 #include <pick_ik/ik_memetic.hpp>
+#include <pick_ik/random.hpp>
 #include <pick_ik/robot.hpp>
+#include <pick_ik/solve_stats.hpp>
+#include <pick_ik/thread_pool.hpp>
 
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.hpp>
 
 #include <Eigen/Geometry>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <limits>
+#include <memory>
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/utils/robot_model_test_utils.h>
+#include <thread>
 
 // Helper param struct and function to test IK solution.
 struct MemeticIkTestParams {
@@ -25,6 +36,9 @@ struct MemeticIkTestParams {
     bool approximate_solution = false;
     bool print_debug = false;
     pick_ik::MemeticIkParams memetic_params;
+    pick_ik::ThreadPool* thread_pool = nullptr;
+    bool use_batch_cost = false;
+    pick_ik::SolveStats* stats = nullptr;
 
     // Additional costs
     double center_joints_weight = 0.0;
@@ -42,8 +56,7 @@ auto solve_memetic_ik_test(moveit::core::RobotModelPtr robot_model,
     // Make forward kinematics function
     auto const jmg = robot_model->getJointModelGroup(group_name);
     auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {goal_frame_name}).value();
-    std::mutex mx;
-    auto const fk_fn = pick_ik::make_fk_fn(robot_model, jmg, mx, tip_link_indices);
+    auto const fk_fn = pick_ik::make_fk_fn(robot_model, jmg, tip_link_indices);
     auto const robot = pick_ik::Robot::from(robot_model, jmg, tip_link_indices);
 
     // Make goal function(s)
@@ -85,6 +98,15 @@ auto solve_memetic_ik_test(moveit::core::RobotModelPtr robot_model,
     auto const solution_fn =
         pick_ik::make_is_solution_test_fn(frame_tests, goals, params.cost_threshold, fk_fn);
 
+    auto batch_cost_fn = pick_ik::BatchCostFn();
+    if (params.use_batch_cost) {
+        auto const chain = std::make_shared<pick_ik::KinematicChain const>(
+            pick_ik::KinematicChain::from(robot_model, jmg, tip_link_indices));
+        batch_cost_fn = pick_ik::make_batch_cost_fn(
+            chain, {goal_frame}, params.position_scale, params.rotation_scale, goals);
+        REQUIRE(batch_cost_fn);
+    }
+
     // Solve memetic IK
     return pick_ik::ik_memetic(initial_guess,
                                robot,
@@ -92,7 +114,13 @@ auto solve_memetic_ik_test(moveit::core::RobotModelPtr robot_model,
                                solution_fn,
                                params.memetic_params,
                                params.approximate_solution,
-                               params.print_debug);
+                               params.print_debug,
+                               pick_ik::CostGradientFn(),
+                               batch_cost_fn,
+                               params.thread_pool,
+                               {},
+                               nullptr,
+                               params.stats);
 }
 
 TEST_CASE("Panda model Memetic IK") {
@@ -101,8 +129,7 @@ TEST_CASE("Panda model Memetic IK") {
 
     auto const jmg = robot_model->getJointModelGroup("panda_arm");
     auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {"panda_hand"}).value();
-    std::mutex mx;
-    auto const fk_fn = pick_ik::make_fk_fn(robot_model, jmg, mx, tip_link_indices);
+    auto const fk_fn = pick_ik::make_fk_fn(robot_model, jmg, tip_link_indices);
 
     std::vector<double> const home_joint_angles =
         {0.0, -M_PI_4, 0.0, -3.0 * M_PI_4, 0.0, M_PI_2, M_PI_4};
@@ -182,6 +209,95 @@ TEST_CASE("Panda model Memetic IK") {
         CHECK(goal_frame.isApprox(final_frame, params.position_threshold));
     }
 
+    SECTION("Panda model IK at zero positions -- multithreaded on a small shared thread pool") {
+        auto const goal_frame = fk_fn(home_joint_angles)[0];
+        auto const initial_guess = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        pick_ik::ThreadPool thread_pool(2);
+        MemeticIkTestParams params;
+        params.memetic_params.num_threads = 4;
+        params.thread_pool = &thread_pool;
+
+        // Solve twice to reuse the same workers across solves.
+        for (size_t i = 0; i < 2; ++i) {
+            auto const maybe_solution = solve_memetic_ik_test(robot_model,
+                                                              "panda_arm",
+                                                              "panda_hand",
+                                                              goal_frame,
+                                                              initial_guess,
+                                                              params);
+
+            REQUIRE(maybe_solution.has_value());
+            auto const final_frame = fk_fn(maybe_solution.value())[0];
+            CHECK(goal_frame.isApprox(final_frame, params.position_threshold));
+        }
+    }
+
+    SECTION("Panda model IK at zero positions -- batched population cost") {
+        auto const goal_frame = fk_fn(home_joint_angles)[0];
+        auto const initial_guess = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        MemeticIkTestParams params;
+        params.use_batch_cost = true;
+
+        auto const maybe_solution = solve_memetic_ik_test(robot_model,
+                                                          "panda_arm",
+                                                          "panda_hand",
+                                                          goal_frame,
+                                                          initial_guess,
+                                                          params);
+
+        REQUIRE(maybe_solution.has_value());
+        auto const final_frame = fk_fn(maybe_solution.value())[0];
+        CHECK(goal_frame.isApprox(final_frame, params.position_threshold));
+    }
+
+    SECTION("Panda model IK at zero positions -- multithreaded with migration") {
+        auto const goal_frame = fk_fn(home_joint_angles)[0];
+        auto const initial_guess = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        MemeticIkTestParams params;
+        params.memetic_params.num_threads = 4;
+        params.memetic_params.migration_interval = 1;
+        params.memetic_params.num_migrants = 2;
+
+        auto const maybe_solution = solve_memetic_ik_test(robot_model,
+                                                          "panda_arm",
+                                                          "panda_hand",
+                                                          goal_frame,
+                                                          initial_guess,
+                                                          params);
+
+        REQUIRE(maybe_solution.has_value());
+        auto const final_frame = fk_fn(maybe_solution.value())[0];
+        CHECK(goal_frame.isApprox(final_frame, params.position_threshold));
+    }
+
+    SECTION("Panda model IK at zero positions -- multithreaded with stats") {
+        auto const goal_frame = fk_fn(home_joint_angles)[0];
+        auto const initial_guess = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        pick_ik::SolveStats stats;
+        MemeticIkTestParams params;
+        params.memetic_params.num_threads = 4;
+        params.memetic_params.stop_on_first_soln = false;
+        params.stats = &stats;
+
+        auto const maybe_solution = solve_memetic_ik_test(robot_model,
+                                                          "panda_arm",
+                                                          "panda_hand",
+                                                          goal_frame,
+                                                          initial_guess,
+                                                          params);
+
+        REQUIRE(maybe_solution.has_value());
+        // Without stopping on the first solution, every species finishes before returning.
+        CHECK(stats.generations >= 4);
+        CHECK(stats.gradient_iterations > 0);
+        CHECK(stats.descent_time > 0.0);
+        CHECK(stats.reproduction_time > 0.0);
+        REQUIRE(stats.species_wins.size() == 4);
+        CHECK(stats.species_wins[0] + stats.species_wins[1] + stats.species_wins[2] +
+                  stats.species_wins[3] ==
+              1);
+    }
+
     SECTION("Panda model IK, with joint centering and limits avoiding.") {
         auto const goal_frame = fk_fn(home_joint_angles)[0];
         auto const initial_guess = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
@@ -205,3 +321,195 @@ TEST_CASE("Panda model Memetic IK") {
         CHECK(goal_frame.isApprox(final_frame, params.position_threshold));
     }
 }
+
+TEST_CASE("pick_ik::MigrationRing") {
+    auto const make_individual = [](double fitness) {
+        return pick_ik::Individual{{fitness}, fitness, 0.0, {0.0}};
+    };
+
+    SECTION("Pops individuals in the order they were pushed") {
+        pick_ik::MigrationRing ring(3);
+        CHECK(ring.push(make_individual(1.0)));
+        CHECK(ring.push(make_individual(2.0)));
+
+        pick_ik::Individual individual;
+        REQUIRE(ring.pop(individual));
+        CHECK(individual.fitness == 1.0);
+        REQUIRE(ring.pop(individual));
+        CHECK(individual.fitness == 2.0);
+        CHECK(!ring.pop(individual));
+    }
+
+    SECTION("Drops individuals when full") {
+        pick_ik::MigrationRing ring(2);
+        CHECK(ring.push(make_individual(1.0)));
+        CHECK(ring.push(make_individual(2.0)));
+        CHECK(!ring.push(make_individual(3.0)));
+
+        // Popping frees up a slot again, and wraps around.
+        pick_ik::Individual individual;
+        REQUIRE(ring.pop(individual));
+        CHECK(ring.push(make_individual(4.0)));
+        REQUIRE(ring.pop(individual));
+        CHECK(individual.fitness == 2.0);
+        REQUIRE(ring.pop(individual));
+        CHECK(individual.fitness == 4.0);
+    }
+}
+
+TEST_CASE("pick_ik::MemeticIk population") {
+    auto robot = pick_ik::Robot{};
+    for (size_t i = 0; i < 3; ++i) {
+        auto variable = pick_ik::Robot::Variable{};
+        variable.min = -1.0;
+        variable.max = 1.0;
+        variable.mid = 0.0;
+        variable.bounded = true;
+        variable.half_span = 1.0;
+        robot.variables.push_back(variable);
+    }
+    auto const cost_fn = [](std::vector<double> const& genes) {
+        auto cost = 0.0;
+        for (auto const gene : genes) {
+            cost += (gene - 0.5) * (gene - 0.5);
+        }
+        return cost;
+    };
+
+    auto const initial_guess = std::vector<double>{0.0, 0.0, 0.0};
+    auto params = pick_ik::MemeticIkParams{};
+    auto ik = pick_ik::MemeticIk::from(initial_guess, cost_fn, params);
+    auto rng = pick_ik::Rng(0);
+    ik.initPopulation(robot, cost_fn, initial_guess, rng);
+    ik.sortPopulation();
+
+    SECTION("Best individuals are consistent with the cost function") {
+        for (size_t generation = 0; generation < 10; ++generation) {
+            ik.gradientDescent(0, robot, cost_fn, params.gd_params);
+            ik.reproduce(robot, cost_fn, rng);
+            ik.sortPopulation();
+
+            auto const& best_current = ik.bestCurrent();
+            CHECK(best_current.fitness == Catch::Approx(cost_fn(best_current.genes)));
+            CHECK(robot.is_valid_configuration(best_current.genes));
+            CHECK(ik.best().fitness <= best_current.fitness);
+        }
+    }
+
+    SECTION("Fitter immigrants become the best individual") {
+        pick_ik::MigrationRing ring(2);
+        auto const solution = std::vector<double>{0.5, 0.5, 0.5};
+        ring.push(pick_ik::Individual{solution, 0.0, 0.0, {0.0, 0.0, 0.0}});
+
+        ik.immigrate(ring);
+
+        CHECK(ik.bestCurrent().genes == solution);
+        CHECK(ik.best().fitness == 0.0);
+    }
+
+    SECTION("Elite guesses seed the initial elites") {
+        auto const solution = std::vector<double>{0.5, 0.5, 0.5};
+        ik.initPopulation(robot, cost_fn, initial_guess, rng, pick_ik::BatchCostFn(), {solution});
+        ik.sortPopulation();
+
+        CHECK(ik.bestCurrent().genes == solution);
+        CHECK(ik.best().fitness == 0.0);
+    }
+
+    SECTION("Random elites take consecutive Halton points across wipeouts") {
+        auto evaluated = std::vector<std::vector<double>>{};
+        auto const recording_cost_fn = [&](std::vector<double> const& genes) {
+            evaluated.push_back(genes);
+            return cost_fn(genes);
+        };
+        auto halton_rng = pick_ik::Rng(1);
+        params.halton = std::make_shared<pick_ik::HaltonSequence>(3, halton_rng);
+        auto halton_ik = pick_ik::MemeticIk::from(initial_guess, recording_cost_fn, params);
+        auto start_rng = rng;
+        for (size_t wipeout = 0; wipeout < 3; ++wipeout) {
+            halton_ik.initPopulation(robot, recording_cost_fn, initial_guess, rng);
+        }
+
+        // Every population starts elite_size - 1 elites at the next points of the sequence, from
+        // a start drawn from the random stream of the species.
+        auto reference_rng = pick_ik::Rng(1);
+        auto reference = pick_ik::HaltonSequence(3, reference_rng);
+        auto const start = reference.random_start(start_rng);
+        auto point = std::vector<double>{};
+        for (size_t i = 0; i < 3 * (params.elite_size - 1); ++i) {
+            reference.at(start + i, point);
+            auto genes = std::vector<double>{};
+            for (auto const value : point) {
+                genes.push_back(-1.0 + 2.0 * value);
+            }
+            CHECK(std::find(evaluated.cbegin(), evaluated.cend(), genes) != evaluated.cend());
+        }
+    }
+
+    SECTION("Solves with the same seed are reproducible") {
+        // Running to the generation limit without a valid solution makes the solve independent
+        // of timing.
+        auto const solution_fn = [](std::vector<double> const&) { return false; };
+        params.max_generations = 20;
+        params.max_time = 60.0;
+        params.gd_params.max_time = 60.0;
+        auto const solve = [&](uint64_t seed, size_t num_threads) {
+            params.seed = seed;
+            params.num_threads = num_threads;
+            params.stop_on_first_soln = false;
+            return pick_ik::ik_memetic(
+                initial_guess, robot, cost_fn, solution_fn, params, true /* approx_solution */);
+        };
+
+        auto const first = solve(42, 1);
+        REQUIRE(first.has_value());
+        CHECK(solve(42, 1) == first);
+        CHECK(solve(43, 1) != first);
+
+        // Species draw from their own streams, so their results do not depend on scheduling.
+        auto const species = solve(42, 4);
+        REQUIRE(species.has_value());
+        CHECK(solve(42, 4) == species);
+
+        // Also when they share a Halton sequence.
+        auto halton_rng = pick_ik::Rng(1);
+        params.halton = std::make_shared<pick_ik::HaltonSequence>(3, halton_rng);
+        auto const halton_species = solve(42, 4);
+        REQUIRE(halton_species.has_value());
+        CHECK(solve(42, 4) == halton_species);
+    }
+
+    SECTION("Cancelling stops the solve within a gradient descent step") {
+        // Without a cost delta or iteration limit, each generation would descend for 10 s.
+        auto const solution_fn = [](std::vector<double> const&) { return false; };
+        params.max_time = 60.0;
+        params.gd_params.max_time = 10.0;
+        params.gd_params.min_cost_delta = -1.0;
+        params.gd_params.max_iterations = std::numeric_limits<int>::max();
+
+        for (auto const num_threads : {size_t{1}, size_t{4}}) {
+            params.num_threads = num_threads;
+            auto cancel = std::make_shared<std::atomic<bool>>(false);
+            auto canceller = std::thread([cancel] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                *cancel = true;
+            });
+            auto const start = std::chrono::steady_clock::now();
+            pick_ik::ik_memetic(initial_guess,
+                                robot,
+                                cost_fn,
+                                solution_fn,
+                                params,
+                                true /* approx_solution */,
+                                false /* print_debug */,
+                                pick_ik::CostGradientFn(),
+                                pick_ik::BatchCostFn(),
+                                nullptr /* thread_pool */,
+                                {} /* elite_guesses */,
+                                cancel);
+            auto const elapsed = std::chrono::steady_clock::now() - start;
+            canceller.join();
+            CHECK(elapsed < std::chrono::seconds(2));
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#include <pick_ik/ik_stream.hpp>
+#include <pick_ik/robot.hpp>
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+TEST_CASE("pick_ik::IkStream") {
+    auto robot = pick_ik::Robot{};
+    for (size_t i = 0; i < 2; ++i) {
+        auto variable = pick_ik::Robot::Variable{};
+        variable.min = -1.0;
+        variable.max = 1.0;
+        variable.mid = 0.0;
+        variable.bounded = true;
+        variable.half_span = 1.0;
+        robot.variables.push_back(variable);
+    }
+
+    auto stream = pick_ik::IkStream{};
+    pick_ik::reset(stream, {0.0, 0.0});
+
+    SECTION("An empty stream has no seed") {
+        CHECK(pick_ik::predict_seed(pick_ik::IkStream{}, robot).empty());
+    }
+
+    SECTION("The seed state is the first prediction") {
+        CHECK(pick_ik::predict_seed(stream, robot) == std::vector<double>{0.0, 0.0});
+    }
+
+    SECTION("Seeds are extrapolated from the last two solutions") {
+        pick_ik::record_solution(stream, {0.1, -0.2});
+        auto const seed = pick_ik::predict_seed(stream, robot);
+        REQUIRE(seed.size() == 2);
+        CHECK(seed[0] == Catch::Approx(0.2));
+        CHECK(seed[1] == Catch::Approx(-0.4));
+    }
+
+    SECTION("Extrapolated seeds are clamped to the limits") {
+        pick_ik::record_solution(stream, {0.8, 0.0});
+        pick_ik::record_solution(stream, {0.95, 0.0});
+        auto const seed = pick_ik::predict_seed(stream, robot);
+        REQUIRE(seed.size() == 2);
+        CHECK(seed[0] == Catch::Approx(1.0));
+    }
+
+    SECTION("The history keeps the latest solutions") {
+        for (auto i = 1; i <= 5; ++i) {
+            pick_ik::record_solution(stream, {0.1 * i, 0.0});
+        }
+        REQUIRE(stream.solutions.size() == stream.history_size);
+        CHECK(stream.solutions.back()[0] == Catch::Approx(0.5));
+        CHECK(stream.solutions.front()[0] == Catch::Approx(0.3));
+    }
+
+    SECTION("Resetting forgets the previous solutions") {
+        pick_ik::record_solution(stream, {0.5, 0.5});
+        pick_ik::reset(stream, {-0.5, 0.5});
+        CHECK(stream.solutions.size() == 1);
+        CHECK(pick_ik::predict_seed(stream, robot) == std::vector<double>{-0.5, 0.5});
+    }
+}
@@ -2,15 +2,21 @@
 #include <pick_ik/goal.hpp>
 #include <pick_ik/ik_gradient.hpp>
 #include <pick_ik/robot.hpp>
+#include <pick_ik/solve_stats.hpp>
 
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.hpp>
 
 #include <Eigen/Geometry>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <memory>
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/utils/robot_model_test_utils.h>
+#include <thread>
 
 auto make_rr_model_for_ik() {
     /**
@@ -53,8 +59,7 @@ TEST_CASE("RR model FK") {
     auto const jmg = robot_model->getJointModelGroup("group");
     auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {"ee"}).value();
 
-    std::mutex mx;
-    auto const fk_fn = pick_ik::make_fk_fn(robot_model, jmg, mx, tip_link_indices);
+    auto const fk_fn = pick_ik::make_fk_fn(robot_model, jmg, tip_link_indices);
 
     SECTION("Zero joint position") {
         std::vector<double> const joint_vals = {0.0, 0.0};
@@ -74,6 +79,69 @@ TEST_CASE("RR model FK") {
     }
 }
 
+namespace {
+// Evaluates FK of the panda arm on several threads at once, alternating between two
+// configurations so every call does real work. Returns the total number of FK evaluations per
+// second across all threads, and clears all_correct if any frame differs from the single-threaded
+// result.
+auto measure_panda_fk_throughput(unsigned int thread_count, std::atomic<bool>& all_correct)
+    -> double {
+    using moveit::core::loadTestingRobotModel;
+    auto const robot_model = loadTestingRobotModel("panda");
+
+    auto const jmg = robot_model->getJointModelGroup("panda_arm");
+    auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {"panda_hand"}).value();
+    auto const fk_fn = pick_ik::make_fk_fn(robot_model, jmg, tip_link_indices);
+
+    std::vector<std::vector<double>> const joint_vals = {
+        {0.0, -M_PI_4, 0.0, -3.0 * M_PI_4, 0.0, M_PI_2, M_PI_4},
+        {0.1, -M_PI_4 - 0.1, 0.1, -3.0 * M_PI_4 - 0.1, 0.1, M_PI_2 - 0.1, M_PI_4 + 0.1}};
+    std::vector<Eigen::Isometry3d> const expected_frames = {fk_fn(joint_vals[0])[0],
+                                                            fk_fn(joint_vals[1])[0]};
+
+    constexpr size_t kEvaluationsPerThread = 20000;
+    auto const start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < thread_count; ++i) {
+        threads.emplace_back([&] {
+            for (size_t j = 0; j < kEvaluationsPerThread; ++j) {
+                auto const k = j % 2;
+                if (!fk_fn(joint_vals[k])[0].isApprox(expected_frames[k])) {
+                    all_correct = false;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(thread_count * kEvaluationsPerThread) / elapsed.count();
+}
+}  // namespace
+
+TEST_CASE("Panda model FK on concurrent threads") {
+    std::atomic<bool> all_correct{true};
+    measure_panda_fk_throughput(4, all_correct);
+    CHECK(all_correct);
+}
+
+// Wall-clock ratios are unreliable on loaded machines and under sanitizers, so this only runs when
+// requested with the [.scaling] tag.
+TEST_CASE("Panda model FK thread scaling", "[.scaling]") {
+    auto const num_threads = std::min(4u, std::thread::hardware_concurrency());
+    if (num_threads < 2) {
+        SKIP("Thread scaling requires at least two hardware threads");
+    }
+
+    std::atomic<bool> all_correct{true};
+    auto const single_thread_throughput = measure_panda_fk_throughput(1, all_correct);
+    auto const multi_thread_throughput = measure_panda_fk_throughput(num_threads, all_correct);
+
+    CHECK(all_correct);
+    CHECK(multi_thread_throughput > 1.2 * single_thread_throughput);
+}
+
 // Helper param struct and function to test IK solution.
 struct IkTestParams {
     double position_threshold = 0.0001;
@@ -82,7 +150,9 @@ struct IkTestParams {
     double position_scale = 1.0;
     double rotation_scale = 1.0;
     bool return_approximate_solution = false;
+    bool use_analytic_gradient = false;
     pick_ik::GradientIkParams gd_params;
+    pick_ik::SolveStats* stats = nullptr;
 };
 
 auto solve_ik_test(moveit::core::RobotModelPtr robot_model,
@@ -95,8 +165,7 @@ auto solve_ik_test(moveit::core::RobotModelPtr robot_model,
     // Make forward kinematics function
     auto const jmg = robot_model->getJointModelGroup(group_name);
     auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {goal_frame_name}).value();
-    std::mutex mx;
-    auto const fk_fn = pick_ik::make_fk_fn(robot_model, jmg, mx, tip_link_indices);
+    auto const fk_fn = pick_ik::make_fk_fn(robot_model, jmg, tip_link_indices);
 
     // Make solution function
     auto const test_position = (params.position_scale > 0);
@@ -126,12 +195,23 @@ auto solve_ik_test(moveit::core::RobotModelPtr robot_model,
     // Solve IK
     auto const robot = pick_ik::Robot::from(robot_model, jmg, tip_link_indices);
     auto const cost_fn = pick_ik::make_cost_fn(pose_cost_functions, goals, fk_fn);
+    auto gradient_fn = pick_ik::CostGradientFn();
+    if (params.use_analytic_gradient) {
+        auto const chain = std::make_shared<pick_ik::KinematicChain const>(
+            pick_ik::KinematicChain::from(robot_model, jmg, tip_link_indices));
+        gradient_fn = pick_ik::make_cost_gradient_fn(
+            chain, {goal_frame}, params.position_scale, params.rotation_scale, goals);
+        CHECK(gradient_fn);
+    }
     return pick_ik::ik_gradient(initial_guess,
                                 robot,
                                 cost_fn,
                                 solution_fn,
                                 params.gd_params,
-                                params.return_approximate_solution);
+                                params.return_approximate_solution,
+                                gradient_fn,
+                                nullptr,
+                                params.stats);
 }
 
 TEST_CASE("RR model IK") {
@@ -195,6 +275,22 @@ TEST_CASE("RR model IK") {
         CHECK(maybe_solution.value()[1] == Catch::Approx(expected_joint_angles[1]).margin(0.01));
     }
 
+    SECTION("Counts the descent steps") {
+        Eigen::Isometry3d const goal_frame =
+            Eigen::Translation3d(3.0, 0.0, 0.0) * Eigen::Quaterniond::Identity();
+        std::vector<double> const initial_guess = {0.1, -0.1};
+        pick_ik::SolveStats stats;
+        IkTestParams params;
+        params.stats = &stats;
+
+        auto const maybe_solution =
+            solve_ik_test(robot_model, "group", "ee", goal_frame, initial_guess, params);
+
+        REQUIRE(maybe_solution.has_value());
+        CHECK(stats.gradient_iterations > 0);
+        CHECK(stats.gradient_iterations <= static_cast<size_t>(params.gd_params.max_iterations));
+    }
+
     SECTION("Unreachable position") {
         auto const goal_frame = Eigen::Isometry3d::Identity();
         std::vector<double> const expected_joint_angles = {0.0, 0.0};  // Doesn't matter
@@ -243,8 +339,7 @@ TEST_CASE("Panda model IK") {
 
     auto const jmg = robot_model->getJointModelGroup("panda_arm");
     auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {"panda_hand"}).value();
-    std::mutex mx;
-    auto const fk_fn = pick_ik::make_fk_fn(robot_model, jmg, mx, tip_link_indices);
+    auto const fk_fn = pick_ik::make_fk_fn(robot_model, jmg, tip_link_indices);
 
     std::vector<double> const home_joint_angles =
         {0.0, -M_PI_4, 0.0, -3.0 * M_PI_4, 0.0, M_PI_2, M_PI_4};
@@ -290,4 +385,26 @@ TEST_CASE("Panda model IK") {
             CHECK(maybe_solution.value()[i] == Catch::Approx(actual_joint_angles[i]).margin(0.025));
         }
     }
+
+    SECTION("Panda model IK at perturbed home values -- analytic gradient") {
+        std::vector<double> const actual_joint_angles =
+            {0.1, -M_PI_4 - 0.1, 0.1, -3.0 * M_PI_4 - 0.1, 0.1, M_PI_2 - 0.1, M_PI_4 + 0.1};
+        auto const goal_frame = fk_fn(actual_joint_angles)[0];
+
+        auto const initial_guess = home_joint_angles;
+        auto params = IkTestParams();
+        params.rotation_scale = 0.5;
+        params.use_analytic_gradient = true;
+
+        auto const maybe_solution = solve_ik_test(robot_model,
+                                                  "panda_arm",
+                                                  "panda_hand",
+                                                  goal_frame,
+                                                  initial_guess,
+                                                  params);
+
+        REQUIRE(maybe_solution.has_value());
+        auto const final_frame = fk_fn(maybe_solution.value())[0];
+        CHECK(goal_frame.isApprox(final_frame, 0.001));
+    }
 }
@@ -0,0 +1,64 @@
+#include <pick_ik/random.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace {
+auto draw(pick_ik::Rng rng, size_t count) -> std::vector<uint64_t> {
+    auto values = std::vector<uint64_t>{};
+    for (size_t i = 0; i < count; ++i) {
+        values.push_back(rng());
+    }
+    return values;
+}
+}  // namespace
+
+TEST_CASE("pick_ik::Rng") {
+    SECTION("The same seed gives the same numbers") {
+        CHECK(draw(pick_ik::Rng(42), 100) == draw(pick_ik::Rng(42), 100));
+        CHECK(draw(pick_ik::Rng(42), 100) != draw(pick_ik::Rng(43), 100));
+    }
+
+    SECTION("Streams of a seed differ from each other") {
+        auto const seed = uint64_t{42};
+        auto const first = draw(pick_ik::Rng(pick_ik::stream_seed(seed, 0)), 100);
+        CHECK(draw(pick_ik::Rng(pick_ik::stream_seed(seed, 0)), 100) == first);
+        CHECK(draw(pick_ik::Rng(pick_ik::stream_seed(seed, 1)), 100) != first);
+        CHECK(draw(pick_ik::Rng(pick_ik::stream_seed(seed + 1, 0)), 100) != first);
+    }
+
+    SECTION("Real values are within bounds and cover them") {
+        auto rng = pick_ik::Rng(0);
+        auto min = 1.0;
+        auto max = -1.0;
+        for (size_t i = 0; i < 10000; ++i) {
+            auto const value = rng.uniform_real(-1.0, 1.0);
+            REQUIRE(value >= -1.0);
+            REQUIRE(value < 1.0);
+            min = std::min(min, value);
+            max = std::max(max, value);
+        }
+        CHECK(min < -0.99);
+        CHECK(max > 0.99);
+    }
+
+    SECTION("Integer values hit every value of the range") {
+        auto rng = pick_ik::Rng(0);
+        auto counts = std::vector<size_t>(5, 0);
+        for (size_t i = 0; i < 10000; ++i) {
+            auto const value = rng.uniform_int(2, 6);
+            REQUIRE(value >= 2);
+            REQUIRE(value <= 6);
+            ++counts[value - 2];
+        }
+        for (auto const count : counts) {
+            CHECK(count > 1800);
+            CHECK(count < 2200);
+        }
+        CHECK(rng.uniform_int(3, 3) == 3);
+    }
+}
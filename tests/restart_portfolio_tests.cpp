@@ -0,0 +1,96 @@
+#include <pick_ik/goal.hpp>
+#include <pick_ik/restart_portfolio.hpp>
+#include <pick_ik/thread_pool.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace {
+auto const cost_fn = [](std::vector<double> const& values) {
+    auto cost = 0.0;
+    for (auto const value : values) {
+        cost += value * value;
+    }
+    return cost;
+};
+auto const solution_fn = [](std::vector<double> const& values) { return cost_fn(values) < 0.01; };
+
+// Returns its initial guess.
+auto const return_guess = [](std::vector<double> const& initial_guess,
+                             std::shared_ptr<std::atomic<bool> const> const&) {
+    return std::optional<std::vector<double>>{initial_guess};
+};
+}  // namespace
+
+TEST_CASE("pick_ik::solve_portfolio") {
+    auto thread_pool = pick_ik::ThreadPool(4);
+
+    SECTION("The first valid solution cancels the other solves") {
+        auto cancelled = std::atomic<bool>{false};
+        auto const wait_for_cancel = [&cancelled](
+                                         std::vector<double> const&,
+                                         std::shared_ptr<std::atomic<bool> const> const& cancel) {
+            auto const timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (!*cancel && std::chrono::steady_clock::now() < timeout) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            cancelled = cancel->load();
+            return std::optional<std::vector<double>>{};
+        };
+        auto const restarts = std::vector<pick_ik::Restart>{{wait_for_cancel, {1.0}},
+                                                            {return_guess, {0.05}}};
+        auto const solution =
+            pick_ik::solve_portfolio(restarts, cost_fn, solution_fn, true, &thread_pool);
+        REQUIRE(solution.has_value());
+        CHECK(solution->solution == std::vector<double>{0.05});
+        CHECK(solution->restart == 1);
+        CHECK(cancelled);
+    }
+
+    SECTION("Without stopping on the first solution, the valid solution of lowest cost wins") {
+        auto const restarts = std::vector<pick_ik::Restart>{
+            {return_guess, {0.09}}, {return_guess, {0.01}}, {return_guess, {0.05}}};
+        auto const solution =
+            pick_ik::solve_portfolio(restarts, cost_fn, solution_fn, false, &thread_pool);
+        REQUIRE(solution.has_value());
+        CHECK(solution->solution == std::vector<double>{0.01});
+        CHECK(solution->restart == 1);
+    }
+
+    SECTION("Without valid solutions, the approximate solution of lowest cost wins") {
+        auto const no_solution = [](std::vector<double> const&,
+                                    std::shared_ptr<std::atomic<bool> const> const&) {
+            return std::optional<std::vector<double>>{};
+        };
+        auto const restarts = std::vector<pick_ik::Restart>{
+            {return_guess, {2.0}}, {no_solution, {0.0}}, {return_guess, {1.0}}};
+        auto const solution =
+            pick_ik::solve_portfolio(restarts, cost_fn, solution_fn, true, &thread_pool);
+        REQUIRE(solution.has_value());
+        CHECK(solution->solution == std::vector<double>{1.0});
+        CHECK(!pick_ik::solve_portfolio({{no_solution, {0.0}}}, cost_fn, solution_fn, true, nullptr)
+                   .has_value());
+    }
+
+    SECTION("Without a pool, solves after a valid solution are skipped") {
+        auto calls = 0;
+        auto const count_calls = [&calls](std::vector<double> const& initial_guess,
+                                          std::shared_ptr<std::atomic<bool> const> const&) {
+            ++calls;
+            return std::optional<std::vector<double>>{initial_guess};
+        };
+        auto const restarts = std::vector<pick_ik::Restart>{
+            {count_calls, {0.0}}, {count_calls, {0.0}}, {count_calls, {0.0}}};
+        auto const solution =
+            pick_ik::solve_portfolio(restarts, cost_fn, solution_fn, true, nullptr);
+        REQUIRE(solution.has_value());
+        CHECK(solution->restart == 0);
+        CHECK(calls == 1);
+    }
+}
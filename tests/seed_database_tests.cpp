@@ -0,0 +1,207 @@
+#include <pick_ik/goal.hpp>
+#include <pick_ik/robot.hpp>
+#include <pick_ik/seed_database.hpp>
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+// A robot whose variables are the position and the yaw of its tip.
+struct CartesianFixture {
+    pick_ik::Robot robot;
+    pick_ik::FkFn fk_fn = [](std::vector<double> const& active_positions) {
+        auto frame = Eigen::Isometry3d::Identity();
+        frame.translation() =
+            Eigen::Vector3d(active_positions[0], active_positions[1], active_positions[2]);
+        frame.linear() =
+            Eigen::AngleAxisd(active_positions[3], Eigen::Vector3d::UnitZ()).toRotationMatrix();
+        return std::vector<Eigen::Isometry3d>{frame};
+    };
+
+    CartesianFixture() {
+        for (size_t i = 0; i < 4; ++i) {
+            auto variable = pick_ik::Robot::Variable{};
+            variable.min = i < 3 ? -1.0 : -M_PI;
+            variable.max = i < 3 ? 1.0 : M_PI;
+            variable.mid = 0.0;
+            variable.bounded = true;
+            variable.half_span = variable.max;
+            robot.variables.push_back(variable);
+        }
+    }
+
+    auto make_goal(double x, double y, double z, double yaw) const -> Eigen::Isometry3d {
+        return fk_fn({x, y, z, yaw}).front();
+    }
+};
+}  // namespace
+
+TEST_CASE("pick_ik::SeedDatabase") {
+    auto const fixture = CartesianFixture{};
+    auto const built =
+        pick_ik::build_seed_database("arm", "tip", 42, fixture.robot, fixture.fk_fn, 0, 2000);
+    REQUIRE(built.has_value());
+    auto const& database = built.value();
+    REQUIRE(database.size() == 2000);
+
+    auto const goals = std::vector<Eigen::Isometry3d>{fixture.make_goal(0.1, 0.2, 0.3, 0.0),
+                                                      fixture.make_goal(-0.9, 0.8, 0.0, 1.0),
+                                                      fixture.make_goal(0.5, -0.5, -0.7, -2.0)};
+
+    SECTION("The nearest seeds by position match a linear search") {
+        for (auto const& goal : goals) {
+            auto const seeds = pick_ik::find_seeds(database, goal, 5, 1.0, 0.0);
+            REQUIRE(seeds.size() == 5);
+
+            auto distances = std::vector<double>{};
+            for (size_t i = 0; i < database.size(); ++i) {
+                auto const* const configuration = database.configurations + i * 4;
+                distances.push_back((Eigen::Vector3d(configuration[0],
+                                                     configuration[1],
+                                                     configuration[2]) -
+                                     goal.translation())
+                                        .norm());
+            }
+            std::sort(distances.begin(), distances.end());
+            for (size_t i = 0; i < seeds.size(); ++i) {
+                auto const seed_frame = fixture.fk_fn(seeds[i]).front();
+                CHECK(pick_ik::linear_distance(goal, seed_frame) == distances[i]);
+            }
+        }
+    }
+
+    SECTION("Seeds are ranked by position and orientation") {
+        for (auto const& goal : goals) {
+            auto const seeds = pick_ik::find_seeds(database, goal, 4, 1.0, 0.5);
+            REQUIRE(seeds.size() == 4);
+            auto previous_cost = 0.0;
+            for (auto const& seed : seeds) {
+                auto const seed_frame = fixture.fk_fn(seed).front();
+                auto const cost = std::pow(pick_ik::linear_distance(goal, seed_frame), 2) +
+                                  std::pow(pick_ik::angular_distance(goal, seed_frame) * 0.5, 2);
+                CHECK(cost >= previous_cost);
+                previous_cost = cost;
+            }
+        }
+    }
+
+    SECTION("Orientation-only seeds ignore the position") {
+        auto const seeds = pick_ik::find_seeds(database, goals[1], 3, 0.0, 1.0);
+        REQUIRE(seeds.size() == 3);
+        for (auto const& seed : seeds) {
+            CHECK(std::abs(seed[3] - 1.0) < 0.05);
+        }
+    }
+
+    SECTION("The nearest seeds by orientation match a linear search") {
+        for (auto const& goal : goals) {
+            auto const seeds = pick_ik::find_seeds(database, goal, 5, 0.0, 1.0);
+            REQUIRE(seeds.size() == 5);
+
+            auto distances = std::vector<double>{};
+            for (size_t i = 0; i < database.size(); ++i) {
+                auto const* const configuration = database.configurations + i * 4;
+                distances.push_back(pick_ik::angular_distance(
+                    goal, fixture.fk_fn({configuration, configuration + 4}).front()));
+            }
+            std::sort(distances.begin(), distances.end());
+            for (size_t i = 0; i < seeds.size(); ++i) {
+                auto const seed_frame = fixture.fk_fn(seeds[i]).front();
+                CHECK(pick_ik::angular_distance(goal, seed_frame) == Catch::Approx(distances[i]));
+            }
+        }
+    }
+
+    // A unique name, so that concurrent test runs do not share the file.
+    auto const path =
+        (std::filesystem::temp_directory_path() /
+         ("pick_ik_seed_database_test_" + std::to_string(std::random_device{}()) + ".bin"))
+            .string();
+
+    SECTION("Databases survive a round trip through a file") {
+        REQUIRE(pick_ik::save_seed_database(database, path).has_value());
+
+        auto const loaded = pick_ik::load_seed_database(path);
+        REQUIRE(loaded.has_value());
+        CHECK(loaded->group_name == "arm");
+        CHECK(loaded->tip_link_name == "tip");
+        CHECK(loaded->model_hash == 42);
+        CHECK(loaded->num_variables == 4);
+        CHECK(loaded->size() == database.size());
+        CHECK(std::equal(database.configurations,
+                         database.configurations + database.size() * 4,
+                         loaded->configurations));
+        CHECK(std::equal(database.tip_poses,
+                         database.tip_poses + database.size() * pick_ik::SeedDatabase::kPoseEntries,
+                         loaded->tip_poses));
+        CHECK(std::equal(database.kd_tree, database.kd_tree + database.size(), loaded->kd_tree));
+        CHECK(std::equal(database.orientation_kd_tree,
+                         database.orientation_kd_tree + database.size(),
+                         loaded->orientation_kd_tree));
+        for (auto const& goal : goals) {
+            CHECK(pick_ik::find_seeds(loaded.value(), goal, 4, 1.0, 0.5) ==
+                  pick_ik::find_seeds(database, goal, 4, 1.0, 0.5));
+        }
+
+        // The mapped arrays outlive the database they were loaded into.
+        auto const copy = pick_ik::SeedDatabase(loaded.value());
+        CHECK(copy.configurations == loaded->configurations);
+
+        // Truncated files are rejected.
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+        CHECK(!pick_ik::load_seed_database(path).has_value());
+        std::filesystem::remove(path);
+        CHECK(!pick_ik::load_seed_database(path).has_value());
+    }
+
+    SECTION("Invalid arrays and sample counts are rejected") {
+        // One configuration of 4 variables, but the tip poses of two samples.
+        auto const tip_poses = std::vector<double>(2 * pick_ik::SeedDatabase::kPoseEntries, 0.0);
+        CHECK(!pick_ik::make_seed_database("arm", "tip", 42, 4, {0.0, 0.0, 0.0, 0.0}, tip_poses)
+                   .has_value());
+
+        // Too many samples for the index fail before any is sampled.
+        auto const too_many = pick_ik::build_seed_database("arm",
+                                                           "tip",
+                                                           42,
+                                                           fixture.robot,
+                                                           fixture.fk_fn,
+                                                           0,
+                                                           pick_ik::SeedDatabase::kMaxSamples + 1);
+        CHECK(!too_many.has_value());
+    }
+
+    SECTION("Empty databases survive a round trip through a file") {
+        auto const empty = pick_ik::make_seed_database("arm", "tip", 42, 4, {}, {});
+        REQUIRE(empty.has_value());
+        REQUIRE(pick_ik::save_seed_database(empty.value(), path).has_value());
+        auto const loaded = pick_ik::load_seed_database(path);
+        REQUIRE(loaded.has_value());
+        CHECK(loaded->size() == 0);
+        CHECK(pick_ik::find_seeds(loaded.value(), goals[0], 4, 1.0, 0.5).empty());
+        std::filesystem::remove(path);
+    }
+}
+
+TEST_CASE("pick_ik::get_model_hash") {
+    using moveit::core::loadTestingRobotModel;
+    auto const robot_model = loadTestingRobotModel("panda");
+    auto const* const jmg = robot_model->getJointModelGroup("panda_arm");
+    auto const hand = robot_model->getLinkModel("panda_hand")->getLinkIndex();
+    auto const link7 = robot_model->getLinkModel("panda_link7")->getLinkIndex();
+
+    CHECK(pick_ik::get_model_hash(robot_model, jmg, hand) ==
+          pick_ik::get_model_hash(loadTestingRobotModel("panda"), jmg, hand));
+    CHECK(pick_ik::get_model_hash(robot_model, jmg, hand) !=
+          pick_ik::get_model_hash(robot_model, jmg, link7));
+}
@@ -0,0 +1,132 @@
+#include <pick_ik/solution_cache.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <Eigen/Geometry>
+#include <vector>
+
+namespace {
+auto make_goal(double x, double y, double z, double angle = 0.0)
+    -> std::vector<Eigen::Isometry3d> {
+    auto frame = Eigen::Isometry3d::Identity();
+    frame.translation() = Eigen::Vector3d(x, y, z);
+    frame.linear() = Eigen::AngleAxisd(angle, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+    return {frame};
+}
+}  // namespace
+
+TEST_CASE("pick_ik::SolutionCache") {
+    auto params = pick_ik::SolutionCacheParams{};
+    params.max_bytes = 1 << 20;
+    params.position_tolerance = 0.01;
+    params.orientation_tolerance = 0.1;
+    auto cache = pick_ik::SolutionCache(params);
+    auto const solution = std::vector<double>{0.1, 0.2, 0.3};
+
+    SECTION("Goals within the tolerances hit") {
+        CHECK(!cache.find(make_goal(0.5, 0.0, 0.3)).has_value());
+        cache.insert(make_goal(0.5, 0.0, 0.3), solution);
+
+        // Also across grid cell boundaries.
+        CHECK(cache.find(make_goal(0.5, 0.0, 0.3)) == solution);
+        CHECK(cache.find(make_goal(0.505, -0.005, 0.3, 0.05)) == solution);
+        CHECK(cache.find(make_goal(0.495, 0.0, 0.295)) == solution);
+
+        auto const stats = cache.stats();
+        CHECK(stats.hits == 3);
+        CHECK(stats.misses == 1);
+        CHECK(stats.entries == 1);
+        CHECK(stats.bytes > 0);
+    }
+
+    SECTION("Entries list the cached goals, the most recently used first") {
+        auto const other_solution = std::vector<double>{0.4, 0.5, 0.6};
+        cache.insert(make_goal(0.5, 0.0, 0.3), solution);
+        cache.insert(make_goal(0.0, 0.5, 0.3), other_solution);
+        auto const entries = cache.entries();
+        REQUIRE(entries.size() == 2);
+        CHECK(entries[0].first.front().isApprox(make_goal(0.0, 0.5, 0.3).front()));
+        CHECK(entries[0].second == other_solution);
+        CHECK(entries[1].second == solution);
+    }
+
+    SECTION("Goals outside the tolerances miss") {
+        cache.insert(make_goal(0.5, 0.0, 0.3), solution);
+        CHECK(!cache.find(make_goal(0.52, 0.0, 0.3)).has_value());
+        CHECK(!cache.find(make_goal(0.5, 0.0, 0.3, 0.2)).has_value());
+        CHECK(cache.stats().misses == 2);
+    }
+
+    SECTION("The nearest cached goal is returned") {
+        auto const other_solution = std::vector<double>{0.4, 0.5, 0.6};
+        cache.insert(make_goal(0.5, 0.0, 0.3), solution);
+        cache.insert(make_goal(0.515, 0.0, 0.3), other_solution);
+        CHECK(cache.stats().entries == 2);
+        CHECK(cache.find(make_goal(0.501, 0.0, 0.3)) == solution);
+        CHECK(cache.find(make_goal(0.512, 0.0, 0.3)) == other_solution);
+    }
+
+    SECTION("Inserting a matching goal replaces its solution") {
+        auto const other_solution = std::vector<double>{0.4, 0.5, 0.6};
+        cache.insert(make_goal(0.5, 0.0, 0.3), solution);
+        cache.insert(make_goal(0.501, 0.0, 0.3), other_solution);
+        CHECK(cache.stats().entries == 1);
+        CHECK(cache.stats().evictions == 0);
+        CHECK(cache.find(make_goal(0.5, 0.0, 0.3)) == other_solution);
+        CHECK(cache.entries().front().first.front().isApprox(make_goal(0.501, 0.0, 0.3).front()));
+    }
+
+    SECTION("Repeated matching inserts keep the goal with its solution") {
+        auto const other_solution = std::vector<double>{0.4, 0.5, 0.6};
+        cache.insert(make_goal(0.5, 0.0, 0.3), solution);
+        cache.insert(make_goal(0.509, 0.0, 0.3), solution);
+        cache.insert(make_goal(0.518, 0.0, 0.3), other_solution);
+        CHECK(cache.stats().entries == 1);
+        CHECK(!cache.find(make_goal(0.5, 0.0, 0.3)).has_value());
+        CHECK(cache.find(make_goal(0.518, 0.0, 0.3)) == other_solution);
+    }
+
+    SECTION("Unset tolerances ignore the position") {
+        params.position_tolerance.reset();
+        auto orientation_cache = pick_ik::SolutionCache(params);
+        orientation_cache.insert(make_goal(0.5, 0.0, 0.3, 1.0), solution);
+        CHECK(orientation_cache.find(make_goal(-0.5, 0.2, 0.1, 1.05)) == solution);
+        CHECK(!orientation_cache.find(make_goal(0.5, 0.0, 0.3, 0.0)).has_value());
+    }
+
+    SECTION("Unset position tolerances still tell orientations apart") {
+        params.position_tolerance.reset();
+        auto orientation_cache = pick_ik::SolutionCache(params);
+        for (auto i = 0; i < 20; ++i) {
+            auto const angle = 0.3 * static_cast<double>(i);
+            orientation_cache.insert(make_goal(0.5, 0.0, 0.3, angle),
+                                     std::vector<double>{angle});
+        }
+        CHECK(orientation_cache.stats().entries == 20);
+        for (auto i = 0; i < 20; ++i) {
+            auto const angle = 0.3 * static_cast<double>(i);
+            CHECK(orientation_cache.find(make_goal(0.0, 0.0, 0.0, angle + 0.05)) ==
+                  std::vector<double>{angle});
+        }
+    }
+
+    SECTION("The least recently used goals are evicted") {
+        cache.insert(make_goal(0.0, 0.0, 0.0), solution);
+        params.max_bytes = cache.stats().bytes * 2;
+        auto small_cache = pick_ik::SolutionCache(params);
+        small_cache.insert(make_goal(0.0, 0.0, 0.0), solution);
+        small_cache.insert(make_goal(0.1, 0.0, 0.0), solution);
+
+        // Using the first goal makes the second one the least recently used.
+        CHECK(small_cache.find(make_goal(0.0, 0.0, 0.0)).has_value());
+        small_cache.insert(make_goal(0.2, 0.0, 0.0), solution);
+
+        auto const stats = small_cache.stats();
+        CHECK(stats.entries == 2);
+        CHECK(stats.evictions == 1);
+        CHECK(stats.bytes <= params.max_bytes);
+        CHECK(small_cache.find(make_goal(0.0, 0.0, 0.0)).has_value());
+        CHECK(!small_cache.find(make_goal(0.1, 0.0, 0.0)).has_value());
+        CHECK(small_cache.find(make_goal(0.2, 0.0, 0.0)).has_value());
+    }
+}
@@ -0,0 +1,29 @@
+#include <pick_ik/solve_stats.hpp>
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+TEST_CASE("pick_ik::merge") {
+    auto stats = pick_ik::SolveStats{};
+    stats.solves = 1;
+    stats.generations = 10;
+    stats.descent_time = 0.5;
+    stats.species_wins = {1};
+
+    auto other = pick_ik::SolveStats{};
+    other.solves = 2;
+    other.successes = 1;
+    other.fk_evaluations = 100;
+    other.descent_time = 0.25;
+    other.species_wins = {0, 0, 2};
+
+    pick_ik::merge(stats, other);
+    CHECK(stats.solves == 3);
+    CHECK(stats.successes == 1);
+    CHECK(stats.generations == 10);
+    CHECK(stats.fk_evaluations == 100);
+    CHECK(stats.descent_time == Catch::Approx(0.75));
+    CHECK(stats.species_wins == std::vector<size_t>{1, 0, 2});
+}
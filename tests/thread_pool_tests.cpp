@@ -0,0 +1,147 @@
+#include <pick_ik/thread_pool.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+TEST_CASE("pick_ik::TaskGroup") {
+    SECTION("Runs all tasks before wait returns") {
+        pick_ik::ThreadPool pool(4);
+        std::vector<int> results(100, 0);
+
+        pick_ik::TaskGroup tasks(&pool);
+        for (size_t i = 0; i < results.size(); ++i) {
+            tasks.run([&results, i] { results[i] = static_cast<int>(i); });
+        }
+        tasks.wait();
+
+        for (size_t i = 0; i < results.size(); ++i) {
+            CHECK(results[i] == static_cast<int>(i));
+        }
+    }
+
+    SECTION("Can be reused after waiting") {
+        pick_ik::ThreadPool pool(2);
+        std::atomic<int> count{0};
+
+        pick_ik::TaskGroup tasks(&pool);
+        for (int round = 0; round < 3; ++round) {
+            for (int i = 0; i < 10; ++i) {
+                tasks.run([&count] { ++count; });
+            }
+            tasks.wait();
+            CHECK(count == 10 * (round + 1));
+        }
+    }
+
+    SECTION("Runs tasks on the waiting thread without a pool") {
+        auto const caller_id = std::this_thread::get_id();
+        std::vector<std::thread::id> thread_ids;
+
+        pick_ik::TaskGroup tasks(nullptr);
+        for (int i = 0; i < 3; ++i) {
+            tasks.run([&thread_ids] { thread_ids.push_back(std::this_thread::get_id()); });
+        }
+        CHECK(thread_ids.empty());
+        tasks.wait();
+
+        REQUIRE(thread_ids.size() == 3);
+        for (auto const& id : thread_ids) {
+            CHECK(id == caller_id);
+        }
+    }
+
+    SECTION("Stops waiting once done, and waiting again joins the remaining tasks") {
+        pick_ik::ThreadPool pool(2);
+        std::atomic<bool> done{false};
+        std::atomic<bool> release{false};
+        std::atomic<int> finished{0};
+
+        pick_ik::TaskGroup tasks(&pool);
+        tasks.run([&done, &finished] {
+            done = true;
+            ++finished;
+        });
+        tasks.run([&release, &finished] {
+            while (!release) {
+                std::this_thread::yield();
+            }
+            ++finished;
+        });
+
+        CHECK(!tasks.wait_until([&done] { return done.load(); }));
+
+        release = true;
+        tasks.wait();
+        CHECK(finished == 2);
+    }
+
+    SECTION("Nested groups do not deadlock when all workers are busy") {
+        // Every outer task occupies a worker and waits on its own inner tasks, which mirrors
+        // memetic species waiting on their elite gradient descent.
+        pick_ik::ThreadPool pool(1);
+        std::atomic<int> count{0};
+
+        pick_ik::TaskGroup outer(&pool);
+        for (int i = 0; i < 4; ++i) {
+            outer.run([&pool, &count] {
+                pick_ik::TaskGroup inner(&pool);
+                for (int j = 0; j < 4; ++j) {
+                    inner.run([&count] { ++count; });
+                }
+                inner.wait();
+            });
+        }
+        outer.wait();
+
+        CHECK(count == 16);
+    }
+}
+
+TEST_CASE("pick_ik::parallel_for") {
+    SECTION("Calls the function once for every index") {
+        pick_ik::ThreadPool pool(4);
+        std::vector<std::atomic<int>> calls(1000);
+
+        pick_ik::parallel_for(&pool, calls.size(), [&calls](size_t i) { ++calls[i]; });
+
+        for (auto const& count : calls) {
+            CHECK(count == 1);
+        }
+    }
+
+    SECTION("Runs on the calling thread without a pool") {
+        auto const caller_id = std::this_thread::get_id();
+        std::vector<std::thread::id> thread_ids(10);
+
+        pick_ik::parallel_for(nullptr, thread_ids.size(), [&thread_ids](size_t i) {
+            thread_ids[i] = std::this_thread::get_id();
+        });
+
+        for (auto const& id : thread_ids) {
+            CHECK(id == caller_id);
+        }
+    }
+
+    SECTION("Other runners take over the remaining items of a slow one") {
+        // The first item blocks until all others are done, which only happens if the other
+        // runners keep claiming items.
+        pick_ik::ThreadPool pool(2);
+        std::atomic<int> done{0};
+        size_t const count = 50;
+
+        pick_ik::parallel_for(&pool, count, [&done](size_t i) {
+            if (i == 0) {
+                while (done < static_cast<int>(count) - 1) {
+                    std::this_thread::yield();
+                }
+            }
+            ++done;
+        });
+
+        CHECK(done == static_cast<int>(count));
+    }
+}
@@ -0,0 +1,73 @@
+#include <pick_ik/trace.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace {
+auto read_file(std::string const& path) -> std::string {
+    auto file = std::ifstream(path);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+auto count_of(std::string const& text, std::string const& pattern) -> size_t {
+    size_t count = 0;
+    for (auto pos = text.find(pattern); pos != std::string::npos;
+         pos = text.find(pattern, pos + pattern.size())) {
+        ++count;
+    }
+    return count;
+}
+}  // namespace
+
+TEST_CASE("pick_ik::write_chrome_trace") {
+    // A unique name, so that concurrent test runs do not share the file.
+    auto const path = (std::filesystem::temp_directory_path() /
+                       ("pick_ik_trace_test_" + std::to_string(std::random_device{}()) + ".json"))
+                          .string();
+    pick_ik::clear_trace();
+
+    SECTION("Writes the scopes of every thread") {
+        {
+            PICK_IK_TRACE_SCOPE("trace test outer");
+            PICK_IK_TRACE_SCOPE("trace test inner");
+        }
+        std::thread([] { PICK_IK_TRACE_SCOPE("trace test thread"); }).join();
+
+        REQUIRE(pick_ik::write_chrome_trace(path).has_value());
+        auto const trace = read_file(path);
+        CHECK(trace.find("\"traceEvents\"") != std::string::npos);
+        auto const expected = pick_ik::kTracingEnabled ? 1u : 0u;
+        CHECK(count_of(trace, "\"trace test outer\"") == expected);
+        CHECK(count_of(trace, "\"trace test inner\"") == expected);
+        CHECK(count_of(trace, "\"trace test thread\"") == expected);
+    }
+
+    SECTION("Keeps only the most recent events of a thread") {
+        auto const count = pick_ik::trace::ThreadBuffer::kCapacity + 10;
+        for (size_t i = 0; i < count; ++i) {
+            PICK_IK_TRACE_SCOPE("trace test loop");
+        }
+
+        REQUIRE(pick_ik::write_chrome_trace(path).has_value());
+        auto const capacity = pick_ik::trace::ThreadBuffer::kCapacity;
+        auto const recorded = count_of(read_file(path), "\"trace test loop\"");
+        CHECK(recorded == (pick_ik::kTracingEnabled ? capacity : 0));
+    }
+
+    SECTION("Clearing drops the recorded events") {
+        { PICK_IK_TRACE_SCOPE("trace test cleared"); }
+        pick_ik::clear_trace();
+
+        REQUIRE(pick_ik::write_chrome_trace(path).has_value());
+        CHECK(count_of(read_file(path), "\"trace test cleared\"") == 0);
+    }
+
+    std::remove(path.c_str());
+}
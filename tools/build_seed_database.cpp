@@ -0,0 +1,91 @@
+#include <pick_ik/forward_kinematics.hpp>
+#include <pick_ik/robot.hpp>
+#include <pick_ik/seed_database.hpp>
+
+#include <fmt/core.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <memory>
+#include <moveit/robot_model/robot_model.h>
+#include <srdfdom/model.h>
+#include <string>
+#include <urdf/model.h>
+
+// Samples a group offline and writes the seed database read through the
+// memetic_seed_database_path parameter.
+int main(int argc, char** argv) {
+    if (argc != 7) {
+        fmt::print(stderr,
+                   "Usage: {} <urdf> <srdf> <group> <tip_link> <num_samples> <output>\n",
+                   argv[0]);
+        return 1;
+    }
+    auto const group_name = std::string(argv[3]);
+    auto const tip_link_name = std::string(argv[4]);
+    auto const output_path = std::string(argv[6]);
+
+    char* num_samples_end = nullptr;
+    errno = 0;
+    auto const num_samples = std::strtoull(argv[5], &num_samples_end, 10);
+    // strtoull would accept leading spaces and negate negative numbers.
+    if (!std::isdigit(static_cast<unsigned char>(argv[5][0])) || errno != 0 ||
+        *num_samples_end != '\0' || num_samples == 0 ||
+        num_samples > pick_ik::SeedDatabase::kMaxSamples) {
+        fmt::print(stderr,
+                   "Invalid number of samples {}, expected 1 to {}\n",
+                   argv[5],
+                   pick_ik::SeedDatabase::kMaxSamples);
+        return 1;
+    }
+
+    auto urdf_model = std::make_shared<urdf::Model>();
+    if (!urdf_model->initFile(argv[1])) {
+        fmt::print(stderr, "Failed to parse URDF {}\n", argv[1]);
+        return 1;
+    }
+    auto srdf_model = std::make_shared<srdf::Model>();
+    if (!srdf_model->initFile(*urdf_model, argv[2])) {
+        fmt::print(stderr, "Failed to parse SRDF {}\n", argv[2]);
+        return 1;
+    }
+    auto const robot_model =
+        std::make_shared<moveit::core::RobotModel const>(urdf_model, srdf_model);
+
+    auto const* const jmg = robot_model->getJointModelGroup(group_name);
+    if (jmg == nullptr) {
+        fmt::print(stderr, "Unknown group {}\n", group_name);
+        return 1;
+    }
+    auto const tip_link_indices = pick_ik::get_link_indices(robot_model, {tip_link_name});
+    if (!tip_link_indices.has_value()) {
+        fmt::print(stderr, "{}\n", tip_link_indices.error());
+        return 1;
+    }
+
+    auto const robot = pick_ik::Robot::from(robot_model, jmg, tip_link_indices.value());
+    auto const fk_fn =
+        pick_ik::make_incremental_fk_fn(robot_model, jmg, tip_link_indices.value());
+    auto const model_hash =
+        pick_ik::get_model_hash(robot_model, jmg, tip_link_indices.value().front());
+    auto const database = pick_ik::build_seed_database(group_name,
+                                                       tip_link_name,
+                                                       model_hash,
+                                                       robot,
+                                                       fk_fn,
+                                                       0,
+                                                       static_cast<size_t>(num_samples));
+    if (!database.has_value()) {
+        fmt::print(stderr, "{}\n", database.error());
+        return 1;
+    }
+
+    auto const saved = pick_ik::save_seed_database(database.value(), output_path);
+    if (!saved.has_value()) {
+        fmt::print(stderr, "{}\n", saved.error());
+        return 1;
+    }
+    fmt::print("Wrote {} samples of {} to {}\n", database->size(), group_name, output_path);
+    return 0;
+}